@@ -0,0 +1,113 @@
+import * as fs from "fs";
+import * as path from "path";
+import { execFileSync } from "child_process";
+import chalk from "chalk";
+import { Sizes, printBuildReport, readSummary, sizesFromSummary } from "../report";
+
+class linuxPackager {
+    private packagerBinPath = path.join(__dirname, "../../bin/eziapp-packager-linuxx64");
+    private eziappBinPath = path.join(__dirname, "../../bin/eziapp-npm-release-linuxx64");
+    private argv: string[] = [];
+    private eziConfig: any;
+    private outDir: string;
+    private tempDir: string;
+
+    constructor({ eziConfig, outDir, tempDir }: {
+        eziConfig: any;
+        outDir: string;
+        tempDir: string;
+    }) {
+        this.eziConfig = eziConfig;
+        this.outDir = outDir;
+        this.tempDir = tempDir;
+    }
+    public async package() {
+        console.log(chalk.green("✓ packaging for linux..."));
+        const appName = this.eziConfig?.application?.name || "EziApp";
+
+        // 输出目录，打包器直接读取基础程序并一次写出最终程序
+        const outAppPath = path.join(this.outDir, `${appName}_linuxx64`);
+        if (!fs.existsSync(this.outDir)) {
+            fs.mkdirSync(this.outDir, { recursive: true });
+        }
+
+        // 输入程序参数
+        this.argv.push(...['--input', this.eziappBinPath]);
+        this.argv.push(...['--output', outAppPath]);
+
+        // 打包ezi资源参数，资源以页对齐的 .ezi.assets 节追加到 ELF 末尾
+        const assetsDir = path.join(process.cwd(), this.eziConfig.application.buildEntry || "dist");
+        this.argv.push(...['--ezi-asset-dir', assetsDir]);
+        this.argv.push(...['--ezi-config', path.join(this.tempDir, 'ezi.config.manifest.json')]);
+        this.argv.push(...['--ezi-package', this.eziConfig?.application?.package || "com.ezi.app"]);
+        this.argv.push(...['--cache-dir', path.join(process.cwd(), 'node_modules', '.eziapp', 'cache')]);
+        // 启动访问记录，启动所需资源排在资源包最前面
+        const accessProfile = this.eziConfig?.application?.accessProfile;
+        if (accessProfile) {
+            this.argv.push(...['--access-profile', path.join(process.cwd(), accessProfile)]);
+        }
+        const accessBlock = this.eziConfig?.application?.accessBlock;
+        if (accessBlock) {
+            this.argv.push(...['--access-block', String(accessBlock)]);
+        }
+
+        // 应用元数据，对应 Windows 的版本信息，写入 .note.ezi.metadata
+        this.argv.push(...['--ver-productName', appName]);
+        const version = this.eziConfig?.application?.version;
+        if (version) {
+            this.argv.push(...['--ver-productVersion', version]);
+            this.argv.push(...['--ver-fileVersion', version]);
+        }
+        const companyName = this.eziConfig?.application?.author;
+        if (companyName) {
+            this.argv.push(...['--ver-companyName', companyName]);
+        }
+        const description = this.eziConfig?.application?.description;
+        if (description) {
+            this.argv.push(...['--ver-fileDescription', description]);
+        }
+
+        const summaryPath = path.join(this.tempDir, 'packager.summary.json');
+        fs.rmSync(summaryPath, { force: true });
+        this.argv.push(...['--trace-summary', summaryPath]);
+        const tracePath = process.env.EZIAPP_PACKAGER_TRACE;
+        if (tracePath) {
+            this.argv.push(...['--trace', path.resolve(tracePath)]);
+        }
+
+        try {
+            // 开始打包，参数逐个传递，不经过 shell
+            execFileSync(this.packagerBinPath, this.argv, { stdio: 'inherit' });
+            fs.chmodSync(outAppPath, 0o755);
+            console.log(chalk.green("✓ packaging completed:\n" + outAppPath));
+        } catch (error) {
+            // 失败时输出文件保持不变，只清理残留的临时文件
+            console.error(error);
+            fs.rmSync(`${outAppPath}.tmp`, { force: true });
+            process.exit(1);
+        }
+
+        // Build Report
+        const summary = readSummary(summaryPath);
+        let Sizes: Sizes;
+        if (summary) {
+            Sizes = sizesFromSummary(summary, outAppPath);
+        } else {
+            const coreSize = fs.statSync(this.eziappBinPath).size;
+            Sizes = [
+                {
+                    name: 'eziapp-core',
+                    size: coreSize
+                },
+                {
+                    name: 'fontend-assets',
+                    size: Math.max(0, fs.statSync(outAppPath).size - coreSize)
+                }
+            ];
+        }
+        const appRelativePath = path.relative(process.cwd(), outAppPath);
+        printBuildReport('Linux x64', Sizes, appRelativePath, summary);
+    }
+}
+
+export default linuxPackager;
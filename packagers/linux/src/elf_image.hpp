@@ -0,0 +1,351 @@
+#pragma once
+
+#include "utils.hpp"
+#include "mapped_file.hpp"
+#include "output_file.hpp"
+#include "asset_format.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace ezi::builder::packager::elf
+{
+#pragma pack(push, 1)
+    struct FileHeader
+    {
+        unsigned char ident[16];
+        std::uint16_t type;
+        std::uint16_t machine;
+        std::uint32_t version;
+        std::uint64_t entry;
+        std::uint64_t phoff;
+        std::uint64_t shoff;
+        std::uint32_t flags;
+        std::uint16_t ehsize;
+        std::uint16_t phentsize;
+        std::uint16_t phnum;
+        std::uint16_t shentsize;
+        std::uint16_t shnum;
+        std::uint16_t shstrndx;
+    };
+
+    struct ProgramHeader
+    {
+        std::uint32_t type;
+        std::uint32_t flags;
+        std::uint64_t offset;
+        std::uint64_t vaddr;
+        std::uint64_t paddr;
+        std::uint64_t filesz;
+        std::uint64_t memsz;
+        std::uint64_t align;
+    };
+
+    struct SectionHeader
+    {
+        std::uint32_t name;
+        std::uint32_t type;
+        std::uint64_t flags;
+        std::uint64_t addr;
+        std::uint64_t offset;
+        std::uint64_t size;
+        std::uint32_t link;
+        std::uint32_t info;
+        std::uint64_t addralign;
+        std::uint64_t entsize;
+    };
+
+    struct NoteHeader
+    {
+        std::uint32_t namesz;
+        std::uint32_t descsz;
+        std::uint32_t type;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(FileHeader) == 64 && sizeof(ProgramHeader) == 56 && sizeof(SectionHeader) == 64);
+
+    constexpr std::uint32_t SectionNull = 0;
+    constexpr std::uint32_t SectionProgbits = 1;
+    constexpr std::uint32_t SectionNote = 7;
+    constexpr std::uint32_t SectionNobits = 8;
+
+    // Sections written by the packager. They are not part of any segment: the runtime finds the assets through
+    // the overlay footer at the end of the file (or these section headers) and maps them read-only itself.
+    constexpr char AssetSectionName[] = ".ezi.assets";
+    constexpr char MetadataSectionName[] = ".note.ezi.metadata";
+    constexpr char NoteName[] = "EziApp";
+    constexpr std::uint32_t NoteMetadataType = 1; // desc is the UTF-8 JSON metadata
+
+    // An ELF64 little-endian executable that gets the asset bundle appended as a page-aligned section plus a
+    // note carrying the application metadata. Sections from an earlier packaging run are replaced.
+    class Image
+    {
+    private:
+        std::shared_ptr<MappedFile> fileOwner;
+        std::span<const std::byte> file;
+        std::string sourcePath;
+        FileHeader header{};
+        std::vector<SectionHeader> sections;
+        std::string names;
+        std::uint64_t baseEnd = 0;
+
+        std::vector<std::span<const std::byte>> assetParts;
+        std::vector<const MappedFile *> assetSources;
+        std::uint64_t assetSize = 0;
+        std::uint64_t assetHash = 0;
+        std::string metadata;
+
+        template <typename T>
+        T read(std::uint64_t offset) const
+        {
+            if (offset > file.size() || sizeof(T) > file.size() - offset)
+                utils::Fail("Truncated ELF file: " + sourcePath);
+            T value;
+            std::memcpy(&value, file.data() + offset, sizeof(T));
+            return value;
+        }
+
+        std::string_view sectionName(const SectionHeader &section) const
+        {
+            if (section.name >= names.size())
+                return {};
+            return std::string_view(names).substr(section.name, std::string_view(names.c_str() + section.name).size());
+        }
+
+        void parse()
+        {
+            header = read<FileHeader>(0);
+            if (header.ident[0] != 0x7f || std::memcmp(header.ident + 1, "ELF", 3) != 0)
+                utils::Fail("Not an ELF file: " + sourcePath);
+            if (header.ident[4] != 2 || header.ident[5] != 1)
+                utils::Fail("Only 64-bit little-endian ELF files are supported: " + sourcePath);
+            if (header.shentsize != sizeof(SectionHeader) || (header.phnum && header.phentsize != sizeof(ProgramHeader)))
+                utils::Fail("Unexpected ELF header sizes: " + sourcePath);
+            if (header.shnum == 0 || header.shstrndx == 0 || header.shstrndx >= header.shnum)
+                utils::Fail("ELF file without section names, was it stripped with --strip-section-headers? " + sourcePath);
+
+            baseEnd = std::max<std::uint64_t>(sizeof(FileHeader), header.phoff + std::uint64_t(header.phnum) * sizeof(ProgramHeader));
+            for (std::uint16_t i = 0; i < header.phnum; ++i)
+            {
+                auto segment = read<ProgramHeader>(header.phoff + i * sizeof(ProgramHeader));
+                baseEnd = std::max(baseEnd, segment.offset + segment.filesz);
+            }
+
+            for (std::uint16_t i = 0; i < header.shnum; ++i)
+                sections.push_back(read<SectionHeader>(header.shoff + i * sizeof(SectionHeader)));
+            auto &strings = sections[header.shstrndx];
+            if (strings.offset > file.size() || strings.size > file.size() - strings.offset)
+                utils::Fail("Corrupt section name table: " + sourcePath);
+            names.assign(reinterpret_cast<const char *>(file.data() + strings.offset), strings.size);
+
+            // drop the sections of a previous run, which were appended last
+            size_t kept = sections.size();
+            while (kept > 1 && (sectionName(sections[kept - 1]) == AssetSectionName || sectionName(sections[kept - 1]) == MetadataSectionName))
+                --kept;
+            for (size_t i = 1; i < kept; ++i)
+            {
+                auto name = sectionName(sections[i]);
+                if (name == AssetSectionName || name == MetadataSectionName)
+                    utils::Fail("The packaged sections are no longer the last ones, package the original binary instead: " + sourcePath);
+            }
+            sections.resize(kept);
+            if (header.shstrndx >= kept)
+                utils::Fail("Corrupt section name table: " + sourcePath);
+
+            // the name table is rewritten after the kept sections, everything else stays where it is
+            for (size_t i = 1; i < sections.size(); ++i)
+            {
+                auto &section = sections[i];
+                if (i == header.shstrndx || section.type == SectionNobits || section.type == SectionNull)
+                    continue;
+                if (section.offset > file.size() || section.size > file.size() - section.offset)
+                    utils::Fail("Section outside of the file: " + sourcePath);
+                baseEnd = std::max(baseEnd, section.offset + section.size);
+            }
+            if (baseEnd > file.size())
+                utils::Fail("Segment outside of the file: " + sourcePath);
+        }
+
+        std::uint32_t addName(std::string_view name)
+        {
+            auto found = names.find(std::string(name) + '\0');
+            if (found != std::string::npos && (found == 0 || names[found - 1] == '\0'))
+                return static_cast<std::uint32_t>(found);
+            auto offset = static_cast<std::uint32_t>(names.size());
+            names.append(name);
+            names.push_back('\0');
+            return offset;
+        }
+
+    public:
+        Image(std::span<const std::byte> data, std::shared_ptr<MappedFile> owner, std::string path = {})
+            : fileOwner(std::move(owner)), file(data), sourcePath(std::move(path))
+        {
+            parse();
+        }
+
+        static Image Load(const std::string &path)
+        {
+            auto mapped = MappedFile::Open(path);
+            auto bytes = mapped->bytes();
+            return Image(bytes, std::move(mapped), path);
+        }
+
+        // The bundle parts must stay alive until save(). `sources` is parallel to `parts` when given: the
+        // mapping each part lies in, or null, so that unchanged files are copied by range.
+        void setAssets(std::vector<std::span<const std::byte>> parts, std::uint64_t hash, std::vector<const MappedFile *> sources = {})
+        {
+            assetParts = std::move(parts);
+            assetSources = std::move(sources);
+            assetSize = 0;
+            for (auto &part : assetParts)
+                assetSize += part.size();
+            assetHash = hash;
+        }
+
+        void setMetadata(std::string json) { metadata = std::move(json); }
+
+        // File offsets of everything appended after the kept part of the input.
+        struct Layout
+        {
+            std::uint64_t namesOffset;
+            std::uint64_t noteOffset;
+            std::uint64_t noteSize;
+            std::uint64_t sectionsOffset;
+            std::uint64_t assetOffset;
+            std::uint64_t footerOffset;
+            std::uint64_t fileSize;
+        };
+
+    private:
+        Layout layout(std::uint64_t namesSize) const
+        {
+            Layout result{};
+            result.namesOffset = baseEnd;
+            result.noteOffset = utils::AlignUp<std::uint64_t>(result.namesOffset + namesSize, 4);
+            result.noteSize = metadata.empty() ? 0 : sizeof(NoteHeader) + utils::AlignUp<std::uint64_t>(sizeof(NoteName), 4) + utils::AlignUp<std::uint64_t>(metadata.size(), 4);
+            auto sectionCount = sections.size() + (metadata.empty() ? 0 : 1) + (assetParts.empty() ? 0 : 1);
+            result.sectionsOffset = utils::AlignUp<std::uint64_t>(result.noteOffset + result.noteSize, 8);
+            auto end = result.sectionsOffset + sectionCount * sizeof(SectionHeader);
+            result.assetOffset = assetParts.empty() ? end : utils::AlignUp<std::uint64_t>(end, format::OverlayAlignment);
+            result.footerOffset = result.assetOffset + assetSize;
+            result.fileSize = result.footerOffset + (assetParts.empty() ? 0 : sizeof(format::OverlayFooter));
+            return result;
+        }
+
+    public:
+        // Writes through a temp file and renames it over outputPath, which may be the input itself.
+        std::uint64_t save(const std::string &outputPath)
+        {
+            auto assetName = addName(AssetSectionName);
+            auto metadataName = addName(MetadataSectionName);
+            auto plan = layout(names.size());
+
+            auto table = sections;
+            table[header.shstrndx].offset = plan.namesOffset;
+            table[header.shstrndx].size = names.size();
+            if (!metadata.empty())
+            {
+                SectionHeader note{};
+                note.name = metadataName;
+                note.type = SectionNote;
+                note.offset = plan.noteOffset;
+                note.size = plan.noteSize;
+                note.addralign = 4;
+                table.push_back(note);
+            }
+            if (!assetParts.empty())
+            {
+                SectionHeader assets{};
+                assets.name = assetName;
+                assets.type = SectionProgbits;
+                assets.offset = plan.assetOffset;
+                assets.size = assetSize;
+                assets.addralign = format::OverlayAlignment;
+                table.push_back(assets);
+            }
+            auto patched = header;
+            patched.shoff = plan.sectionsOffset;
+            patched.shnum = static_cast<std::uint16_t>(table.size());
+
+            std::string writePath = outputPath + ".tmp";
+            utils::RemoveOnFailure cleanup(writePath);
+            std::uint64_t written = 0;
+            {
+                trace::Scope scope("write");
+                OutputFile out(writePath);
+                auto put = [&](std::span<const std::byte> bytes)
+                { out.write(bytes); };
+
+                put(std::as_bytes(std::span(&patched, 1)));
+                out.copy(*fileOwner, file.subspan(sizeof(FileHeader), baseEnd - sizeof(FileHeader)));
+                put(std::as_bytes(std::span(names)));
+                if (!metadata.empty())
+                {
+                    out.padTo(plan.noteOffset);
+                    NoteHeader note{static_cast<std::uint32_t>(sizeof(NoteName)), static_cast<std::uint32_t>(metadata.size()), NoteMetadataType};
+                    put(std::as_bytes(std::span(&note, 1)));
+                    put(std::as_bytes(std::span(NoteName)));
+                    out.padTo(plan.noteOffset + sizeof(NoteHeader) + utils::AlignUp<std::uint64_t>(sizeof(NoteName), 4));
+                    put(std::as_bytes(std::span(metadata)));
+                    out.padTo(plan.noteOffset + plan.noteSize);
+                }
+                out.padTo(plan.sectionsOffset);
+                put(std::as_bytes(std::span(table)));
+                if (!assetParts.empty())
+                {
+                    out.padTo(plan.assetOffset);
+                    for (size_t i = 0; i < assetParts.size(); ++i)
+                    {
+                        if (i < assetSources.size() && assetSources[i])
+                            out.copy(*assetSources[i], assetParts[i]);
+                        else
+                            put(assetParts[i]);
+                    }
+                    format::OverlayFooter footer{};
+                    std::memcpy(footer.magic, format::OverlayMagic, sizeof(footer.magic));
+                    footer.version = format::OverlayVersion;
+                    footer.hashAlgorithm = format::HashAlgorithm::Crc32c;
+                    footer.offset = plan.assetOffset;
+                    footer.length = assetSize;
+                    footer.hash = assetHash;
+                    put(std::as_bytes(std::span(&footer, 1)));
+                }
+                {
+                    trace::Scope sync("fsync");
+                    if (!out.sync())
+                        trace::Warn("Could not flush " + writePath + " to disk.");
+                }
+                out.close();
+                written = out.position();
+                scope.bytesOut(written);
+                trace::Count("output.rangeCopiedBytes", out.copiedBytes());
+            }
+
+            // keep the executable bits of the input
+            std::error_code ec;
+            if (!sourcePath.empty())
+            {
+                auto permissions = std::filesystem::status(sourcePath, ec).permissions();
+                if (!ec)
+                    std::filesystem::permissions(writePath, permissions, ec);
+            }
+            file = {};
+            fileOwner.reset();
+            trace::Scope scope("rename");
+            std::filesystem::rename(writePath, outputPath, ec);
+            if (ec)
+                utils::Fail("Failed to replace output file.");
+            cleanup.release();
+            return written;
+        }
+    };
+}
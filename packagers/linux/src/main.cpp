@@ -0,0 +1,223 @@
+#include "utils.hpp"
+#include "mapped_file.hpp"
+#include "hash.hpp"
+#include "json.hpp"
+#include "asset_bundle.hpp"
+#include "argument_parser.hpp"
+#include "trace.hpp"
+#include "elf_image.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <filesystem>
+#include <memory>
+
+// 命令行选项，资源相关选项与 Windows 打包器一致
+const std::vector<ezi::builder::packager::Option> PackagerOptions{
+    {"--help", "", "Show this help message"},
+    {"--version", "", "Show version information"},
+    {"--input", "<path>", "Specify the input ELF executable path, updated in place unless --output is given"},
+    {"--output", "<path>", "Write the packaged executable here, leaving --input untouched"},
+    {"--ezi-asset", "<path>", "Specify the path to the eziapp's asset file, or - to read it from stdin"},
+    {"--ezi-asset-dir", "<path>", "Build the eziapp's asset bundle from a directory instead of --ezi-asset"},
+    {"--ezi-config", "<path>", "Specify the path to the eziapp's config json, used with --ezi-asset-dir"},
+    {"--ezi-package", "<name>", "Specify the package name used in asset ids, used with --ezi-asset-dir"},
+    {"--ezi-asset-out", "<path>", "Also write the built asset bundle to a file"},
+    {"--threads", "<count>", "Number of compression threads (default: all cores)"},
+    {"--io-depth", "<count>", "Asset reads kept in flight while scanning the asset directory (default: 64)"},
+    {"--io-backend", "<auto|threads>", "Read assets with io_uring where available (default: auto) or with blocking reads on threads"},
+    {"--cache-dir", "<path>", "Reuse compressed frames across builds from this directory"},
+    {"--asset-index", "<json|binary>", "Write the asset manifest as JSON (default) or as a binary hashed index"},
+    {"--store-raw", "<auto|never>", "Store already compressed or high-entropy assets without zstd, page-aligned; the runtime must support raw entries (default: never)"},
+    {"--chunk-threshold", "<KB>", "Split assets larger than this into seekable zstd chunks; the runtime must read seek tables (default: 0, never)"},
+    {"--chunk-size", "<KB>", "Uncompressed size of each seekable chunk (default: 1024)"},
+    {"--access-profile", "<file.json>", "Lay out the assets listed in this recorded startup order first"},
+    {"--access-block", "<KB>", "Compress the first profiled assets up to this size as one shared zstd frame"},
+    {"--zstd-dict", "<path>", "Compress small assets with this zstd dictionary, stored once in the bundle"},
+    {"--train-dict", "true", "Train a zstd dictionary over the bundle's small assets"},
+    {"--dict-report", "true", "Report compression ratio and decompression speed with and without the dictionary"},
+    {"--trace", "<file.json>", "Write a Chrome trace of every packaging phase with durations, bytes and allocations"},
+    {"--trace-summary", "<file.json>", "Write per-phase totals, resource sizes and warnings for the build report"},
+    {"--ver-companyName", "<name>", "Set the company name in the metadata note"},
+    {"--ver-fileDescription", "<description>", "Set the file description in the metadata note"},
+    {"--ver-fileVersion", "<version>", "Set the file version in the metadata note"},
+    {"--ver-productName", "<name>", "Set the product name in the metadata note"},
+    {"--ver-productVersion", "<version>", "Set the product version in the metadata note"},
+    {"--ver-string", "<Key=Value>", "Set any metadata string, may be repeated"},
+};
+
+// 生成 .note.ezi.metadata 的 JSON 内容，字段与 Windows 版本信息对应
+std::string BuildMetadata(ezi::builder::packager::AgrumentParser &parser, std::uint64_t assetSize, std::uint64_t assetHash)
+{
+    using namespace ezi::builder::packager;
+
+    std::string out = "{\"version\":1";
+    auto field = [&](const char *key, const std::string &value)
+    {
+        if (value.empty())
+            return;
+        out += ",";
+        json::AppendString(out, key);
+        out += ":";
+        json::AppendString(out, value);
+    };
+    field("productName", parser.getOptionValue("--ver-productName"));
+    field("productVersion", parser.getOptionValue("--ver-productVersion"));
+    field("fileVersion", parser.getOptionValue("--ver-fileVersion"));
+    field("companyName", parser.getOptionValue("--ver-companyName"));
+    field("fileDescription", parser.getOptionValue("--ver-fileDescription"));
+
+    auto strings = parser.getOptionValues("--ver-string");
+    if (!strings.empty())
+    {
+        out += ",\"strings\":{";
+        bool first = true;
+        for (auto &entry : strings)
+        {
+            auto equals = entry.find('=');
+            if (equals == std::string::npos || equals == 0)
+                utils::Fail("Invalid --ver-string, expected Key=Value: " + entry);
+            out += first ? "" : ",";
+            first = false;
+            json::AppendString(out, entry.substr(0, equals));
+            out += ":";
+            json::AppendString(out, entry.substr(equals + 1));
+        }
+        out += "}";
+    }
+
+    if (assetSize)
+    {
+        char hex[9];
+        std::snprintf(hex, sizeof(hex), "%08x", static_cast<unsigned>(assetHash));
+        out += ",\"assets\":{\"section\":";
+        json::AppendString(out, elf::AssetSectionName);
+        out += ",\"size\":" + std::to_string(assetSize) + ",\"alignment\":" + std::to_string(format::OverlayAlignment) + ",\"crc32c\":\"" + hex + "\"}";
+    }
+    out += "}";
+    return out;
+}
+
+// 执行一次打包，失败时抛出 utils::PackagerError
+int Package(ezi::builder::packager::AgrumentParser &parser)
+{
+    using namespace ezi::builder::packager;
+
+    auto &args = parser.arguments();
+
+    // 无参数或帮助信息
+    if (args.empty() || args[0] == "--help")
+    {
+        parser.printHelp();
+        return 0;
+    }
+
+    // 版本信息
+    if (args[0] == "--version")
+    {
+        parser.printVersion();
+        return 0;
+    }
+
+    // 输入程序文件
+    std::string inputPath = parser.getOptionValue("--input");
+    if (inputPath.empty())
+    {
+        throw utils::PackagerError("Input executable path is required.");
+    }
+    if (!std::filesystem::exists(inputPath))
+    {
+        throw utils::PackagerError("Input executable file does not exist.");
+    }
+    std::string outputPath = parser.getOptionValue("--output");
+    if (outputPath.empty())
+    {
+        outputPath = inputPath;
+    }
+
+    // 性能追踪，结束时写出 Chrome trace 与汇总
+    std::string tracePath = parser.getOptionValue("--trace");
+    std::string traceSummaryPath = parser.getOptionValue("--trace-summary");
+    if (!tracePath.empty() || !traceSummaryPath.empty())
+    {
+        trace::Recorder::Instance().enable();
+    }
+
+    // 准备ezi asset
+    std::shared_ptr<AssetBundle> bundle;
+    std::shared_ptr<MappedFile> assetFile;
+    std::string assetPath = parser.getOptionValue("--ezi-asset");
+    std::string assetDir = parser.getOptionValue("--ezi-asset-dir");
+    if (!assetDir.empty())
+    {
+        AssetBundleOptions options;
+        ReadAssetBundleOptions(parser, options);
+        bundle = AssetBundle::Build(options);
+        WriteAssetBundle(parser, *bundle);
+    }
+    else if (!assetPath.empty())
+    {
+        trace::Scope scope("read");
+        scope.detail(assetPath);
+        assetFile = MappedFile::OpenOrRead(assetPath);
+        scope.bytesIn(assetFile->bytes().size());
+    }
+
+    auto image = elf::Image::Load(inputPath);
+
+    // 资源追加为页对齐的 .ezi.assets 节，运行时可直接只读 mmap
+    std::uint64_t assetSize = 0;
+    std::uint64_t assetHash = 0;
+    if (bundle)
+    {
+        assetSize = bundle->size();
+        assetHash = bundle->contentHash();
+        image.setAssets(bundle->parts(), assetHash, bundle->sources());
+    }
+    else if (assetFile)
+    {
+        trace::Scope scope("hash", "phase", assetFile->bytes().size());
+        assetSize = assetFile->bytes().size();
+        assetHash = hash::Crc32c::Of(assetFile->bytes());
+        image.setAssets({assetFile->bytes()}, assetHash, {assetFile.get()});
+    }
+    if (assetSize)
+    {
+        std::cout << "Updating asset..." << std::endl;
+        trace::Count("assets", assetSize);
+    }
+
+    // 应用元数据写入 .note.ezi.metadata
+    auto metadata = BuildMetadata(parser, assetSize, assetHash);
+    trace::Count("versionInfo", metadata.size());
+    image.setMetadata(std::move(metadata));
+
+    // 一次写出到临时文件后原子替换输出，未修改的部分由内核按范围复制
+    auto written = image.save(outputPath);
+    trace::Recorder::Instance().output(outputPath, written);
+    std::cout << "Sections updated successfully." << std::endl;
+    std::cout << "Peak memory: " << utils::PeakResidentBytes() / 1024 << "KB" << std::endl;
+
+    if (!tracePath.empty())
+        trace::Recorder::Instance().writeChromeTrace(tracePath);
+    if (!traceSummaryPath.empty())
+        trace::Recorder::Instance().writeSummary(traceSummaryPath);
+    return 0;
+}
+
+int main(int argc, char *argv[])
+{
+    ezi::builder::packager::AgrumentParser parser(argc, argv, PackagerOptions);
+    try
+    {
+        return Package(parser);
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << error.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
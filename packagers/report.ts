@@ -0,0 +1,200 @@
+import * as fs from "fs";
+import chalk from "chalk";
+
+// 各平台打包器共用的构建报告
+
+export type Sizes = {
+    name: string;
+    size: number;
+    color?: string;
+}[];
+
+// 打包器 --trace-summary 输出的汇总
+export type PackagerSummary = {
+    totalMs: number;
+    peakRssBytes: number;
+    phases: {
+        name: string;
+        category: string;
+        calls: number;
+        ms: number;
+        bytesIn: number;
+        bytesOut: number;
+        allocations: number;
+        allocatedBytes: number;
+    }[];
+    counters: Record<string, number>;
+    outputs: { path: string; bytes: number }[];
+    warnings: string[];
+};
+
+export function readSummary(summaryPath: string): PackagerSummary | undefined {
+    try {
+        return JSON.parse(fs.readFileSync(summaryPath, 'utf-8')) as PackagerSummary;
+    } catch {
+        return undefined;
+    }
+}
+
+// 以打包器实际写入的字节为准，其余部分（可执行文件头、代码、节表与对齐）计入 core
+export function sizesFromSummary(summary: PackagerSummary, outAppPath: string): Sizes {
+    const counters = summary.counters;
+    const outputSize = summary.outputs[0]?.bytes ?? fs.statSync(outAppPath).size;
+    const assetsSize = counters['assets'] ?? 0;
+    const iconSize = counters['icon'] ?? 0;
+    const versionSize = counters['versionInfo'] ?? 0;
+    const Sizes: Sizes = [
+        {
+            name: 'eziapp-core',
+            size: Math.max(0, outputSize - assetsSize - iconSize - versionSize)
+        },
+        {
+            name: 'fontend-assets',
+            size: assetsSize
+        },
+        {
+            name: 'version-info',
+            size: versionSize
+        }
+    ];
+    if (iconSize) {
+        Sizes.push({
+            name: 'exe-icon',
+            size: iconSize
+        });
+    }
+    return Sizes;
+}
+
+export function printBuildReport(platform: string, Sizes: Sizes, outAppPath?: string, summary?: PackagerSummary) {
+
+    // 由大到小排序
+    Sizes.sort((a, b) => b.size - a.size);
+
+    // 随机设置颜色
+    const presetColors = [
+        '#e63946',
+        '#f1a208',
+        '#2a9d8f',
+        '#118ab2',
+        '#9900a7'
+    ];
+
+
+    function assignColors(Sizes: Sizes) {
+        const shuffled = presetColors
+            .map(c => ({ c, r: Math.random() }))
+            .sort((a, b) => a.r - b.r)
+            .map(x => x.c);
+
+        Sizes.forEach((item, idx) => {
+            item.color = shuffled[idx % shuffled.length];
+        });
+    }
+    assignColors(Sizes);
+
+    const totalSize = Sizes.reduce((sum, m) => sum + m.size, 0);
+
+    const puts = (str: string) => {
+        process.stdout.write(str);
+    };
+
+    // 打印标题
+    puts(chalk.bold('\n═ Build Report ════════════════════\n\n'));
+
+    puts(`Platform: ${platform}\n`);
+    puts('Build Date: ' + new Date().toLocaleString() + '\n');
+    const warnings = summary?.warnings ?? [];
+    const status = `0 error(s), ${warnings.length} warning(s)\n`;
+    puts('Status: ' + (warnings.length ? chalk.yellow.bold(status) : chalk.green.bold(status)));
+    warnings.forEach(warning => puts(chalk.yellow(`  ⚠ ${warning}\n`)));
+    if (outAppPath) {
+        puts(`Output: ` + chalk.bold(outAppPath) + `\n`);
+    }
+
+    // 绘制占比进度条
+    const barLength = 35;
+    puts(chalk.bold('─'.repeat(barLength)));
+    puts('\n');
+    Sizes.forEach(m => {
+        const percent = m.size / totalSize;
+        const blocks = Math.round(percent * barLength);
+        puts(chalk.hex(m.color || '#ffffff').bold('█'.repeat(blocks)));
+    });
+    puts('\n');
+
+    // 打印模块表格
+
+    const header =
+        '─ Module '.padEnd(19, '─') +
+        ' Size '.padEnd(12, '─') +
+        ' Pct ';
+    puts(chalk.bold(header) + '\n');
+
+    Sizes.forEach(m => {
+        const percent = ((m.size / totalSize) * 100).toFixed(0) + '%';
+        const sizeKB = (m.size / 1024).toFixed(0) + 'KB';
+
+        const line =
+            chalk.hex(m.color || '#ffffff').bold(('■ ' + m.name).padEnd(20)) +
+            sizeKB.padEnd(12) +
+            percent;
+
+        puts(line + '\n');
+    });
+
+    puts(chalk.bold('─'.repeat(barLength)));
+    puts('\n');
+    puts((`Total size: `) + chalk.bold(`${(totalSize / 1024).toFixed(0)}KB\n`));
+    if (!summary) {
+        puts(chalk.bold('─'.repeat(barLength)));
+        puts('\n');
+        return;
+    }
+
+    // 资源压缩率
+    const rawSize = summary.counters['assets.rawBytes'];
+    const storedSize = summary.counters['assets.storedBytes'];
+    if (rawSize) {
+        const saved = Math.max(0, (1 - storedSize / rawSize) * 100).toFixed(0);
+        puts(`Assets: ${(rawSize / 1024).toFixed(0)}KB → ` + chalk.bold(`${(storedSize / 1024).toFixed(0)}KB`) + ` (↓ ${saved}%)\n`);
+    }
+
+    // 按启动访问记录排列后，冷启动需要读取的页数
+    const startupPages = summary.counters['assets.startupPages'];
+    if (startupPages) {
+        const unordered = summary.counters['assets.startupPagesUnordered'];
+        puts(`Startup: ${summary.counters['assets.startupAssets']} assets in ` + chalk.bold(`${startupPages} pages`) +
+            `, ${summary.counters['assets.startupRuns']} reads (${unordered} pages unordered)\n`);
+    }
+
+    // 资源读取吞吐与同时进行的读取数
+    const readRate = summary.counters['assets.readFilesPerSecond'];
+    if (readRate) {
+        puts(`Read: ` + chalk.bold(`${readRate} files/s`) + `, up to ${summary.counters['assets.readMaxInFlight']} in flight` +
+            ` (avg ${summary.counters['assets.readAverageInFlight']})\n`);
+    }
+
+    // 各阶段耗时，多线程阶段为所有线程耗时之和
+    const phaseHeader =
+        '─ Phase '.padEnd(19, '─') +
+        ' Time '.padEnd(12, '─') +
+        ' Data ';
+    puts(chalk.bold(phaseHeader) + '\n');
+    summary.phases
+        .filter(phase => phase.category === 'phase')
+        .forEach(phase => {
+            const bytes = Math.max(phase.bytesIn, phase.bytesOut);
+            const line =
+                ('  ' + phase.name).padEnd(20) +
+                `${phase.ms.toFixed(0)}ms`.padEnd(12) +
+                (bytes ? `${(bytes / 1024).toFixed(0)}KB` : '');
+            puts(line + '\n');
+        });
+    puts(chalk.bold('─'.repeat(barLength)));
+    puts('\n');
+    puts(`Packaging time: ` + chalk.bold(`${summary.totalMs.toFixed(0)}ms`) +
+        `, peak memory: ` + chalk.bold(`${(summary.peakRssBytes / 1048576).toFixed(0)}MB\n`));
+    puts(chalk.bold('─'.repeat(barLength)));
+    puts('\n');
+}
@@ -1,16 +1,63 @@
 import * as fs from "fs";
 import * as path from "path";
-import { execSync } from "child_process";
+import { execFileSync } from "child_process";
 import chalk from "chalk";
+import { PackagerSummary, Sizes, printBuildReport, readSummary, sizesFromSummary } from "../report";
+
+// 打包器的 Node 原生扩展（src/packager_addon.cpp），在 libuv 线程池中进程内打包
+type PackagerAddon = {
+    apiVersion(): number;
+    run(args: string[]): Promise<void>;
+    package(options: {
+        input: string;
+        output?: string;
+        icon?: Buffer;
+        assets?: {
+            assetDir: string;
+            config: Buffer | string;
+            packageName?: string;
+            cacheDir?: string;
+            threads?: number;
+            binaryIndex?: boolean;
+            accessProfile?: string[];
+            accessBlockSize?: number;
+        };
+        asset?: Buffer;
+        overlay?: boolean;
+        version?: {
+            companyName?: string;
+            fileDescription?: string;
+            fileVersion?: string;
+            productName?: string;
+            productVersion?: string;
+            fileVersionParts?: string;
+            productVersionParts?: string;
+            languages?: string;
+            strings?: string[];
+        };
+        summary?: boolean;
+    }): Promise<string | undefined>;
+};
+
+// 访问记录为资源 id 数组，或包含 assets 数组的对象，与打包器 --access-profile 的格式一致
+function readAccessProfile(profilePath: string): string[] {
+    const profile = JSON.parse(fs.readFileSync(profilePath, 'utf-8'));
+    return Array.isArray(profile) ? profile : profile.assets;
+}
 
-type Sizes = {
-    name: string;
-    size: number;
-    color?: string;
-}[];
+// 扩展不存在或与当前 Node 不兼容时返回 undefined，改为调用命令行打包器
+function loadAddon(addonPath: string): PackagerAddon | undefined {
+    try {
+        const addon = require(addonPath) as PackagerAddon;
+        return addon.apiVersion() === 2 ? addon : undefined;
+    } catch {
+        return undefined;
+    }
+}
 
 class windowsPackager {
     private packagerBinPath = path.join(__dirname, "../../bin/eziapp-packager-winx64.exe");
+    private packagerAddonPath = path.join(__dirname, "../../bin/eziapp-packager-winx64.node");
     private eziappBinPath = path.join(__dirname, "../../bin/eziapp-npm-release-winx64.exe");
     private argv: string[] = [];
     private eziConfig: any;
@@ -30,38 +77,68 @@ class windowsPackager {
         console.log(chalk.green("✓ packaging for windows..."));
         const appName = this.eziConfig?.application?.name || "EziApp";
 
-        // 复制到输出目录
+        // 输出目录，打包器直接读取基础程序并一次写出最终程序，不再预先复制
         const outAppPath = path.join(this.outDir, `${appName}_winx64.exe`);
         if (!fs.existsSync(this.outDir)) {
             fs.mkdirSync(this.outDir, { recursive: true });
         }
 
-        try {
-            fs.copyFileSync(this.eziappBinPath, outAppPath);
-        } catch (error) {
-            // 如果是因为占用导致的失败，提示用户关闭正在运行的应用
-            if ((error as any).code === 'EBUSY') {
-                console.error(chalk.red(`✗ 应用 ${appName} 正忙碌中，请关闭正在运行的应用 ${appName} 后重试。`));
-                process.exit(1);
+        // 输出经临时文件原子替换，先检查上次的程序是否仍在运行
+        if (fs.existsSync(outAppPath)) {
+            try {
+                fs.closeSync(fs.openSync(outAppPath, 'r+'));
+            } catch (error) {
+                // 如果是因为占用导致的失败，提示用户关闭正在运行的应用
+                if ((error as any).code === 'EBUSY' || (error as any).code === 'EPERM') {
+                    console.error(chalk.red(`✗ 应用 ${appName} 正忙碌中，请关闭正在运行的应用 ${appName} 后重试。`));
+                    process.exit(1);
+                }
+                throw error;
             }
-            throw error;
         }
 
         // 输入程序参数
-        this.argv.push(...['--input', outAppPath]);
-
-        // 打包ezi资源参数
-        this.argv.push(...['--ezi-asset', path.join(this.tempDir, 'ezi.assets.binary')]);
+        this.argv.push(...['--input', this.eziappBinPath]);
+        this.argv.push(...['--output', outAppPath]);
+
+        // 打包ezi资源参数，由打包器多线程压缩资源目录
+        const assetsDir = path.join(process.cwd(), this.eziConfig.application.buildEntry || "dist");
+        this.argv.push(...['--ezi-asset-dir', assetsDir]);
+        this.argv.push(...['--ezi-config', path.join(this.tempDir, 'ezi.config.manifest.json')]);
+        this.argv.push(...['--ezi-package', this.eziConfig?.application?.package || "com.ezi.app"]);
+        // 压缩缓存，未修改的资源直接复用上次的压缩结果
+        this.argv.push(...['--cache-dir', path.join(process.cwd(), 'node_modules', '.eziapp', 'cache')]);
+
+        // 启动访问记录：开发运行时记录的资源读取顺序，启动所需资源排在资源包最前面
+        const accessProfile = this.eziConfig?.application?.accessProfile;
+        const accessProfilePath = accessProfile ? path.join(process.cwd(), accessProfile) : undefined;
+        if (accessProfilePath) {
+            this.argv.push(...['--access-profile', accessProfilePath]);
+        }
+        // 可选：把最先读取的资源合并压缩为一个共享块，单位 KB
+        const accessBlock = this.eziConfig?.application?.accessBlock;
+        if (accessBlock) {
+            this.argv.push(...['--access-block', String(accessBlock)]);
+        }
 
-        // 打包图标参数
-        const iconPath = path.join(this.tempDir, 'eziapp.ico');
-        if (fs.existsSync(iconPath)) {
-            this.argv.push(...['--icon', iconPath]);
+        // 打包图标参数，PNG 由打包器原生生成多尺寸图标并写出到临时目录
+        let iconPath = path.join(this.tempDir, 'eziapp.ico');
+        fs.rmSync(iconPath, { force: true });
+        const iconSource = this.eziConfig?.application?.icon;
+        if (iconSource) {
+            const iconSourcePath = path.join(process.cwd(), 'public', iconSource);
+            if (path.extname(iconSourcePath).toLowerCase() === '.ico') {
+                iconPath = iconSourcePath;
+                this.argv.push(...['--icon', iconSourcePath]);
+            } else {
+                this.argv.push(...['--icon-png', iconSourcePath, '--icon-out', iconPath]);
+            }
         }
 
         // 打包版本参数
 
         this.argv.push(...['--ver-productName', appName]);
+        this.argv.push(...['--ver-languages', 'zh-CN,en-US']);
 
         const version = this.eziConfig?.application?.version;
         if (version) {
@@ -77,121 +154,87 @@ class windowsPackager {
             this.argv.push(...['--ver-fileDescription', description]);
         }
 
+        // 打包器输出各阶段耗时与实际写入的各部分大小，用于构建报告
+        const summaryPath = path.join(this.tempDir, 'packager.summary.json');
+        fs.rmSync(summaryPath, { force: true });
+        this.argv.push(...['--trace-summary', summaryPath]);
+        // 设置 EZIAPP_PACKAGER_TRACE=<file> 时额外输出 Chrome trace，可在 chrome://tracing 或 Perfetto 中查看
+        const tracePath = process.env.EZIAPP_PACKAGER_TRACE;
+        if (tracePath) {
+            this.argv.push(...['--trace', path.resolve(tracePath)]);
+        }
+
+        const addon = loadAddon(this.packagerAddonPath);
+        let summary: PackagerSummary | undefined;
         try {
-            // 开始打包
-            const packagerCmd = `"${this.packagerBinPath}" --update-version true ${this.argv.join(' ')}`;
-            execSync(packagerCmd, { stdio: 'inherit' });
+            // 开始打包：优先进程内调用，配置与图标直接以内存数据传入
+            // 需要 Chrome trace 时仍走完整的命令行参数，由扩展在进程内执行
+            const args = ['--update-version', 'true', ...this.argv];
+            if (addon && !tracePath) {
+                const summaryJson = await addon.package({
+                    input: this.eziappBinPath,
+                    output: outAppPath,
+                    icon: iconSource ? fs.readFileSync(path.join(process.cwd(), 'public', iconSource)) : undefined,
+                    assets: {
+                        assetDir: assetsDir,
+                        config: JSON.stringify(this.eziConfig),
+                        packageName: this.eziConfig?.application?.package || "com.ezi.app",
+                        cacheDir: path.join(process.cwd(), 'node_modules', '.eziapp', 'cache'),
+                        accessProfile: accessProfilePath ? readAccessProfile(accessProfilePath) : undefined,
+                        accessBlockSize: accessBlock ? accessBlock * 1024 : undefined,
+                    },
+                    version: {
+                        productName: appName,
+                        languages: 'zh-CN,en-US',
+                        productVersion: version,
+                        fileVersion: version,
+                        companyName: companyName,
+                        fileDescription: description,
+                    },
+                    summary: true,
+                });
+                summary = summaryJson ? JSON.parse(summaryJson) as PackagerSummary : undefined;
+            } else if (addon) {
+                await addon.run(args);
+                summary = readSummary(summaryPath);
+            } else {
+                // 参数逐个传递，不经过 shell，路径与名称中的空格和引号无需转义
+                execFileSync(this.packagerBinPath, args, { stdio: 'inherit' });
+                summary = readSummary(summaryPath);
+            }
             console.log(chalk.green("✓ packaging completed:\n" + outAppPath));
         } catch (error) {
+            // 失败时输出文件保持不变，只清理残留的临时文件
             console.error(error);
-            fs.unlinkSync(outAppPath);
+            fs.rmSync(`${outAppPath}.tmp`, { force: true });
             process.exit(1);
         }
 
         // Build Report
-        const Sizes = [
-            {
-                name: 'eziapp-core',
-                size: fs.statSync(this.eziappBinPath).size
-            },
-            {
-                name: 'fontend-assets',
-                size: fs.statSync(path.join(this.tempDir, 'ezi.assets.binary')).size
-            },
-            {
-                name: 'exe-icon',
-                size: fs.existsSync(iconPath) ? fs.statSync(iconPath).size : 0
-            },
-            {
-                name: 'extensions',
-                size: 0
-            }
-        ];
-        const appRelativePath = path.relative(process.cwd(), outAppPath);
-        this.printBuildReport(Sizes, appRelativePath);
-
-    }
-
-    public printBuildReport(Sizes: Sizes, outAppPath?: string) {
-
-        // 由大到小排序
-        Sizes.sort((a, b) => b.size - a.size);
-
-        // 随机设置颜色
-        const presetColors = [
-            '#e63946',
-            '#f1a208',
-            '#2a9d8f',
-            '#118ab2',
-            '#9900a7'
-        ];
-
-
-        function assignColors(Sizes: Sizes) {
-            const shuffled = presetColors
-                .map(c => ({ c, r: Math.random() }))
-                .sort((a, b) => a.r - b.r)
-                .map(x => x.c);
-
-            Sizes.forEach((item, idx) => {
-                item.color = shuffled[idx % shuffled.length];
-            });
-        }
-        assignColors(Sizes);
-
-        const totalSize = Sizes.reduce((sum, m) => sum + m.size, 0);
-
-        const puts = (str: string) => {
-            process.stdout.write(str);
-        };
-
-        // 打印标题
-        puts(chalk.bold('\n═ Build Report ════════════════════\n\n'));
-
-        puts('Platform: Windows x64\n');
-        puts('Build Date: ' + new Date().toLocaleString() + '\n');
-        puts('Status: ' + chalk.green.bold('0 error(s), 0 warning(s)\n'));
-        if (outAppPath) {
-            puts(`Output: ` + chalk.bold(outAppPath) + `\n`);
+        let Sizes: Sizes;
+        if (summary) {
+            Sizes = sizesFromSummary(summary, outAppPath);
+        } else {
+            const coreSize = fs.statSync(this.eziappBinPath).size;
+            const iconSize = fs.existsSync(iconPath) ? fs.statSync(iconPath).size : 0;
+            Sizes = [
+                {
+                    name: 'eziapp-core',
+                    size: coreSize
+                },
+                {
+                    name: 'fontend-assets',
+                    size: Math.max(0, fs.statSync(outAppPath).size - coreSize - iconSize)
+                },
+                {
+                    name: 'exe-icon',
+                    size: iconSize
+                }
+            ];
         }
+        const appRelativePath = path.relative(process.cwd(), outAppPath);
+        printBuildReport('Windows x64', Sizes, appRelativePath, summary);
 
-        // 绘制占比进度条
-        const barLength = 35;
-        puts(chalk.bold('─'.repeat(barLength)));
-        puts('\n');
-        Sizes.forEach(m => {
-            const percent = m.size / totalSize;
-            const blocks = Math.round(percent * barLength);
-            puts(chalk.hex(m.color || '#ffffff').bold('█'.repeat(blocks)));
-        });
-        puts('\n');
-
-        // 打印模块表格
-
-        const header =
-            '─ Module '.padEnd(19, '─') +
-            ' Size '.padEnd(12, '─') +
-            ' Pct ';
-        puts(chalk.bold(header) + '\n');
-
-        Sizes.forEach(m => {
-            const percent = ((m.size / totalSize) * 100).toFixed(0) + '%';
-            const sizeKB = (m.size / 1024).toFixed(0) + 'KB';
-
-            const line =
-                chalk.hex(m.color || '#ffffff').bold(('■ ' + m.name).padEnd(20)) +
-                sizeKB.padEnd(12) +
-                percent;
-
-            puts(line + '\n');
-        });
-
-        puts(chalk.bold('─'.repeat(barLength)));
-        puts('\n');
-        puts((`Total size: `) + chalk.bold(`${(totalSize / 1024).toFixed(0)}KB\n`));
-        puts(`UPX: ` + chalk.bold('disabled') + ` (↓ 0%)\n`);
-        puts(chalk.bold('─'.repeat(barLength)));
-        puts('\n');
     }
 }
 
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "utils.hpp"
+#include "json.hpp"
+#include "mapped_file.hpp"
+#include "asset_format.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ezi::builder::packager
+{
+    // Asset ids in the order the app first read them during a recorded startup, as a JSON array of strings or
+    // an object with such an "assets" array. Ids are either full asset ids ("https://<package>/<path>") or
+    // paths relative to the asset directory.
+    inline std::vector<std::string> ReadAccessProfile(const std::filesystem::path &path)
+    {
+        auto file = MappedFile::Open(path);
+        auto text = file->bytes();
+        auto document = json::Parser(std::string_view(reinterpret_cast<const char *>(text.data()), text.size()), path.string()).parse();
+        auto list = document.isObject() ? document.find("assets") : &document;
+        if (!list || !list->array())
+            utils::Fail("Access profile must be a JSON array of asset ids: " + path.string());
+        std::vector<std::string> ids;
+        for (auto &item : *list->array())
+        {
+            if (!item.string())
+                utils::Fail("Access profile entries must be strings: " + path.string());
+            ids.push_back(*item.string());
+        }
+        return ids;
+    }
+
+    // The part of an asset id that names the file: the path after the scheme and host of a URL, without a
+    // query, fragment or leading '/'. Ids that are not URLs, such as "ezi.config.manifest", are kept.
+    inline std::string_view AccessProfilePath(std::string_view id)
+    {
+        for (std::string_view scheme : {"https://", "http://"})
+        {
+            if (id.starts_with(scheme))
+            {
+                auto path = id.find('/', scheme.size());
+                id = path == std::string_view::npos ? std::string_view() : id.substr(path);
+                break;
+            }
+        }
+        id = id.substr(0, id.find_first_of("?#"));
+        while (id.starts_with('/'))
+            id.remove_prefix(1);
+        return id;
+    }
+
+    struct PageCount
+    {
+        std::uint64_t bytes = 0; // stored bytes of the distinct ranges
+        std::uint64_t pages = 0; // distinct pages touched
+        std::uint64_t runs = 0;  // contiguous page runs, i.e. the seeks of a cold read in file order
+    };
+
+    // Pages of size format::OverlayAlignment that reading the stored [offset, offset + size) ranges touches.
+    // Offsets are relative to the bundle, which overlay mode and the ELF section place on a page boundary.
+    inline PageCount CountPages(std::vector<std::pair<std::uint64_t, std::uint64_t>> ranges)
+    {
+        constexpr std::uint64_t page = format::OverlayAlignment;
+        std::sort(ranges.begin(), ranges.end());
+        ranges.erase(std::unique(ranges.begin(), ranges.end()), ranges.end());
+
+        PageCount count;
+        std::uint64_t nextPage = 0; // first page after the last counted one
+        for (auto [offset, size] : ranges)
+        {
+            if (!size)
+                continue;
+            count.bytes += size;
+            auto first = offset / page;
+            auto end = (offset + size + page - 1) / page;
+            if (first >= nextPage)
+            {
+                if (!count.pages || first > nextPage)
+                    ++count.runs;
+                count.pages += end - first;
+                nextPage = end;
+            }
+            else if (end > nextPage)
+            {
+                count.pages += end - nextPage;
+                nextPage = end;
+            }
+        }
+        return count;
+    }
+}
@@ -0,0 +1,195 @@
+#pragma once
+
+#include "asset_bundle.hpp"
+#include "utils.hpp"
+#include <algorithm>
+#include <charconv>
+#include <iomanip>
+#include <iostream>
+#include <optional>
+#include <string>
+#include <utility>
+#include <vector>
+
+// Command line handling shared by the platform packagers, each passes its own option table.
+namespace ezi::builder::packager
+{
+    struct Option
+    {
+        std::string name;
+        std::string parameter;
+        std::string description;
+    };
+
+    class AgrumentParser
+    {
+    private:
+        std::vector<std::string> args; // without the program name
+        std::vector<Option> options;
+
+    public:
+        AgrumentParser(int argc, char **argv, std::vector<Option> options)
+            : args(argv + std::min(argc, 1), argv + argc), options(std::move(options)) {}
+        AgrumentParser(std::vector<std::string> args, std::vector<Option> options) : args(std::move(args)), options(std::move(options)) {}
+
+    public:
+        const std::vector<std::string> &arguments() const { return args; }
+
+        void printHelp()
+        {
+            printVersion();
+            std::cout << "Usage: packager [options]\nOptions:\n";
+            size_t maxLen = 0;
+            for (auto &opt : options)
+            {
+                std::string label = opt.parameter.empty() ? opt.name : (opt.name + " " + opt.parameter);
+                if (label.size() > maxLen)
+                    maxLen = label.size();
+            }
+
+            for (auto &opt : options)
+            {
+                std::string label = opt.parameter.empty() ? opt.name : (opt.name + " " + opt.parameter);
+                std::cout << "  " << std::left << std::setw(maxLen + 2) << label << opt.description << "\n";
+            }
+        }
+
+        void printVersion()
+        {
+            std::cout << "EziApp Builder Packager Version 0.0.0\n";
+        }
+
+        std::string getOptionValue(const std::string &optionName)
+        {
+            auto values = getOptionValues(optionName);
+            return values.empty() ? "" : values.front();
+        }
+
+        // Every occurrence of a repeatable option, in command line order. The value is the single token after
+        // the option, so callers that pass an argument vector need no quoting for spaces or quotes; an option
+        // followed by another option or by nothing has an empty value.
+        std::vector<std::string> getOptionValues(const std::string &optionName)
+        {
+            std::vector<std::string> values;
+            for (size_t i = 0; i < args.size(); ++i)
+            {
+                if (args[i] == optionName)
+                {
+                    bool hasValue = i + 1 < args.size() && args[i + 1].rfind("--", 0) != 0;
+                    values.push_back(hasValue ? args[i + 1] : "");
+                }
+            }
+            return values;
+        }
+
+        // The option's value as a decimal number, or nothing when the option is absent; anything else in the value
+        // is a PackagerError naming the option.
+        std::optional<std::uint64_t> getNumberValue(const std::string &optionName)
+        {
+            std::string text = getOptionValue(optionName);
+            if (text.empty())
+                return std::nullopt;
+            std::uint64_t value = 0;
+            auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+            if (error != std::errc() || end != text.data() + text.size())
+            {
+                throw utils::PackagerError("Invalid " + optionName + " value: " + text);
+            }
+            return value;
+        }
+    };
+
+    // Reads the --ezi-asset-dir family of options; throws a PackagerError for the first invalid one.
+    inline void ReadAssetBundleOptions(AgrumentParser &parser, AssetBundleOptions &options)
+    {
+        options.assetDir = parser.getOptionValue("--ezi-asset-dir");
+        options.configPath = parser.getOptionValue("--ezi-config");
+        if (options.configPath.empty())
+        {
+            throw utils::PackagerError("--ezi-config is required with --ezi-asset-dir.");
+        }
+        std::string packageName = parser.getOptionValue("--ezi-package");
+        if (!packageName.empty())
+        {
+            options.packageName = packageName;
+        }
+        if (auto threads = parser.getNumberValue("--threads"))
+        {
+            options.threads = static_cast<size_t>(*threads);
+        }
+        if (auto ioDepth = parser.getNumberValue("--io-depth"))
+        {
+            options.ioDepth = std::max<size_t>(static_cast<size_t>(*ioDepth), 1);
+        }
+        std::string ioBackend = parser.getOptionValue("--io-backend");
+        if (ioBackend == "threads")
+        {
+            options.ioBackend = ReadBackend::Threads;
+        }
+        else if (!ioBackend.empty() && ioBackend != "auto")
+        {
+            throw utils::PackagerError("Unknown --io-backend value: " + ioBackend);
+        }
+        options.cacheDir = parser.getOptionValue("--cache-dir");
+        options.dictionaryPath = parser.getOptionValue("--zstd-dict");
+        options.trainDictionary = parser.getOptionValue("--train-dict") == "true";
+        options.dictionaryReport = parser.getOptionValue("--dict-report") == "true";
+        std::string storeRaw = parser.getOptionValue("--store-raw");
+        if (storeRaw == "auto")
+        {
+            options.storeRaw = true;
+        }
+        else if (!storeRaw.empty() && storeRaw != "never")
+        {
+            throw utils::PackagerError("Unknown --store-raw value: " + storeRaw);
+        }
+        // off unless given: a runtime sizing its output from the first frame only decodes the first chunk
+        if (auto chunkThreshold = parser.getNumberValue("--chunk-threshold"))
+        {
+            options.chunkThreshold = *chunkThreshold * 1024;
+        }
+        if (auto chunkSize = parser.getNumberValue("--chunk-size"))
+        {
+            auto kilobytes = *chunkSize;
+            // chunk sizes and their compressed bounds must fit the seek table's 32-bit fields
+            if (kilobytes < 4 || kilobytes > (1u << 20))
+            {
+                throw utils::PackagerError("--chunk-size must be between 4 and 1048576 KB.");
+            }
+            options.chunkSize = static_cast<std::uint32_t>(kilobytes * 1024);
+        }
+        std::string accessProfile = parser.getOptionValue("--access-profile");
+        if (!accessProfile.empty())
+        {
+            options.accessProfile = ReadAccessProfile(accessProfile);
+        }
+        if (auto accessBlock = parser.getNumberValue("--access-block"))
+        {
+            options.accessBlockSize = *accessBlock * 1024;
+        }
+        std::string indexName = parser.getOptionValue("--asset-index");
+        if (indexName == "binary")
+        {
+            options.index = format::IndexKind::Binary;
+        }
+        else if (!indexName.empty() && indexName != "json")
+        {
+            throw utils::PackagerError("Unknown asset index: " + indexName);
+        }
+    }
+
+    // Writes the bundle to --ezi-asset-out when given.
+    inline void WriteAssetBundle(AgrumentParser &parser, const AssetBundle &bundle)
+    {
+        std::string bundleOut = parser.getOptionValue("--ezi-asset-out");
+        if (bundleOut.empty())
+            return;
+        std::ofstream out(bundleOut, std::ios::binary | std::ios::trunc);
+        for (auto &part : bundle.parts())
+            out.write(reinterpret_cast<const char *>(part.data()), part.size());
+        if (!out)
+        {
+            throw utils::PackagerError("Failed to write asset bundle.");
+        }
+    }
+}
@@ -0,0 +1,915 @@
+#pragma once
+
+#include "utils.hpp"
+#include "json.hpp"
+#include "hash.hpp"
+#include "mapped_file.hpp"
+#include "compression_cache.hpp"
+#include "asset_format.hpp"
+#include "asset_index.hpp"
+#include "zstd_codec.hpp"
+#include "trace.hpp"
+#include "thread_pool.hpp"
+#include "compressibility.hpp"
+#include "access_profile.hpp"
+#include "asset_reader.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <zstd.h>
+
+namespace ezi::builder::packager
+{
+    struct AssetBundleOptions
+    {
+        std::filesystem::path assetDir;
+        std::filesystem::path configPath;
+        std::string config; // the config json itself, used instead of configPath when not empty
+        std::string packageName = "com.ezi.app";
+        int compressionLevel = ZSTD_CLEVEL_DEFAULT;
+        size_t threads = 0;
+        size_t ioDepth = 64; // asset reads kept in flight while collecting
+        ReadBackend ioBackend = ReadBackend::Auto;
+        std::filesystem::path cacheDir; // empty disables the compression cache
+        format::IndexKind index = format::IndexKind::Json;
+        std::filesystem::path dictionaryPath; // use this zstd dictionary for small assets
+        bool trainDictionary = false;         // or train one over the bundle's small assets
+        std::uint64_t dictionaryMaxFileSize = 128 << 10;
+        bool dictionaryReport = false;
+        bool storeRaw = false; // store already compressed or high-entropy files as is, needs a runtime reading "codec"
+        std::uint64_t chunkThreshold = 0;       // files above this are split into seekable chunks, 0 never; opt-in like storeRaw
+        std::uint32_t chunkSize = 1 << 20;      // uncompressed bytes per chunk
+        std::vector<std::string> accessProfile; // asset ids in startup read order, laid out first
+        std::uint64_t accessBlockSize = 0;      // compress the first profiled assets up to this size as one frame
+    };
+
+    // The ezi.assets.binary layout:
+    //   [config frame][asset frames...][dictionary][page-aligned raw assets...][manifest frame][u32 LE manifest frame size]
+    // every frame is an independent zstd frame, the manifest is JSON mapping asset ids to {offset, size}.
+    // Files with identical content share one frame, their manifest entries point at the same offset.
+    // With AssetBundleOptions::storeRaw, incompressible files are stored as is and marked "codec":"raw"; those of
+    // at least a page start on a page boundary of the bundle so the runtime can hand out the mapped bytes directly.
+    // When a dictionary is used it is stored once, raw, as "ezi.zstd.dictionary" after the asset frames and
+    // every frame compressed with it carries "dict":<dictionary id> in its manifest entry.
+    // Files above AssetBundleOptions::chunkThreshold are compressed as chunkSize pieces in independent frames,
+    // followed by a zstd seekable-format seek table; their entries add "chunkSize" and "chunks" (the compressed
+    // size of every chunk) so a range read only decodes the chunks it covers.
+    // With an access profile the frames of the listed assets follow the config frame in the order they are first
+    // read, preceded by the dictionary when any of them needs it, so a cold start reads one contiguous range.
+    // With accessBlockSize the leading profiled assets share one zstd frame instead; their entries are
+    // "codec":"block" with the "blockOffset" of their bytes in the decoded frame.
+    // With IndexKind::Binary the JSON manifest and its size are replaced by
+    //   [padding to 8][format::IndexHeader ...][format::IndexTrailer]
+    class AssetBundle
+    {
+    public:
+        struct Entry
+        {
+            std::string id;
+            std::uint64_t offset;
+            std::uint64_t size;
+            std::uint64_t rawSize;
+            format::Codec codec = format::Codec::Zstd;
+            std::uint32_t dictionaryId = 0;
+            std::uint32_t crc32c = 0; // of the stored bytes
+            std::uint32_t chunkSize = 0; // uncompressed bytes per chunk, 0 for a single frame
+            std::vector<std::uint32_t> chunks; // compressed size of each chunk
+            std::uint64_t blockOffset = 0; // in the decoded frame, format::Codec::ZstdBlock only
+        };
+
+    private:
+        struct Frame
+        {
+            std::vector<std::byte> data;
+            std::shared_ptr<MappedFile> file; // raw assets are written straight from their source mapping
+            format::Codec codec = format::Codec::Zstd;
+            std::optional<std::uint32_t> crc32c;
+            std::vector<SeekTableEntry> chunks; // set when split into seekable chunks
+
+            Frame() = default;
+            explicit Frame(std::vector<std::byte> data, format::Codec codec = format::Codec::Zstd) : data(std::move(data)), codec(codec) {}
+
+            std::span<const std::byte> bytes() const { return file ? file->bytes() : std::span<const std::byte>(data); }
+            std::uint64_t size() const { return bytes().size(); }
+        };
+
+        std::vector<Frame> frames;
+        std::vector<Entry> entries;
+        std::uint64_t totalSize = 0;
+        mutable std::once_flag hashOnce;
+        mutable std::uint64_t payloadHash = 0;
+
+        struct Source
+        {
+            hash::Digest128 digest;
+            std::uint64_t size = 0;
+            size_t frame = 0;
+            bool useDictionary = false;
+            bool raw = false;
+            bool chunked = false;
+            bool inBlock = false;
+            std::uint64_t blockOffset = 0;
+        };
+
+        // What the steps of Build hand on to each other. Until layOut, frames are in build order: the config
+        // frame, one frame per distinct content (owners[u] owns frame 1 + u), then the startup block if any.
+        struct BuildState
+        {
+            const AssetBundleOptions &options;
+            std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+            ThreadPool pool;
+            std::optional<CompressionCache> cache;
+            std::vector<AssetFile> files;
+            std::vector<Source> sources; // parallel to files
+            std::uint64_t configSize = 0;
+
+            // the first buffered files, up to a few MB per thread, stay in memory until compressed; the others
+            // are dropped once hashed and mapped again, so memory does not grow with the asset directory
+            std::vector<std::shared_ptr<MappedFile>> loaded;
+            std::atomic<std::uint64_t> retained{0};
+            std::uint64_t retainBudget = 0;
+
+            std::vector<size_t> owners; // first file of each distinct content, in walk order
+            std::shared_ptr<ZstdDictionary> dictionary;
+            size_t dictionaryFrame = 0;
+            std::vector<size_t> startup; // owner indices in first-read order
+            std::vector<size_t> startupFrames;
+            bool startupDictionary = false;
+            std::vector<bool> blockMember; // per owner, compressed into the startup block
+            size_t blockFrame = 0;
+            std::uint64_t blockRawSize = 0;
+
+            // per frame in build order, filled by layOut
+            std::vector<std::uint64_t> frameOffsets;
+            std::vector<std::uint64_t> frameSizes;
+            std::vector<format::Codec> frameCodecs;
+            std::vector<std::uint32_t> frameCrcs;
+            std::vector<std::vector<std::uint32_t>> frameChunks;
+            std::uint64_t payloadSize = 0; // of the laid out frames, the index follows
+            std::optional<PageCount> startupPages, walkPages;
+
+            std::uint64_t rawBytes = 0;
+            size_t duplicates = 0;
+            size_t rawFiles = 0;
+            std::uint64_t rawStored = 0;
+            size_t chunkedCount = 0;
+            size_t chunkCount = 0;
+
+            explicit BuildState(const AssetBundleOptions &options) : options(options), pool(options.threads) {}
+
+            std::shared_ptr<MappedFile> load(size_t i) { return loaded[i] ? loaded[i] : MappedFile::Open(files[i].path); }
+            std::shared_ptr<MappedFile> take(size_t i) { return loaded[i] ? std::move(loaded[i]) : MappedFile::Open(files[i].path); }
+
+            std::string chunkKey(const Source &source) const
+            {
+                return CompressionCache::Key(source.digest, source.size, options.compressionLevel, 0, options.chunkSize);
+            }
+        };
+
+        void scan(BuildState &state)
+        {
+            trace::Scope scope("scan");
+            state.files = CollectAssetFiles(state.options.assetDir, state.pool);
+        }
+
+        void compressConfig(BuildState &state)
+        {
+            auto &options = state.options;
+            trace::Scope scope("compress", "asset");
+            scope.detail("ezi.config.manifest");
+            auto config = options.config.empty() ? MappedFile::Open(options.configPath) : nullptr;
+            auto configBytes = config ? config->bytes() : std::as_bytes(std::span(options.config));
+            state.configSize = configBytes.size();
+            frames.resize(1);
+            frames[0].data = CompressFrame(configBytes, options.compressionLevel);
+            scope.bytesIn(state.configSize);
+            scope.bytesOut(frames[0].size());
+        }
+
+        // Hashes every file as soon as it is read and decides whether it is stored raw.
+        void read(BuildState &state)
+        {
+            auto &options = state.options;
+            auto &files = state.files;
+            auto &sources = state.sources;
+            std::cout << "Compressing " << files.size() << " asset(s) on " << state.pool.size() << " thread(s)..." << std::endl;
+            sources.resize(files.size());
+            state.loaded.resize(files.size());
+            state.retainBudget = state.pool.size() * (16ull << 20);
+
+            trace::Scope scope("read");
+            auto stats = ReadAssetFiles(files, options.ioDepth, options.ioBackend, state.pool, [&](size_t i, std::shared_ptr<MappedFile> file)
+                                        {
+                trace::Scope fileScope("read", "asset");
+                fileScope.detail(files[i].relativePath);
+                if (!file)
+                    file = MappedFile::Open(files[i].path);
+                sources[i].digest = hash::ContentDigest(file->bytes());
+                sources[i].size = file->bytes().size();
+                sources[i].raw = options.storeRaw && IsIncompressible(file->bytes());
+                fileScope.bytesIn(sources[i].size);
+                if (!file->mapped() && (state.retained += sources[i].size) <= state.retainBudget)
+                    state.loaded[i] = std::move(file); });
+            std::uint64_t readBytes = 0;
+            for (auto &source : sources)
+                readBytes += source.size;
+            scope.bytesIn(readBytes);
+            scope.detail(stats.backend);
+            auto filesPerSecond = stats.seconds > 0 ? static_cast<std::uint64_t>(stats.files / stats.seconds) : 0;
+            trace::Count("assets.readFilesPerSecond", filesPerSecond);
+            trace::Count("assets.readMaxInFlight", stats.maxInFlight);
+            trace::Count("assets.readAverageInFlight", static_cast<std::uint64_t>(stats.averageInFlight + 0.5));
+            std::cout << std::fixed << std::setprecision(1) << "Read " << stats.files << " asset(s) with " << stats.backend << ": "
+                      << filesPerSecond << " files/s, " << (stats.seconds > 0 ? readBytes / stats.seconds / (1 << 20) : 0.0)
+                      << " MB/s, up to " << stats.maxInFlight << " in flight (avg " << stats.averageInFlight << ")."
+                      << std::defaultfloat << std::endl;
+        }
+
+        // The first occurrence in walk order owns the frame, which keeps the output deterministic.
+        void dedupe(BuildState &state)
+        {
+            auto &sources = state.sources;
+            std::map<std::pair<hash::Digest128, std::uint64_t>, size_t> unique;
+            for (size_t i = 0; i < sources.size(); ++i)
+            {
+                state.rawBytes += sources[i].size;
+                auto [it, inserted] = unique.try_emplace({sources[i].digest, sources[i].size}, frames.size() + state.owners.size());
+                if (inserted)
+                    state.owners.push_back(i);
+                else
+                {
+                    ++state.duplicates;
+                    state.loaded[i].reset();
+                }
+                sources[i].frame = it->second;
+            }
+        }
+
+        void orderStartup(BuildState &state)
+        {
+            auto &options = state.options;
+            if (options.accessProfile.empty())
+                return;
+            std::unordered_map<std::string_view, size_t> byPath;
+            for (size_t i = 0; i < state.files.size(); ++i)
+                byPath.emplace(state.files[i].relativePath, i);
+            std::vector<bool> listed(state.owners.size());
+            size_t unknown = 0;
+            for (auto &id : options.accessProfile)
+            {
+                auto path = AccessProfilePath(id);
+                auto it = byPath.find(path);
+                if (it == byPath.end())
+                {
+                    // the config frame always comes first and the dictionary follows the assets needing it
+                    if (path != "ezi.config.manifest" && path != "ezi.zstd.dictionary")
+                        ++unknown;
+                    continue;
+                }
+                auto u = state.sources[it->second].frame - 1;
+                if (!listed[u])
+                {
+                    listed[u] = true;
+                    state.startup.push_back(u);
+                }
+            }
+            if (unknown)
+                trace::Warn(std::to_string(unknown) + " access profile id(s) are not in the asset directory.");
+        }
+
+        void buildDictionary(BuildState &state)
+        {
+            auto &options = state.options;
+            if (options.dictionaryPath.empty() && !options.trainDictionary)
+                return;
+            trace::Scope scope("dictionary");
+            std::vector<size_t> small;
+            for (auto owner : state.owners)
+                if (state.sources[owner].size <= options.dictionaryMaxFileSize && !state.sources[owner].raw)
+                    small.push_back(owner);
+            std::vector<std::shared_ptr<MappedFile>> mapped;
+            std::vector<std::span<const std::byte>> samples;
+            for (auto owner : small)
+            {
+                mapped.push_back(state.load(owner));
+                samples.push_back(mapped.back()->bytes());
+            }
+
+            auto &dictionary = state.dictionary;
+            dictionary = options.dictionaryPath.empty() ? ZstdDictionary::Train(samples, options.compressionLevel)
+                                                        : ZstdDictionary::Load(options.dictionaryPath, options.compressionLevel);
+            if (!dictionary)
+            {
+                trace::Warn("Dictionary training skipped: not enough small assets to learn from.");
+                return;
+            }
+            // duplicates share their owner's content, so they resolve to the same frame kind
+            for (auto &source : state.sources)
+                source.useDictionary = source.size <= options.dictionaryMaxFileSize && !source.raw;
+            std::cout << "Using a " << dictionary->bytes().size() / 1024 << "KB zstd dictionary (id " << dictionary->id()
+                      << ") for " << small.size() << " asset(s)." << std::endl;
+            if (options.dictionaryReport)
+            {
+                auto report = BenchmarkDictionary(samples, *dictionary, options.compressionLevel);
+                auto ratio = [](std::uint64_t raw, std::uint64_t packed)
+                { return packed ? static_cast<double>(raw) / packed : 0.0; };
+                std::cout << std::fixed << std::setprecision(2)
+                          << "Dictionary report over " << report.files << " asset(s): ratio "
+                          << ratio(report.rawBytes, report.plainBytes) << "x -> " << ratio(report.rawBytes, report.dictBytes)
+                          << "x, decompress " << report.plainMBps << " MB/s -> " << report.dictMBps << " MB/s."
+                          << std::defaultfloat << std::endl;
+            }
+        }
+
+        // Which assets are split into chunks and which startup assets share the block frame.
+        void planFrames(BuildState &state)
+        {
+            auto &options = state.options;
+            // dictionary frames stay small by construction, everything else past the threshold is split
+            if (options.chunkThreshold)
+                for (auto &source : state.sources)
+                    source.chunked = !source.raw && !source.useDictionary && source.size > options.chunkThreshold;
+
+            // the leading startup assets that compress as one frame, up to accessBlockSize raw bytes
+            state.blockMember.assign(state.owners.size(), false);
+            if (options.accessBlockSize)
+            {
+                std::vector<size_t> members;
+                for (auto u : state.startup)
+                {
+                    auto &source = state.sources[state.owners[u]];
+                    if (source.raw || source.chunked)
+                        continue;
+                    if (state.blockRawSize + source.size > options.accessBlockSize)
+                        break;
+                    members.push_back(u);
+                    state.blockRawSize += source.size;
+                }
+                if (members.size() >= 2)
+                {
+                    state.blockFrame = 1 + state.owners.size();
+                    for (auto u : members)
+                        state.blockMember[u] = true;
+                }
+                else
+                {
+                    state.blockRawSize = 0;
+                }
+            }
+
+            frames.resize(1 + state.owners.size() + (state.blockFrame ? 1 : 0));
+        }
+
+        void compress(BuildState &state)
+        {
+            trace::Scope scope("compress");
+            compressChunks(state, compressFrames(state));
+            compressBlock(state);
+            state.loaded = {}; // left over by cache hits
+
+            std::uint64_t uniqueBytes = 0, compressed = 0;
+            for (size_t u = 0; u < state.owners.size(); ++u)
+            {
+                uniqueBytes += state.sources[state.owners[u]].size;
+                compressed += frames[1 + u].size();
+                if (frames[1 + u].codec == format::Codec::Raw)
+                {
+                    ++state.rawFiles;
+                    state.rawStored += state.sources[state.owners[u]].size;
+                }
+                if (!frames[1 + u].chunks.empty())
+                {
+                    ++state.chunkedCount;
+                    state.chunkCount += frames[1 + u].chunks.size();
+                }
+            }
+            if (state.blockFrame)
+                compressed += frames[state.blockFrame].size();
+            scope.bytesIn(uniqueBytes);
+            scope.bytesOut(compressed);
+        }
+
+        // One frame per owner outside the startup block. Chunked files are only opened here and returned, per
+        // owner, for compressChunks, so a single large file spreads over the whole pool.
+        std::vector<std::shared_ptr<MappedFile>> compressFrames(BuildState &state)
+        {
+            auto &options = state.options;
+            auto &cache = state.cache;
+            auto &dictionary = state.dictionary;
+            std::vector<std::shared_ptr<MappedFile>> chunkedFiles(state.owners.size());
+            state.pool.parallelFor(state.owners.size(), [&](size_t u)
+                                   {
+                if (state.blockMember[u])
+                    return;
+                auto owner = state.owners[u];
+                auto &source = state.sources[owner];
+                auto &frame = frames[source.frame];
+                if (source.chunked)
+                {
+                    if (cache)
+                        if (auto cached = cache->load(state.chunkKey(source), source.size, 0))
+                        {
+                            trace::Scope frameScope("cacheLoad", "asset", source.size);
+                            frameScope.detail(state.files[owner].relativePath);
+                            frame.chunks = *ReadSeekTable(*cached);
+                            frame.data = std::move(*cached);
+                            frameScope.bytesOut(frame.size());
+                            return;
+                        }
+                    chunkedFiles[u] = state.take(owner);
+                    return;
+                }
+                trace::Scope frameScope("compress", "asset", source.size);
+                frameScope.detail(state.files[owner].relativePath);
+                if (source.raw)
+                {
+                    frame.file = state.take(owner);
+                    frame.codec = format::Codec::Raw;
+                    frameScope.relabel("storeRaw");
+                    frameScope.bytesOut(source.size);
+                    return;
+                }
+                auto dictionaryId = source.useDictionary ? dictionary->id() : 0;
+                std::string key;
+                if (cache)
+                {
+                    key = CompressionCache::Key(source.digest, source.size, options.compressionLevel, dictionaryId);
+                    if (auto cached = cache->load(key, source.size, dictionaryId))
+                    {
+                        frame.data = std::move(*cached);
+                        frameScope.relabel("cacheLoad");
+                        frameScope.bytesOut(frame.size());
+                        return;
+                    }
+                }
+                auto file = state.take(owner);
+                frame.data = source.useDictionary ? dictionary->compress(file->bytes())
+                                                  : CompressFrame(file->bytes(), options.compressionLevel);
+                if (options.storeRaw && frame.data.size() >= source.size && source.size >= RawDetectionMinSize)
+                {
+                    // detection missed it; the frame would only cost decompression time
+                    frame.data = {};
+                    frame.file = std::move(file);
+                    frame.codec = format::Codec::Raw;
+                    frameScope.relabel("storeRaw");
+                }
+                frameScope.bytesOut(frame.size());
+                if (cache && frame.codec == format::Codec::Zstd)
+                    cache->store(key, frame.data); });
+            return chunkedFiles;
+        }
+
+        // Every chunk is a task of its own; each file's chunks are then joined behind a seek table.
+        void compressChunks(BuildState &state, std::vector<std::shared_ptr<MappedFile>> chunkedFiles)
+        {
+            auto &options = state.options;
+            auto &owners = state.owners;
+            std::vector<std::pair<size_t, size_t>> chunkTasks; // (owner, chunk)
+            std::vector<std::vector<std::vector<std::byte>>> chunkFrames(owners.size());
+            for (size_t u = 0; u < owners.size(); ++u)
+            {
+                if (!chunkedFiles[u])
+                    continue;
+                auto count = (state.sources[owners[u]].size + options.chunkSize - 1) / options.chunkSize;
+                chunkFrames[u].resize(count);
+                for (size_t k = 0; k < count; ++k)
+                    chunkTasks.emplace_back(u, k);
+            }
+            state.pool.parallelFor(chunkTasks.size(), [&](size_t t)
+                                   {
+                auto [u, k] = chunkTasks[t];
+                auto chunk = chunkedFiles[u]->bytes().subspan(k * options.chunkSize);
+                chunk = chunk.first(std::min<size_t>(chunk.size(), options.chunkSize));
+                trace::Scope chunkScope("compress", "asset", chunk.size());
+                chunkScope.detail(state.files[owners[u]].relativePath + "#" + std::to_string(k));
+                chunkFrames[u][k] = CompressFrame(chunk, options.compressionLevel);
+                if (chunkedFiles[u]->mapped())
+                    MappedFile::Evict(chunk);
+                chunkScope.bytesOut(chunkFrames[u][k].size()); });
+            state.pool.parallelFor(owners.size(), [&](size_t u)
+                                   {
+                if (!chunkedFiles[u])
+                    return;
+                auto &source = state.sources[owners[u]];
+                auto &frame = frames[source.frame];
+                std::vector<SeekTableEntry> table;
+                std::uint64_t stored = 0;
+                for (size_t k = 0; k < chunkFrames[u].size(); ++k)
+                {
+                    auto rawChunk = std::min<std::uint64_t>(options.chunkSize, source.size - k * options.chunkSize);
+                    table.push_back({static_cast<std::uint32_t>(chunkFrames[u][k].size()), static_cast<std::uint32_t>(rawChunk)});
+                    stored += chunkFrames[u][k].size();
+                }
+                auto seekTable = BuildSeekTable(table);
+                if (options.storeRaw && stored + seekTable.size() >= source.size)
+                {
+                    // detection missed it, same as for single frames
+                    frame.file = std::move(chunkedFiles[u]);
+                    frame.codec = format::Codec::Raw;
+                    return;
+                }
+                frame.data.reserve(stored + seekTable.size());
+                for (auto &chunk : chunkFrames[u])
+                {
+                    frame.data.insert(frame.data.end(), chunk.begin(), chunk.end());
+                    chunk = {};
+                }
+                frame.data.insert(frame.data.end(), seekTable.begin(), seekTable.end());
+                frame.chunks = std::move(table);
+                chunkedFiles[u].reset();
+                if (state.cache)
+                    state.cache->store(state.chunkKey(source), frame.data); });
+        }
+
+        void compressBlock(BuildState &state)
+        {
+            if (!state.blockFrame)
+                return;
+            auto &owners = state.owners;
+            trace::Scope blockScope("compress", "asset", state.blockRawSize);
+            blockScope.detail("access profile block");
+            std::vector<std::byte> joined;
+            joined.reserve(state.blockRawSize);
+            std::uint64_t blockOffset = 0;
+            std::vector<std::uint64_t> offsets(owners.size());
+            for (auto u : state.startup)
+            {
+                if (!state.blockMember[u])
+                    continue;
+                auto file = state.take(owners[u]);
+                joined.insert(joined.end(), file->bytes().begin(), file->bytes().end());
+                offsets[u] = blockOffset;
+                blockOffset += file->bytes().size();
+            }
+            // duplicates resolve to their owner's place in the block
+            for (auto &source : state.sources)
+            {
+                if (source.frame >= 1 && source.frame <= owners.size() && state.blockMember[source.frame - 1])
+                {
+                    source.inBlock = true;
+                    source.blockOffset = offsets[source.frame - 1];
+                    source.frame = state.blockFrame;
+                }
+            }
+            auto &frame = frames[state.blockFrame];
+            auto &cache = state.cache;
+            auto key = CompressionCache::Key(hash::ContentDigest(joined), joined.size(), state.options.compressionLevel, 0);
+            if (auto cached = cache ? cache->load(key, joined.size(), 0) : std::nullopt)
+            {
+                frame.data = std::move(*cached);
+                blockScope.relabel("cacheLoad");
+            }
+            else
+            {
+                frame.data = CompressFrame(joined, state.options.compressionLevel);
+                if (cache)
+                    cache->store(key, frame.data);
+            }
+            blockScope.bytesOut(frame.size());
+        }
+
+        // Per-asset CRCs, also combined into the payload hash without another pass over the bundle.
+        void checksum(BuildState &state)
+        {
+            trace::Scope scope("checksum");
+            state.pool.parallelFor(frames.size(), [&](size_t f)
+                                   {
+                auto &frame = frames[f];
+                frame.crc32c = hash::Crc32c::Of(frame.bytes());
+                if (frame.file && frame.file->mapped())
+                    MappedFile::Evict(frame.bytes()); });
+            std::uint64_t hashed = 0;
+            for (auto &frame : frames)
+                hashed += frame.size();
+            scope.bytesIn(hashed);
+        }
+
+        // Appends the dictionary frame and puts the frames in their final order, padded for page-aligned raw
+        // assets. Raw assets of a page or more go last, each on a page boundary; everything else keeps its order,
+        // except that the startup frames of an access profile move up behind the config frame.
+        void layOut(BuildState &state)
+        {
+            for (auto u : state.startup)
+            {
+                auto frame = state.blockMember[u] ? state.blockFrame : 1 + u;
+                if (state.startupFrames.empty() || state.startupFrames.back() != frame)
+                    state.startupFrames.push_back(frame);
+                state.startupDictionary |= !state.blockMember[u] && state.sources[state.owners[u]].useDictionary && frames[frame].codec == format::Codec::Zstd;
+            }
+
+            auto &dictionary = state.dictionary;
+            if (dictionary)
+            {
+                state.dictionaryFrame = frames.size();
+                frames.emplace_back(std::vector<std::byte>(dictionary->bytes().begin(), dictionary->bytes().end()), format::Codec::Raw);
+                frames.back().crc32c = hash::Crc32c::Of(dictionary->bytes());
+            }
+
+            auto pageAligned = [&](const Frame &frame)
+            { return frame.file && frame.size() >= format::OverlayAlignment; };
+            if (dictionary && state.startupDictionary)
+                state.startupFrames.insert(state.startupFrames.begin(), state.dictionaryFrame);
+            auto orderFrames = [&](const std::vector<size_t> &first)
+            {
+                std::vector<size_t> order{0};
+                std::vector<bool> placed(frames.size());
+                placed[0] = true;
+                auto place = [&](size_t f)
+                {
+                    if (!placed[f])
+                    {
+                        placed[f] = true;
+                        order.push_back(f);
+                    }
+                };
+                for (auto f : first)
+                    place(f);
+                for (size_t f = 0; f < frames.size(); ++f)
+                    if (!pageAligned(frames[f]))
+                        place(f);
+                for (size_t f = 0; f < frames.size(); ++f)
+                    place(f);
+                return order;
+            };
+            auto offsetsOf = [&](const std::vector<size_t> &order)
+            {
+                std::vector<std::uint64_t> offsets(frames.size());
+                std::uint64_t offset = 0;
+                for (auto f : order)
+                {
+                    if (pageAligned(frames[f]))
+                        offset = utils::AlignUp(offset, std::uint64_t{format::OverlayAlignment});
+                    offsets[f] = offset;
+                    offset += frames[f].size();
+                }
+                return offsets;
+            };
+            auto order = orderFrames(state.startupFrames);
+            state.frameOffsets = offsetsOf(order);
+
+            if (!state.startup.empty())
+            {
+                // the pages a cold start reads: the config and the profiled assets, here and in directory order
+                auto walkOffsets = offsetsOf(orderFrames({}));
+                auto count = [&](const std::vector<std::uint64_t> &offsets)
+                {
+                    std::vector<std::pair<std::uint64_t, std::uint64_t>> ranges;
+                    ranges.emplace_back(offsets[0], frames[0].size());
+                    for (auto f : state.startupFrames)
+                        ranges.emplace_back(offsets[f], frames[f].size());
+                    return CountPages(std::move(ranges));
+                };
+                state.startupPages = count(state.frameOffsets);
+                state.walkPages = count(walkOffsets);
+            }
+
+            state.frameSizes.resize(frames.size());
+            state.frameCodecs.resize(frames.size());
+            state.frameCrcs.resize(frames.size());
+            state.frameChunks.resize(frames.size());
+            std::vector<Frame> laidOut;
+            std::uint64_t offset = 0;
+            for (auto f : order)
+            {
+                auto &frame = frames[f];
+                if (state.frameOffsets[f] != offset)
+                    laidOut.emplace_back(std::vector<std::byte>(state.frameOffsets[f] - offset));
+                offset = state.frameOffsets[f];
+                state.frameSizes[f] = frame.size();
+                state.frameCodecs[f] = frame.codec;
+                state.frameCrcs[f] = frame.crc32c.value_or(0);
+                for (auto &chunk : frame.chunks)
+                    state.frameChunks[f].push_back(chunk.compressedSize);
+                offset += frame.size();
+                laidOut.push_back(std::move(frame));
+            }
+            frames = std::move(laidOut);
+            state.payloadSize = offset;
+        }
+
+        // One entry per asset, the config and the dictionary, written as the JSON manifest or the binary index.
+        void writeIndex(BuildState &state)
+        {
+            auto &options = state.options;
+            auto &files = state.files;
+            std::string manifest = "{";
+            auto count = files.size() + 1 + (state.dictionary ? 1 : 0);
+            for (size_t i = 0; i < count; ++i)
+            {
+                Entry entry;
+                size_t frame;
+                if (i == 0)
+                {
+                    frame = 0;
+                    entry.id = "ezi.config.manifest";
+                    entry.rawSize = state.configSize;
+                }
+                else if (i <= files.size())
+                {
+                    auto &source = state.sources[i - 1];
+                    frame = source.frame;
+                    entry.id = "https://" + options.packageName + "/" + files[i - 1].relativePath;
+                    entry.rawSize = source.size;
+                    entry.dictionaryId = source.useDictionary && !source.inBlock && state.frameCodecs[frame] == format::Codec::Zstd ? state.dictionary->id() : 0;
+                    if (source.inBlock)
+                    {
+                        entry.codec = format::Codec::ZstdBlock;
+                        entry.blockOffset = source.blockOffset;
+                    }
+                }
+                else
+                {
+                    frame = state.dictionaryFrame;
+                    entry.id = "ezi.zstd.dictionary";
+                    entry.rawSize = state.dictionary->bytes().size();
+                }
+                entry.offset = state.frameOffsets[frame];
+                entry.size = state.frameSizes[frame];
+                if (entry.codec != format::Codec::ZstdBlock)
+                    entry.codec = state.frameCodecs[frame];
+                entry.crc32c = state.frameCrcs[frame];
+                if (!state.frameChunks[frame].empty())
+                {
+                    entry.chunkSize = options.chunkSize;
+                    entry.chunks = state.frameChunks[frame];
+                }
+
+                if (options.index == format::IndexKind::Json)
+                {
+                    if (i)
+                        manifest += ",";
+                    json::AppendString(manifest, entry.id);
+                    manifest += ":{\"offset\":" + std::to_string(entry.offset) + ",\"size\":" + std::to_string(entry.size);
+                    if (entry.dictionaryId)
+                        manifest += ",\"dict\":" + std::to_string(entry.dictionaryId);
+                    if (entry.codec == format::Codec::Raw)
+                        manifest += ",\"codec\":\"raw\"";
+                    if (entry.codec == format::Codec::ZstdBlock)
+                        manifest += ",\"codec\":\"block\",\"blockOffset\":" + std::to_string(entry.blockOffset);
+                    manifest += ",\"crc32c\":" + std::to_string(entry.crc32c);
+                    if (entry.chunkSize)
+                    {
+                        manifest += ",\"chunkSize\":" + std::to_string(entry.chunkSize) + ",\"chunks\":[";
+                        for (size_t k = 0; k < entry.chunks.size(); ++k)
+                            manifest += (k ? "," : "") + std::to_string(entry.chunks[k]);
+                        manifest += "]";
+                    }
+                    manifest += "}";
+                }
+                entries.push_back(std::move(entry));
+            }
+            manifest += "}";
+
+            if (options.index == format::IndexKind::Binary)
+            {
+                auto indexOffset = utils::AlignUp(state.payloadSize, std::uint64_t{format::IndexAlignment});
+                if (indexOffset != state.payloadSize)
+                    frames.emplace_back(std::vector<std::byte>(indexOffset - state.payloadSize));
+
+                std::vector<AssetIndexRecord> records;
+                records.reserve(entries.size());
+                for (auto &entry : entries)
+                    records.push_back({entry.id, entry.offset, entry.size, entry.rawSize, entry.codec, entry.dictionaryId, entry.crc32c, entry.chunkSize, entry.blockOffset});
+                auto index = BuildAssetIndex(records);
+
+                format::IndexTrailer trailer{indexOffset, index.size(), {}};
+                std::memcpy(trailer.magic, format::IndexMagic, sizeof(trailer.magic));
+                frames.emplace_back(std::move(index));
+                std::vector<std::byte> trailerBytes(sizeof(trailer));
+                std::memcpy(trailerBytes.data(), &trailer, sizeof(trailer));
+                frames.emplace_back(std::move(trailerBytes));
+            }
+            else
+            {
+                auto manifestFrame = CompressFrame(std::as_bytes(std::span(manifest)), options.compressionLevel);
+                if (manifestFrame.size() > UINT32_MAX)
+                    utils::Fail("Manifest size exceeds 4GB limit.");
+                auto manifestSize = static_cast<std::uint32_t>(manifestFrame.size());
+                frames.emplace_back(std::move(manifestFrame));
+                std::vector<std::byte> trailer(sizeof(manifestSize));
+                std::memcpy(trailer.data(), &manifestSize, sizeof(manifestSize));
+                frames.emplace_back(std::move(trailer));
+            }
+
+            for (auto &frame : frames)
+                totalSize += frame.size();
+        }
+
+        void report(const BuildState &state) const
+        {
+            auto &cache = state.cache;
+            trace::Count("assets.files", state.files.size());
+            trace::Count("assets.rawBytes", state.rawBytes);
+            trace::Count("assets.storedBytes", totalSize);
+            trace::Count("assets.duplicates", state.duplicates);
+            trace::Count("assets.rawFiles", state.rawFiles);
+            trace::Count("assets.rawStoredBytes", state.rawStored);
+            trace::Count("assets.chunkedFiles", state.chunkedCount);
+            trace::Count("assets.chunks", state.chunkCount);
+            if (cache)
+                trace::Count("assets.cacheHits", cache->hitCount());
+            if (state.startupPages)
+            {
+                trace::Count("assets.startupAssets", state.startup.size());
+                trace::Count("assets.startupPages", state.startupPages->pages);
+                trace::Count("assets.startupRuns", state.startupPages->runs);
+                trace::Count("assets.startupPagesUnordered", state.walkPages->pages);
+            }
+
+            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - state.startTime).count();
+            if (cache)
+                std::cout << "Compression cache: " << cache->hitCount() << " hit(s), " << cache->missCount() << " miss(es), "
+                          << cache->hitByteCount() / 1024 << "KB reused." << std::endl;
+            if (state.duplicates)
+                std::cout << "Deduplicated " << state.duplicates << " identical asset(s)." << std::endl;
+            if (state.rawFiles)
+                std::cout << "Stored " << state.rawFiles << " incompressible asset(s) raw (" << state.rawStored / 1024 << "KB)." << std::endl;
+            if (state.chunkedCount)
+                std::cout << "Split " << state.chunkedCount << " large asset(s) into " << state.chunkCount << " seekable chunk(s)." << std::endl;
+            if (state.startupPages)
+                std::cout << "Access profile: " << state.startup.size() << " startup asset(s) in " << state.startupPages->pages << " page(s), "
+                          << state.startupPages->runs << " contiguous run(s); " << state.walkPages->pages << " page(s), " << state.walkPages->runs
+                          << " run(s) in directory order." << std::endl;
+            if (state.blockFrame)
+                std::cout << "Packed the first startup assets into one shared frame (" << state.blockRawSize / 1024 << "KB -> "
+                          << state.frameSizes[state.blockFrame] / 1024 << "KB)." << std::endl;
+            std::cout << "Assets generated: " << state.rawBytes / 1024 << "KB -> " << totalSize / 1024 << "KB in "
+                      << static_cast<int>(elapsed * 1000) << "ms." << std::endl;
+        }
+
+    public:
+        // Each step reads and extends the BuildState left by the previous ones.
+        static std::shared_ptr<AssetBundle> Build(const AssetBundleOptions &options)
+        {
+            auto bundle = std::make_shared<AssetBundle>();
+            BuildState state(options);
+            bundle->scan(state);
+            bundle->compressConfig(state);
+            if (!options.cacheDir.empty())
+                state.cache.emplace(options.cacheDir);
+            bundle->read(state);
+            bundle->dedupe(state);
+            bundle->orderStartup(state);
+            bundle->buildDictionary(state);
+            bundle->planFrames(state);
+            bundle->compress(state);
+            bundle->checksum(state);
+
+            trace::Scope manifestScope("manifest");
+            bundle->layOut(state);
+            bundle->writeIndex(state);
+            manifestScope.bytesOut(bundle->totalSize - state.payloadSize);
+            bundle->report(state);
+            return bundle;
+        }
+
+        const std::vector<Entry> &manifest() const { return entries; }
+
+        std::uint64_t size() const { return totalSize; }
+
+        // CRC32C of the whole bundle (format::HashAlgorithm::Crc32c), combined from the per-frame CRCs taken
+        // while building; only the small padding, index and trailer frames are read again.
+        std::uint64_t contentHash() const
+        {
+            std::call_once(hashOnce, [&]
+                           {
+                trace::Scope scope("hash", "phase", totalSize);
+                std::uint32_t crc = 0;
+                for (auto &frame : frames)
+                    crc = hash::Crc32c::Combine(crc, frame.crc32c ? *frame.crc32c : hash::Crc32c::Of(frame.bytes()), frame.size());
+                payloadHash = crc; });
+            return payloadHash;
+        }
+
+        // The bundle bytes in order; concatenated they form ezi.assets.binary.
+        std::vector<std::span<const std::byte>> parts() const
+        {
+            std::vector<std::span<const std::byte>> result;
+            for (auto &frame : frames)
+                result.push_back(frame.bytes());
+            return result;
+        }
+
+        // Parallel to parts(): the source mapping of frames stored raw, null for frames built in memory.
+        std::vector<const MappedFile *> sources() const
+        {
+            std::vector<const MappedFile *> result;
+            for (auto &frame : frames)
+                result.push_back(frame.file.get());
+            return result;
+        }
+    };
+}
@@ -0,0 +1,145 @@
+#pragma once
+
+#include <cstdint>
+
+namespace ezi::builder::packager::format
+{
+    enum class HashAlgorithm : std::uint32_t
+    {
+        Xxh64 = 1,
+        Crc32c = 2, // stored in the low 32 bits of 64-bit hash fields
+    };
+
+#pragma pack(push, 1)
+    // Trailer of an executable whose asset bundle is appended after the last PE section.
+    // The runtime reads the last sizeof(OverlayFooter) bytes and maps [offset, offset + length). Packagers write
+    // Crc32c payload hashes, Xxh64 ones come from older builds.
+    struct OverlayFooter
+    {
+        char magic[8];
+        std::uint32_t version;
+        HashAlgorithm hashAlgorithm;
+        std::uint64_t offset;
+        std::uint64_t length;
+        std::uint64_t hash;
+    };
+#pragma pack(pop)
+
+    enum class Codec : std::uint32_t
+    {
+        Raw = 0,
+        Zstd = 1,
+        ZstdBlock = 2, // bytes [blockOffset, blockOffset + rawSize) of a zstd frame shared by several assets
+    };
+
+    enum class IndexKind
+    {
+        Json,   // zstd-compressed JSON manifest, read by every runtime
+        Binary, // AssetIndex, looked up in place without parsing
+    };
+
+#pragma pack(push, 1)
+    // Binary asset index, written at an 8-byte aligned offset of the bundle and followed by IndexTrailer:
+    //   [IndexHeader][IndexEntry x entryCount][UTF-8 ids]
+    // Entries are sorted by (idHash, id) so a lookup is a binary search over fixed-size records; the id
+    // bytes are only compared to rule out hash collisions. All offsets are relative to the index start.
+    struct IndexHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        std::uint32_t entryCount;
+        HashAlgorithm idHashAlgorithm;
+        std::uint32_t entryStride;
+        std::uint64_t idHashSeed;
+        std::uint64_t entriesOffset;
+        std::uint64_t idsOffset;
+        std::uint64_t idsSize;
+    };
+
+    struct IndexEntry
+    {
+        std::uint64_t idHash;
+        std::uint64_t offset;  // of the stored bytes, relative to the bundle start
+        std::uint64_t size;    // stored size
+        std::uint64_t rawSize; // size after decoding
+        std::uint32_t idOffset;
+        std::uint32_t idSize;
+        Codec codec;
+        std::uint32_t dictionaryId; // zstd dictionary the frame needs, 0 for none
+        std::uint32_t crc32c;       // of the stored bytes, checked before decoding
+        std::uint32_t chunkSize;    // uncompressed bytes per seekable chunk, 0 for a single frame
+        std::uint64_t blockOffset;  // of the asset in the decoded frame, Codec::ZstdBlock only
+    };
+
+    // Last bytes of a bundle that carries a binary index instead of the JSON manifest.
+    struct IndexTrailer
+    {
+        std::uint64_t indexOffset;
+        std::uint64_t indexSize;
+        char magic[8];
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(IndexHeader) == 56 && sizeof(IndexEntry) == 64 && sizeof(IndexTrailer) == 24);
+
+    constexpr char IndexMagic[8] = {'E', 'Z', 'I', 'I', 'N', 'D', 'E', 'X'};
+    constexpr std::uint32_t IndexVersion = 4; // 2: IndexEntry::crc32c, 3: IndexEntry::chunkSize, 4: IndexEntry::blockOffset
+    constexpr std::uint32_t IndexAlignment = 8;
+
+    constexpr char OverlayMagic[8] = {'E', 'Z', 'I', 'A', 'S', 'S', 'E', 'T'};
+    constexpr std::uint32_t OverlayVersion = 1;
+    constexpr std::uint32_t OverlayAlignment = 4096;
+
+    enum class DeltaOpKind : std::uint32_t
+    {
+        Copy = 1,    // new bytes are old bytes [oldOffset, oldOffset + newSize) of the old file
+        Literal = 2, // new bytes are stored as is in the patch data
+        Diff = 3,    // zstd frame of a bsdiff-style control/diff/extra stream against an old reference range
+    };
+
+    enum class DeltaSpace : std::uint32_t
+    {
+        File = 0, // offsets into the old file
+        Core = 1, // offsets into the old file's DeltaRange list concatenated, i.e. everything but asset frames
+    };
+
+#pragma pack(push, 1)
+    // Patch turning one packaged executable into another:
+    //   [DeltaHeader][DeltaRange x coreRangeCount][DeltaOp x opCount][data]
+    // Ops are in output order and their newSize values add up to newSize. Data offsets are relative to the patch start.
+    struct DeltaHeader
+    {
+        char magic[8];
+        std::uint32_t version;
+        HashAlgorithm hashAlgorithm;
+        std::uint64_t oldSize;
+        std::uint64_t oldHash;
+        std::uint64_t newSize;
+        std::uint64_t newHash;
+        std::uint32_t coreRangeCount;
+        std::uint32_t opCount;
+    };
+
+    struct DeltaRange
+    {
+        std::uint64_t offset;
+        std::uint64_t size;
+    };
+
+    struct DeltaOp
+    {
+        DeltaOpKind kind;
+        DeltaSpace space;
+        std::uint64_t oldOffset;
+        std::uint64_t oldSize;
+        std::uint64_t newSize;
+        std::uint64_t dataOffset;
+        std::uint64_t dataSize;
+    };
+#pragma pack(pop)
+
+    static_assert(sizeof(DeltaHeader) == 56 && sizeof(DeltaRange) == 16 && sizeof(DeltaOp) == 48);
+
+    constexpr char DeltaMagic[8] = {'E', 'Z', 'I', 'D', 'E', 'L', 'T', 'A'};
+    constexpr std::uint32_t DeltaVersion = 1;
+}
@@ -0,0 +1,181 @@
+#pragma once
+
+#include "utils.hpp"
+#include "hash.hpp"
+#include "asset_format.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace ezi::builder::packager
+{
+    struct AssetIndexRecord
+    {
+        std::string id;
+        std::uint64_t offset;
+        std::uint64_t size;
+        std::uint64_t rawSize;
+        format::Codec codec = format::Codec::Zstd;
+        std::uint32_t dictionaryId = 0;
+        std::uint32_t crc32c = 0;
+        std::uint32_t chunkSize = 0;
+        std::uint64_t blockOffset = 0;
+    };
+
+    constexpr std::uint64_t AssetIdHashSeed = 0;
+
+    inline std::uint64_t HashAssetId(std::string_view id, std::uint64_t seed = AssetIdHashSeed)
+    {
+        return hash::Xxh64::Of(std::as_bytes(std::span(id)), seed);
+    }
+
+    // Serializes records into the format::IndexHeader layout.
+    inline std::vector<std::byte> BuildAssetIndex(const std::vector<AssetIndexRecord> &records)
+    {
+        if (records.size() > UINT32_MAX)
+            utils::Fail("Too many assets for the binary index.");
+
+        std::vector<std::pair<std::uint64_t, const AssetIndexRecord *>> order;
+        order.reserve(records.size());
+        for (auto &record : records)
+            order.emplace_back(HashAssetId(record.id), &record);
+        std::sort(order.begin(), order.end(), [](auto &a, auto &b)
+                  { return a.first != b.first ? a.first < b.first : a.second->id < b.second->id; });
+        for (size_t i = 1; i < order.size(); ++i)
+            if (order[i].first == order[i - 1].first && order[i].second->id == order[i - 1].second->id)
+                utils::Fail("Duplicate asset id: " + order[i].second->id);
+
+        format::IndexHeader header{};
+        std::memcpy(header.magic, format::IndexMagic, sizeof(header.magic));
+        header.version = format::IndexVersion;
+        header.entryCount = static_cast<std::uint32_t>(records.size());
+        header.idHashAlgorithm = format::HashAlgorithm::Xxh64;
+        header.entryStride = sizeof(format::IndexEntry);
+        header.idHashSeed = AssetIdHashSeed;
+        header.entriesOffset = sizeof(format::IndexHeader);
+        header.idsOffset = header.entriesOffset + order.size() * sizeof(format::IndexEntry);
+
+        std::vector<format::IndexEntry> entries;
+        std::string ids;
+        entries.reserve(order.size());
+        for (auto &[idHash, record] : order)
+        {
+            if (ids.size() + record->id.size() > UINT32_MAX)
+                utils::Fail("Asset ids exceed the 4GB index limit.");
+            format::IndexEntry entry{};
+            entry.idHash = idHash;
+            entry.offset = record->offset;
+            entry.size = record->size;
+            entry.rawSize = record->rawSize;
+            entry.idOffset = static_cast<std::uint32_t>(ids.size());
+            entry.idSize = static_cast<std::uint32_t>(record->id.size());
+            entry.codec = record->codec;
+            entry.dictionaryId = record->dictionaryId;
+            entry.crc32c = record->crc32c;
+            entry.chunkSize = record->chunkSize;
+            entry.blockOffset = record->blockOffset;
+            entries.push_back(entry);
+            ids += record->id;
+        }
+        header.idsSize = ids.size();
+
+        std::vector<std::byte> index(utils::AlignUp(header.idsOffset + ids.size(), std::uint64_t{format::IndexAlignment}));
+        std::memcpy(index.data(), &header, sizeof(header));
+        if (!entries.empty())
+            std::memcpy(index.data() + header.entriesOffset, entries.data(), entries.size() * sizeof(format::IndexEntry));
+        if (!ids.empty())
+            std::memcpy(index.data() + header.idsOffset, ids.data(), ids.size());
+        return index;
+    }
+
+    // Reference reader: validates the header once, then every lookup is a binary search over the mapped
+    // entries. Nothing is decoded or copied, the reader only keeps pointers into the bundle.
+    class AssetIndexReader
+    {
+    private:
+        std::span<const std::byte> bundle;
+        const format::IndexEntry *entries = nullptr;
+        const char *ids = nullptr;
+        std::uint32_t count = 0;
+        std::uint64_t seed = 0;
+
+    public:
+        // Returns nothing when the bundle carries no binary index or the index is malformed.
+        static std::optional<AssetIndexReader> Open(std::span<const std::byte> bundle)
+        {
+            format::IndexTrailer trailer;
+            if (bundle.size() < sizeof(trailer))
+                return std::nullopt;
+            std::memcpy(&trailer, bundle.data() + bundle.size() - sizeof(trailer), sizeof(trailer));
+            if (std::memcmp(trailer.magic, format::IndexMagic, sizeof(trailer.magic)) != 0)
+                return std::nullopt;
+            if (trailer.indexOffset % format::IndexAlignment || trailer.indexSize < sizeof(format::IndexHeader) ||
+                trailer.indexOffset > bundle.size() - sizeof(trailer) ||
+                trailer.indexSize > bundle.size() - sizeof(trailer) - trailer.indexOffset)
+                return std::nullopt;
+
+            auto index = bundle.subspan(trailer.indexOffset, trailer.indexSize);
+            auto header = reinterpret_cast<const format::IndexHeader *>(index.data());
+            if (std::memcmp(header->magic, format::IndexMagic, sizeof(header->magic)) != 0 ||
+                header->version != format::IndexVersion ||
+                header->idHashAlgorithm != format::HashAlgorithm::Xxh64 ||
+                header->entryStride != sizeof(format::IndexEntry) ||
+                header->entriesOffset % alignof(std::uint64_t) ||
+                header->entriesOffset > index.size() ||
+                (index.size() - header->entriesOffset) / sizeof(format::IndexEntry) < header->entryCount ||
+                header->idsOffset > index.size() || header->idsSize > index.size() - header->idsOffset)
+                return std::nullopt;
+
+            AssetIndexReader reader;
+            reader.bundle = bundle;
+            reader.entries = reinterpret_cast<const format::IndexEntry *>(index.data() + header->entriesOffset);
+            reader.ids = reinterpret_cast<const char *>(index.data() + header->idsOffset);
+            reader.count = header->entryCount;
+            reader.seed = header->idHashSeed;
+            for (std::uint32_t i = 0; i < reader.count; ++i)
+            {
+                auto &entry = reader.entries[i];
+                if (entry.idOffset > header->idsSize || entry.idSize > header->idsSize - entry.idOffset ||
+                    entry.offset > bundle.size() || entry.size > bundle.size() - entry.offset)
+                    return std::nullopt;
+            }
+            return reader;
+        }
+
+        std::uint32_t size() const { return count; }
+
+        std::span<const format::IndexEntry> all() const { return {entries, count}; }
+
+        std::string_view id(const format::IndexEntry &entry) const { return {ids + entry.idOffset, entry.idSize}; }
+
+        const format::IndexEntry *find(std::string_view assetId) const
+        {
+            auto idHash = HashAssetId(assetId, seed);
+            auto first = std::lower_bound(entries, entries + count, idHash, [](const format::IndexEntry &entry, std::uint64_t value)
+                                          { return entry.idHash < value; });
+            for (auto it = first; it != entries + count && it->idHash == idHash; ++it)
+                if (id(*it) == assetId)
+                    return it;
+            return nullptr;
+        }
+
+        // Stored bytes of an entry, still encoded with entry.codec.
+        std::span<const std::byte> data(const format::IndexEntry &entry) const
+        {
+            return bundle.subspan(entry.offset, entry.size);
+        }
+
+        // Checks an entry's stored bytes against its CRC. Meant to run once per asset on first access, so a
+        // damaged bundle is reported for the asset that is affected rather than as a failing decode.
+        bool verify(const format::IndexEntry &entry) const
+        {
+            return hash::Crc32c::Of(data(entry)) == entry.crc32c;
+        }
+    };
+}
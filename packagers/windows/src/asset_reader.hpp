@@ -0,0 +1,475 @@
+#pragma once
+
+#include "utils.hpp"
+#include "mapped_file.hpp"
+#include "thread_pool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#if defined(__linux__) && __has_include(<linux/io_uring.h>)
+#define EZI_IO_URING 1
+#include <cerrno>
+#include <fcntl.h>
+#include <linux/io_uring.h>
+#include <linux/stat.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace ezi::builder::packager
+{
+    struct AssetFile
+    {
+        std::filesystem::path path;
+        std::string relativePath; // '/' separated, UTF-8
+    };
+
+    // Depth-first walk with entries sorted by name, as the TypeScript builder used to walk the tree. Directories are
+    // listed level by level on the pool, so a slow filesystem has one listing in flight per worker; the order
+    // is assembled afterwards and does not depend on which listing finished first.
+    inline std::vector<AssetFile> CollectAssetFiles(const std::filesystem::path &root, ThreadPool &pool)
+    {
+        if (!std::filesystem::is_directory(root))
+            utils::Fail("Asset directory does not exist: " + utils::PathText(root));
+
+        struct Listing
+        {
+            std::filesystem::path path;
+            std::vector<std::filesystem::directory_entry> entries;
+            std::vector<size_t> children; // listing of each entry that is a directory, SIZE_MAX otherwise
+        };
+        std::vector<Listing> listings(1);
+        listings[0].path = root;
+        for (size_t levelBegin = 0; levelBegin < listings.size();)
+        {
+            size_t levelEnd = listings.size();
+            pool.parallelFor(levelEnd - levelBegin, [&](size_t k)
+                             {
+                auto &listing = listings[levelBegin + k];
+                for (auto &entry : std::filesystem::directory_iterator(listing.path))
+                    listing.entries.push_back(entry);
+                std::sort(listing.entries.begin(), listing.entries.end(), [](auto &a, auto &b)
+                          { return a.path().filename().native() < b.path().filename().native(); });
+                listing.children.resize(listing.entries.size(), SIZE_MAX);
+                for (size_t e = 0; e < listing.entries.size(); ++e)
+                    if (listing.entries[e].is_directory())
+                        listing.children[e] = 0; });
+            for (size_t d = levelBegin; d < levelEnd; ++d)
+            {
+                for (size_t e = 0; e < listings[d].entries.size(); ++e)
+                {
+                    if (listings[d].children[e] == SIZE_MAX)
+                        continue;
+                    listings[d].children[e] = listings.size();
+                    Listing child;
+                    child.path = listings[d].entries[e].path();
+                    listings.push_back(std::move(child));
+                }
+            }
+            levelBegin = levelEnd;
+        }
+
+        std::vector<AssetFile> files;
+        auto walk = [&](auto &self, const Listing &listing) -> void
+        {
+            for (size_t e = 0; e < listing.entries.size(); ++e)
+            {
+                auto &entry = listing.entries[e];
+                if (listing.children[e] != SIZE_MAX)
+                {
+                    self(self, listings[listing.children[e]]);
+                }
+                else if (entry.is_regular_file())
+                {
+                    auto relative = std::filesystem::relative(entry.path(), root).generic_u8string();
+                    files.push_back({entry.path(), std::string(relative.begin(), relative.end())});
+                }
+            }
+        };
+        walk(walk, listings[0]);
+        return files;
+    }
+
+    // Files up to this size are read into memory while collecting, as long as the bytes read but not yet
+    // consumed stay within the budget; the rest are handed over unread and mapped by the consumer.
+    constexpr std::uint64_t BufferedReadMaxFileSize = 1 << 20;
+    constexpr std::uint64_t BufferedReadBudget = 64ull << 20;
+
+    enum class ReadBackend
+    {
+        Auto,    // io_uring where the kernel offers it, threads otherwise
+        Threads, // blocking reads on `depth` threads
+    };
+
+    struct ReadStats
+    {
+        const char *backend = "threads";
+        size_t files = 0;
+        std::uint64_t bytes = 0; // read into memory
+        double seconds = 0;
+        size_t maxInFlight = 0;
+        double averageInFlight = 0;
+    };
+
+#ifdef EZI_IO_URING
+    // Just enough of an io_uring over the raw syscalls for batches of openat, statx and read.
+    class IoUring
+    {
+    private:
+        int fd = -1;
+        io_uring_params params{};
+        void *sqRing = MAP_FAILED;
+        void *cqRing = MAP_FAILED;
+        size_t sqRingSize = 0;
+        size_t cqRingSize = 0;
+        io_uring_sqe *sqes = static_cast<io_uring_sqe *>(MAP_FAILED);
+        unsigned *sqHead = nullptr, *sqTail = nullptr, *sqMask = nullptr, *sqArray = nullptr;
+        unsigned *cqHead = nullptr, *cqTail = nullptr, *cqMask = nullptr;
+        io_uring_cqe *cqes = nullptr;
+        unsigned tail = 0;
+        unsigned queued = 0;
+
+        IoUring() = default;
+
+    public:
+        // Nothing when the kernel or a seccomp policy rejects io_uring, or lacks the 5.6 opcodes.
+        static std::unique_ptr<IoUring> Create(unsigned entries)
+        {
+            std::unique_ptr<IoUring> ring(new IoUring());
+            ring->fd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &ring->params));
+            if (ring->fd < 0 || !(ring->params.features & IORING_FEAT_RW_CUR_POS))
+                return nullptr;
+            auto &p = ring->params;
+            ring->sqRingSize = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+            ring->cqRingSize = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+            if (p.features & IORING_FEAT_SINGLE_MMAP)
+                ring->sqRingSize = ring->cqRingSize = std::max(ring->sqRingSize, ring->cqRingSize);
+            ring->sqRing = mmap(nullptr, ring->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+            if (ring->sqRing == MAP_FAILED)
+                return nullptr;
+            ring->cqRing = p.features & IORING_FEAT_SINGLE_MMAP
+                               ? ring->sqRing
+                               : mmap(nullptr, ring->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+            if (ring->cqRing == MAP_FAILED)
+                return nullptr;
+            void *sqes = mmap(nullptr, p.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQES);
+            if (sqes == MAP_FAILED)
+                return nullptr;
+            ring->sqes = static_cast<io_uring_sqe *>(sqes);
+
+            auto sq = static_cast<char *>(ring->sqRing);
+            auto cq = static_cast<char *>(ring->cqRing);
+            ring->sqHead = reinterpret_cast<unsigned *>(sq + p.sq_off.head);
+            ring->sqTail = reinterpret_cast<unsigned *>(sq + p.sq_off.tail);
+            ring->sqMask = reinterpret_cast<unsigned *>(sq + p.sq_off.ring_mask);
+            ring->sqArray = reinterpret_cast<unsigned *>(sq + p.sq_off.array);
+            ring->cqHead = reinterpret_cast<unsigned *>(cq + p.cq_off.head);
+            ring->cqTail = reinterpret_cast<unsigned *>(cq + p.cq_off.tail);
+            ring->cqMask = reinterpret_cast<unsigned *>(cq + p.cq_off.ring_mask);
+            ring->cqes = reinterpret_cast<io_uring_cqe *>(cq + p.cq_off.cqes);
+            ring->tail = *ring->sqTail;
+            return ring;
+        }
+
+        ~IoUring()
+        {
+            if (sqes != MAP_FAILED)
+                munmap(sqes, params.sq_entries * sizeof(io_uring_sqe));
+            if (cqRing != MAP_FAILED && cqRing != sqRing)
+                munmap(cqRing, cqRingSize);
+            if (sqRing != MAP_FAILED)
+                munmap(sqRing, sqRingSize);
+            if (fd >= 0)
+                close(fd);
+        }
+
+        IoUring(const IoUring &) = delete;
+        IoUring &operator=(const IoUring &) = delete;
+
+        unsigned entries() const { return params.sq_entries; }
+
+        // A zeroed submission entry, queued until the next submit().
+        io_uring_sqe &prepare(std::uint8_t opcode, int fd, std::uint64_t userData)
+        {
+            if (tail - std::atomic_ref(*sqHead).load(std::memory_order_acquire) >= params.sq_entries)
+                utils::Fail("io_uring submission queue overflow.");
+            auto index = tail & *sqMask;
+            auto &sqe = sqes[index];
+            std::memset(&sqe, 0, sizeof(sqe));
+            sqe.opcode = opcode;
+            sqe.fd = fd;
+            sqe.user_data = userData;
+            sqArray[index] = index;
+            ++tail;
+            ++queued;
+            return sqe;
+        }
+
+        // Submits the queued entries and waits until at least one completion is available.
+        void submitAndWait()
+        {
+            std::atomic_ref(*sqTail).store(tail, std::memory_order_release);
+            while (true)
+            {
+                auto result = syscall(__NR_io_uring_enter, fd, queued, 1, IORING_ENTER_GETEVENTS, nullptr, 0);
+                if (result >= 0)
+                {
+                    queued -= static_cast<unsigned>(result);
+                    return;
+                }
+                if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+                    utils::Fail("io_uring_enter failed: " + std::string(std::strerror(errno)));
+            }
+        }
+
+        template <typename Fn>
+        void reap(Fn &&fn)
+        {
+            auto head = *cqHead;
+            auto end = std::atomic_ref(*cqTail).load(std::memory_order_acquire);
+            for (; head != end; ++head)
+                fn(cqes[head & *cqMask]);
+            std::atomic_ref(*cqHead).store(head, std::memory_order_release);
+        }
+    };
+#endif
+
+    // Reads every file with up to `depth` operations in flight and passes it to consume(i, file) on the pool as
+    // soon as it is in memory, so hashing and compression start while later files are still being read.
+    // consume receives nullptr for files left to be mapped: those above BufferedReadMaxFileSize or past the
+    // budget. The first exception, from a read or from consume, is rethrown once everything in flight is done.
+    // Without io_uring the reads block on `depth` threads of their own, started for the call.
+    inline ReadStats ReadAssetFiles(const std::vector<AssetFile> &files, size_t depth, ReadBackend backend, ThreadPool &pool,
+                                    const std::function<void(size_t, std::shared_ptr<MappedFile>)> &consume)
+    {
+        auto startTime = std::chrono::steady_clock::now();
+        depth = std::max<size_t>(depth, 1);
+        ReadStats stats;
+        stats.files = files.size();
+
+        std::exception_ptr error;
+        std::mutex errorMutex;
+        std::atomic<bool> failed{false};
+        auto capture = [&](auto &&fn)
+        {
+            try
+            {
+                fn();
+            }
+            catch (...)
+            {
+                std::lock_guard lock(errorMutex);
+                if (!error)
+                    error = std::current_exception();
+                failed.store(true, std::memory_order_relaxed);
+            }
+        };
+        std::atomic<std::uint64_t> budget{BufferedReadBudget};
+        auto deliver = [&](size_t i, std::shared_ptr<MappedFile> file)
+        {
+            pool.submit([&, i, file = std::move(file)]() mutable
+                        {
+                // the buffer is the consumer's from here on, whether it keeps it or not
+                auto buffered = file ? file->bytes().size() : 0;
+                if (!failed.load(std::memory_order_relaxed))
+                    capture([&]
+                            { consume(i, std::move(file)); });
+                budget += buffered; });
+        };
+        auto reserve = [&](std::uint64_t size)
+        {
+            if (size > BufferedReadMaxFileSize)
+                return false;
+            auto left = budget.load();
+            while (left >= size && !budget.compare_exchange_weak(left, left - size))
+                ;
+            return left >= size;
+        };
+
+        std::uint64_t inFlightSum = 0, samples = 0;
+        bool done = false;
+#ifdef EZI_IO_URING
+        std::unique_ptr<IoUring> ring;
+        if (backend == ReadBackend::Auto && !files.empty())
+            ring = IoUring::Create(static_cast<unsigned>(std::min<size_t>(depth * 2, 4096)));
+        if (ring)
+        {
+            // per slot: openat and statx go out together, then reads until the buffer is full
+            enum Op : std::uint64_t
+            {
+                Open,
+                Stat,
+                Read,
+            };
+            struct Slot
+            {
+                size_t file = SIZE_MAX;
+                int fd = -1;
+                int error = 0;
+                int pending = 0;
+                struct statx st;
+                std::vector<std::byte> data;
+                size_t filled = 0;
+            };
+            std::vector<Slot> slots(std::min<size_t>(ring->entries() / 2, files.size()));
+            stats.backend = "io_uring";
+            size_t next = 0, active = 0;
+            auto tag = [](size_t slot, Op op)
+            { return static_cast<std::uint64_t>(slot) << 2 | op; };
+            auto start = [&](size_t s)
+            {
+                auto &slot = slots[s];
+                slot = Slot();
+                slot.file = next++;
+                slot.pending = 2;
+                auto path = files[slot.file].path.c_str();
+                auto &open = ring->prepare(IORING_OP_OPENAT, AT_FDCWD, tag(s, Open));
+                open.addr = reinterpret_cast<std::uint64_t>(path);
+                open.open_flags = O_RDONLY | O_CLOEXEC;
+                auto &stat = ring->prepare(IORING_OP_STATX, AT_FDCWD, tag(s, Stat));
+                stat.addr = reinterpret_cast<std::uint64_t>(path);
+                stat.len = STATX_SIZE;
+                stat.off = reinterpret_cast<std::uint64_t>(&slot.st);
+                ++active;
+            };
+            auto readMore = [&](size_t s)
+            {
+                auto &slot = slots[s];
+                auto &read = ring->prepare(IORING_OP_READ, slot.fd, tag(s, Read));
+                read.addr = reinterpret_cast<std::uint64_t>(slot.data.data() + slot.filled);
+                read.len = static_cast<std::uint32_t>(std::min<size_t>(slot.data.size() - slot.filled, 1u << 30));
+                read.off = slot.filled;
+                ++slot.pending;
+            };
+            auto finish = [&](size_t s)
+            {
+                auto &slot = slots[s];
+                if (slot.fd >= 0)
+                    close(slot.fd);
+                --active;
+                if (slot.error)
+                {
+                    capture([&]
+                            {
+                        errno = slot.error;
+                        utils::Fail("Failed to read file: " + utils::PathText(files[slot.file].path)); });
+                }
+                else if (slot.data.size() == slot.filled && (slot.filled || slot.st.stx_size == 0))
+                {
+                    stats.bytes += slot.filled;
+                    deliver(slot.file, MappedFile::FromBuffer(std::move(slot.data)));
+                }
+                else
+                {
+                    deliver(slot.file, nullptr);
+                }
+                if (next < files.size() && !failed.load(std::memory_order_relaxed))
+                    start(s);
+            };
+            for (size_t s = 0; s < slots.size(); ++s)
+                start(s);
+            while (active)
+            {
+                ring->submitAndWait();
+                ring->reap([&](const io_uring_cqe &cqe)
+                           {
+                    auto s = static_cast<size_t>(cqe.user_data >> 2);
+                    auto &slot = slots[s];
+                    --slot.pending;
+                    switch (static_cast<Op>(cqe.user_data & 3))
+                    {
+                    case Open:
+                        if (cqe.res >= 0)
+                            slot.fd = cqe.res;
+                        else
+                            slot.error = -cqe.res;
+                        break;
+                    case Stat:
+                        if (cqe.res < 0)
+                            slot.error = -cqe.res;
+                        else if (reserve(slot.st.stx_size))
+                            slot.data.resize(slot.st.stx_size);
+                        break;
+                    case Read:
+                        if (cqe.res < 0 && cqe.res != -EINTR && cqe.res != -EAGAIN)
+                            slot.error = -cqe.res;
+                        else if (cqe.res == 0)
+                            slot.error = EIO; // the file shrank since statx
+                        else if (cqe.res > 0)
+                            slot.filled += static_cast<size_t>(cqe.res);
+                        break;
+                    }
+                    if (slot.pending)
+                        return;
+                    if (!slot.error && slot.fd >= 0 && slot.filled < slot.data.size())
+                        readMore(s);
+                    else
+                        finish(s); });
+                inFlightSum += active;
+                ++samples;
+                stats.maxInFlight = std::max(stats.maxInFlight, active);
+            }
+            done = true;
+        }
+#endif
+        if (!done)
+        {
+            // blocking reads only overlap on as many threads as reads should be in flight
+            ThreadPool io(depth);
+            std::atomic<size_t> active{0}, maxInFlight{0};
+            std::atomic<std::uint64_t> activeSum{0}, activeSamples{0}, bytes{0};
+            io.parallelFor(files.size(), [&](size_t i)
+                               {
+                if (failed.load(std::memory_order_relaxed))
+                    return;
+                auto now = ++active;
+                activeSum += now;
+                ++activeSamples;
+                for (auto seen = maxInFlight.load(); seen < now && !maxInFlight.compare_exchange_weak(seen, now);)
+                    ;
+                std::shared_ptr<MappedFile> file;
+                capture([&]
+                        {
+                    std::ifstream in(files[i].path, std::ios::binary | std::ios::ate);
+                    if (!in)
+                        utils::Fail("Failed to open file: " + utils::PathText(files[i].path));
+                    auto size = static_cast<std::uint64_t>(in.tellg());
+                    if (!reserve(size))
+                        return;
+                    std::vector<std::byte> data(size);
+                    in.seekg(0);
+                    in.read(reinterpret_cast<char *>(data.data()), static_cast<std::streamsize>(size));
+                    if (!in)
+                        utils::Fail("Failed to read file: " + utils::PathText(files[i].path));
+                    bytes += size;
+                    file = MappedFile::FromBuffer(std::move(data)); });
+                --active;
+                if (!failed.load(std::memory_order_relaxed))
+                    deliver(i, std::move(file)); });
+            stats.bytes = bytes;
+            stats.maxInFlight = maxInFlight;
+            inFlightSum = activeSum;
+            samples = activeSamples;
+        }
+
+        pool.wait();
+        stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        stats.averageInFlight = samples ? static_cast<double>(inFlightSum) / samples : 0;
+        if (error)
+            std::rethrow_exception(error);
+        return stats;
+    }
+}
@@ -0,0 +1,690 @@
+#include "platform.hpp"
+#include "utils.hpp"
+#include "pe_image.hpp"
+#include "mapped_file.hpp"
+#include "asset_format.hpp"
+#include "asset_bundle.hpp"
+#include "json.hpp"
+#include "icon_builder.hpp"
+#include "resource_updater.hpp"
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <spawn.h>
+#include <sys/wait.h>
+
+extern char **environ;
+#endif
+
+// 打包器基准测试：生成合成的基础程序与资源语料，逐阶段计时（图标、版本信息、资源打包、嵌入、写出），
+// 每个场景在独立子进程中运行，以便分别统计峰值内存，结果输出为 JSON
+namespace ezi::builder::packager::bench
+{
+    struct Options
+    {
+        std::filesystem::path workDir = std::filesystem::temp_directory_path() / "eziapp-packager-bench";
+        std::filesystem::path out;
+        std::vector<std::uint64_t> payloadSizes = {1ull << 20, 16ull << 20, 128ull << 20};
+        std::vector<std::uint64_t> fileCounts = {10, 1000, 10000};
+        std::vector<std::string> modes = {"resource", "overlay"};
+        std::string index = "json";
+        std::uint64_t exeSize = 4ull << 20;
+        size_t threads = 0;
+        bool keep = false;
+    };
+
+    struct Scenario
+    {
+        std::string kind; // payload | files
+        std::uint64_t value = 0;
+        std::string mode;
+
+        // payload-16M, files-1000
+        std::string name() const
+        {
+            if (kind == "files")
+                return kind + "-" + std::to_string(value);
+            static const char *const units[] = {"", "K", "M", "G"};
+            size_t unit = 0;
+            auto shown = value;
+            while (unit < 3 && shown >= 1024 && shown % 1024 == 0)
+            {
+                shown /= 1024;
+                ++unit;
+            }
+            return kind + "-" + std::to_string(shown) + units[unit];
+        }
+    };
+
+    // xorshift64*，保证各平台生成相同的语料
+    class Random
+    {
+    private:
+        std::uint64_t state;
+
+    public:
+        explicit Random(std::uint64_t seed) : state(seed ? seed : 0x9E3779B97F4A7C15ull) {}
+
+        std::uint64_t next()
+        {
+            state ^= state >> 12;
+            state ^= state << 25;
+            state ^= state >> 27;
+            return state * 0x2545F4914F6CDD1Dull;
+        }
+
+        std::uint64_t below(std::uint64_t bound) { return next() % bound; }
+
+        void fill(std::span<std::byte> bytes)
+        {
+            size_t at = 0;
+            for (; at + 8 <= bytes.size(); at += 8)
+            {
+                auto value = next();
+                std::memcpy(bytes.data() + at, &value, 8);
+            }
+            for (; at < bytes.size(); ++at)
+                bytes[at] = static_cast<std::byte>(next());
+        }
+    };
+
+    std::uint64_t ParseSize(const std::string &text)
+    {
+        size_t end = 0;
+        auto value = std::stoull(text, &end);
+        auto suffix = text.substr(end);
+        if (suffix == "K" || suffix == "k")
+            return value << 10;
+        if (suffix == "M" || suffix == "m")
+            return value << 20;
+        if (suffix == "G" || suffix == "g")
+            return value << 30;
+        if (!suffix.empty())
+            utils::Fail("Invalid size: " + text);
+        return value;
+    }
+
+    std::vector<std::uint64_t> ParseSizeList(const std::string &list)
+    {
+        std::vector<std::uint64_t> values;
+        std::stringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ','))
+            if (!item.empty())
+                values.push_back(ParseSize(item));
+        return values;
+    }
+
+    std::vector<std::string> ParseList(const std::string &list)
+    {
+        std::vector<std::string> values;
+        std::stringstream stream(list);
+        std::string item;
+        while (std::getline(stream, item, ','))
+            if (!item.empty())
+                values.push_back(item);
+        return values;
+    }
+
+    std::string FormatNumber(double value)
+    {
+        std::ostringstream out;
+        out << std::fixed << std::setprecision(3) << value;
+        return out.str();
+    }
+
+    void WriteFile(const std::filesystem::path &path, std::span<const std::byte> bytes)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+        if (!file)
+            utils::Fail("Failed to write " + path.string());
+    }
+
+    // 最小的 PE32+ GUI 程序：.text 填充随机字节，.rsrc 仅含空的资源目录，与打包器处理的 Electron 基础程序结构一致
+    void WriteSyntheticExe(const std::filesystem::path &path, std::uint64_t textSize)
+    {
+        constexpr std::uint32_t fileAlignment = 0x200;
+        constexpr std::uint32_t sectionAlignment = 0x1000;
+        constexpr std::uint32_t headersSize = 0x400;
+        constexpr std::uint32_t peOffset = 0x80;
+        constexpr std::uint32_t optionalHeaderSize = 240;
+
+        auto textRaw = utils::AlignUp<std::uint64_t>(std::max<std::uint64_t>(textSize, 16), fileAlignment);
+        if (textRaw > 0x7FFF0000)
+            utils::Fail("Synthetic executable is too large.");
+        std::uint32_t textVirtual = sectionAlignment;
+        std::uint32_t rsrcVirtual = utils::AlignUp<std::uint32_t>(textVirtual + static_cast<std::uint32_t>(textRaw), sectionAlignment);
+        std::uint32_t rsrcSize = sizeof(pe::ResourceDirectory);
+
+        std::vector<std::byte> headers(headersSize);
+        auto put = [&](size_t offset, auto value)
+        { std::memcpy(headers.data() + offset, &value, sizeof(value)); };
+
+        put(0, std::uint16_t{0x5A4D});
+        put(pe::layout::PeOffsetField, peOffset);
+        put(peOffset, pe::layout::PeSignature);
+
+        pe::FileHeader fileHeader = {};
+        fileHeader.machine = 0x8664;
+        fileHeader.numberOfSections = 2;
+        fileHeader.sizeOfOptionalHeader = optionalHeaderSize;
+        fileHeader.characteristics = 0x22; // EXECUTABLE_IMAGE | LARGE_ADDRESS_AWARE
+        put(peOffset + 4, fileHeader);
+
+        size_t optional = peOffset + 4 + sizeof(pe::FileHeader);
+        put(optional, pe::layout::Pe32PlusMagic);
+        put(optional + 4, static_cast<std::uint32_t>(textRaw)); // SizeOfCode
+        put(optional + pe::layout::SizeOfInitializedData, fileAlignment); // .rsrc
+        put(optional + 16, textVirtual); // AddressOfEntryPoint
+        put(optional + 20, textVirtual); // BaseOfCode
+        put(optional + 24, std::uint64_t{0x140000000}); // ImageBase
+        put(optional + pe::layout::SectionAlignment, sectionAlignment);
+        put(optional + pe::layout::FileAlignment, fileAlignment);
+        put(optional + 40, std::uint16_t{6}); // MajorOperatingSystemVersion
+        put(optional + 48, std::uint16_t{6}); // MajorSubsystemVersion
+        put(optional + pe::layout::SizeOfImage, utils::AlignUp(rsrcVirtual + rsrcSize, sectionAlignment));
+        put(optional + pe::layout::SizeOfHeaders, headersSize);
+        put(optional + 68, std::uint16_t{2}); // IMAGE_SUBSYSTEM_WINDOWS_GUI
+        put(optional + 70, std::uint16_t{0x8160}); // DllCharacteristics
+        put(optional + 72, std::uint64_t{0x100000}); // SizeOfStackReserve
+        put(optional + 80, std::uint64_t{0x1000}); // SizeOfStackCommit
+        put(optional + 88, std::uint64_t{0x100000}); // SizeOfHeapReserve
+        put(optional + 96, std::uint64_t{0x1000}); // SizeOfHeapCommit
+        put(optional + pe::layout::DataDirectories64 - 4, std::uint32_t{16}); // NumberOfRvaAndSizes
+        put(optional + pe::layout::DataDirectories64 + pe::layout::ResourceDirectory * sizeof(pe::DataDirectory),
+            pe::DataDirectory{rsrcVirtual, rsrcSize});
+
+        pe::SectionHeader text = {};
+        std::memcpy(text.name, ".text", 5);
+        text.virtualSize = static_cast<std::uint32_t>(textRaw);
+        text.virtualAddress = textVirtual;
+        text.sizeOfRawData = static_cast<std::uint32_t>(textRaw);
+        text.pointerToRawData = headersSize;
+        text.characteristics = 0x60000020; // CODE | MEM_EXECUTE | MEM_READ
+        put(optional + optionalHeaderSize, text);
+
+        pe::SectionHeader rsrc = {};
+        std::memcpy(rsrc.name, ".rsrc", 5);
+        rsrc.virtualSize = rsrcSize;
+        rsrc.virtualAddress = rsrcVirtual;
+        rsrc.sizeOfRawData = fileAlignment;
+        rsrc.pointerToRawData = static_cast<std::uint32_t>(headersSize + textRaw);
+        rsrc.characteristics = pe::layout::ResourceSectionFlags;
+        put(optional + optionalHeaderSize + sizeof(pe::SectionHeader), rsrc);
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char *>(headers.data()), headers.size());
+        Random random(textRaw);
+        std::vector<std::byte> chunk(1 << 20);
+        for (std::uint64_t written = 0; written < textRaw; written += chunk.size())
+        {
+            auto size = static_cast<size_t>(std::min<std::uint64_t>(chunk.size(), textRaw - written));
+            random.fill(std::span(chunk).first(size));
+            if (written == 0)
+                chunk[0] = std::byte{0xC3}; // ret
+            file.write(reinterpret_cast<const char *>(chunk.data()), size);
+        }
+        std::vector<std::byte> rsrcData(fileAlignment);
+        file.write(reinterpret_cast<const char *>(rsrcData.data()), rsrcData.size());
+        if (!file)
+            utils::Fail("Failed to write " + path.string());
+    }
+
+    // 不可压缩的随机数据，对应 --ezi-asset 传入的已打包资源文件
+    void WriteSyntheticPayload(const std::filesystem::path &path, std::uint64_t size)
+    {
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        Random random(size);
+        std::vector<std::byte> chunk(4 << 20);
+        for (std::uint64_t written = 0; written < size; written += chunk.size())
+        {
+            auto part = static_cast<size_t>(std::min<std::uint64_t>(chunk.size(), size - written));
+            random.fill(std::span(chunk).first(part));
+            file.write(reinterpret_cast<const char *>(chunk.data()), part);
+        }
+        if (!file)
+            utils::Fail("Failed to write " + path.string());
+    }
+
+    // 模拟前端构建产物：大部分为小体积的脚本与样式，少量大文件为不可压缩的图片，每 20 个文件重复一次已有内容
+    void WriteSyntheticCorpus(const std::filesystem::path &dir, std::uint64_t count)
+    {
+        static const char *const tokens[] = {
+            "function ", "return ", "const ", "let ", "this.", "export ", "import ", "=> ", "{", "}", "(", ")", ";\n",
+            "props", "state", "render", "value", "index", "length", "window.", "document.", "createElement", "\"div\"",
+            "undefined", "null", "true", "false", "0", "1", "if (", "else ", "for (", "async ", "await ", "new Promise",
+            ".then(", "console.log(", "color: #333;", "display: flex;", "margin: 0 auto;", "  ", "\n"};
+        constexpr size_t tokenCount = sizeof(tokens) / sizeof(tokens[0]);
+
+        auto assets = dir / "assets";
+        std::filesystem::create_directories(assets);
+        Random random(count);
+        std::vector<std::filesystem::path> written;
+        std::string text;
+        std::vector<std::byte> binary;
+        for (std::uint64_t i = 0; i < count; ++i)
+        {
+            auto folder = assets / ("d" + std::to_string(i / 256));
+            if (i % 256 == 0)
+                std::filesystem::create_directories(folder);
+            auto roll = random.below(100);
+            auto path = folder / ("f" + std::to_string(i) + (roll < 97 ? ".js" : ".png"));
+            if (i % 20 == 19 && !written.empty())
+            {
+                std::filesystem::copy_file(written[random.below(written.size())], path, std::filesystem::copy_options::overwrite_existing);
+                continue;
+            }
+            if (roll < 97)
+            {
+                auto size = roll < 85 ? 256 + random.below(8 << 10) : (8 << 10) + random.below(56 << 10);
+                text.clear();
+                while (text.size() < size)
+                    text += tokens[random.below(tokenCount)];
+                WriteFile(path, std::as_bytes(std::span(text)));
+            }
+            else
+            {
+                binary.resize((64 << 10) + random.below(960 << 10));
+                random.fill(binary);
+                WriteFile(path, binary);
+            }
+            written.push_back(path);
+        }
+        std::string config = "{\"name\":\"bench\",\"files\":" + std::to_string(count) + "}";
+        WriteFile(dir / "config.json", std::as_bytes(std::span(config)));
+    }
+
+    // 512x512 的渐变圆形图标，作为 --icon-png 的输入
+    std::vector<std::byte> SyntheticIconPng()
+    {
+        icon::Rgba8Image image;
+        image.width = image.height = 512;
+        image.pixels.resize(512 * 512 * 4);
+        for (std::uint32_t y = 0; y < 512; ++y)
+        {
+            for (std::uint32_t x = 0; x < 512; ++x)
+            {
+                auto *pixel = &image.pixels[(y * 512 + x) * 4];
+                int dx = static_cast<int>(x) - 256, dy = static_cast<int>(y) - 256;
+                pixel[0] = static_cast<std::uint8_t>(x / 2);
+                pixel[1] = static_cast<std::uint8_t>(y / 2);
+                pixel[2] = static_cast<std::uint8_t>(255 - x / 2);
+                pixel[3] = dx * dx + dy * dy < 240 * 240 ? 255 : 0;
+            }
+        }
+        return icon::EncodePng(image);
+    }
+
+    std::filesystem::path ExePath(const Options &options) { return options.workDir / ("base-" + std::to_string(options.exeSize) + ".exe"); }
+
+    std::filesystem::path InputPath(const Options &options, const Scenario &scenario)
+    {
+        return options.workDir / (scenario.kind == "payload" ? "payload-" + std::to_string(scenario.value) + ".bin"
+                                                             : "files-" + std::to_string(scenario.value));
+    }
+
+    // 已生成的输入可以在多次运行间复用，目录语料以 .complete 标记生成完成
+    void PrepareInputs(const Options &options, const std::vector<Scenario> &scenarios)
+    {
+        std::filesystem::create_directories(options.workDir);
+        auto exe = ExePath(options);
+        if (!std::filesystem::exists(exe))
+        {
+            std::cout << "Generating " << exe.filename().string() << "..." << std::endl;
+            WriteSyntheticExe(exe, options.exeSize);
+        }
+        for (auto &scenario : scenarios)
+        {
+            auto input = InputPath(options, scenario);
+            if (scenario.kind == "payload")
+            {
+                std::error_code error;
+                if (std::filesystem::file_size(input, error) == scenario.value)
+                    continue;
+                std::cout << "Generating " << input.filename().string() << "..." << std::endl;
+                WriteSyntheticPayload(input, scenario.value);
+            }
+            else if (!std::filesystem::exists(input / ".complete"))
+            {
+                std::cout << "Generating " << input.filename().string() << "..." << std::endl;
+                std::filesystem::remove_all(input);
+                WriteSyntheticCorpus(input, scenario.value);
+                WriteFile(input / ".complete", {});
+            }
+        }
+    }
+
+    // 子进程：运行单个场景，结果以 JSON 对象写入 resultPath
+    int RunScenario(const Options &options, const Scenario &scenario, const std::filesystem::path &resultPath)
+    {
+        auto mode = scenario.mode == "overlay" ? AssetMode::Overlay : AssetMode::Resource;
+        auto output = options.workDir / ("out-" + scenario.name() + "-" + scenario.mode + ".exe");
+        std::vector<std::pair<std::string, double>> stages;
+        auto timed = [&](const char *stage, const std::function<void()> &work)
+        {
+            auto start = std::chrono::steady_clock::now();
+            work();
+            stages.emplace_back(stage, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        };
+
+        auto png = SyntheticIconPng();
+        VersionInfo version = {};
+        version.companyName = u"EziApp";
+        version.fileDescription = u"EziApp packager benchmark";
+        version.fileVersion = u"1.0.0.0";
+        version.productName = u"Bench";
+        version.productVersion = u"1.0.0.0";
+        version.fileVersionParts[0] = version.productVersionParts[0] = 1;
+        version.languages = {0x0804, 0x0409};
+
+        std::uint64_t inputBytes = 0;   // what the scenario packages: the payload file or the asset files
+        std::uint64_t payloadBytes = 0; // what gets embedded: the payload file or the built bundle
+        std::uint64_t fileCount = 0;
+        ResourceUpdater updater(ExePath(options).string(), output.string(), false);
+
+        timed("icon", [&]
+              {
+            icon::IconSetStats stats;
+            auto ico = std::make_shared<std::vector<std::byte>>(icon::BuildIconSet(png, "synthetic.png", stats));
+            updater.updateIcon(ico, *ico); });
+        timed("versionInfo", [&]
+              { updater.updateVersionInfo(version); });
+        if (scenario.kind == "payload")
+        {
+            timed("assetEmbed", [&]
+                  {
+                auto file = MappedFile::Open(InputPath(options, scenario).string());
+                payloadBytes = inputBytes = file->bytes().size();
+                updater.updateAsset(file, mode); });
+        }
+        else
+        {
+            for (auto &entry : std::filesystem::recursive_directory_iterator(InputPath(options, scenario) / "assets"))
+                if (entry.is_regular_file())
+                    inputBytes += entry.file_size();
+            std::shared_ptr<AssetBundle> bundle;
+            timed("bundle", [&]
+                  {
+                AssetBundleOptions bundleOptions;
+                bundleOptions.assetDir = InputPath(options, scenario) / "assets";
+                bundleOptions.configPath = InputPath(options, scenario) / "config.json";
+                bundleOptions.threads = options.threads;
+                bundleOptions.index = options.index == "binary" ? format::IndexKind::Binary : format::IndexKind::Json;
+                bundle = AssetBundle::Build(bundleOptions); });
+            payloadBytes = bundle->size();
+            fileCount = bundle->manifest().size();
+            timed("assetEmbed", [&]
+                  { updater.updateAsset(bundle, mode); });
+        }
+        timed("finalize", [&]
+              { updater.finalize(); });
+
+        double totalMs = 0;
+        for (auto &stage : stages)
+            totalMs += stage.second;
+        std::error_code error;
+        auto outputBytes = std::filesystem::file_size(output, error);
+        if (!options.keep)
+            std::filesystem::remove(output, error);
+
+        std::string result = "{\"scenario\":";
+        json::AppendString(result, scenario.name());
+        result += ",\"kind\":";
+        json::AppendString(result, scenario.kind);
+        result += ",\"mode\":";
+        json::AppendString(result, scenario.mode);
+        if (scenario.kind == "files")
+        {
+            result += ",\"index\":";
+            json::AppendString(result, options.index);
+            result += ",\"files\":" + std::to_string(fileCount);
+        }
+        result += ",\"exeBytes\":" + std::to_string(options.exeSize);
+        result += ",\"inputBytes\":" + std::to_string(inputBytes);
+        result += ",\"payloadBytes\":" + std::to_string(payloadBytes);
+        result += ",\"outputBytes\":" + std::to_string(outputBytes);
+        result += ",\"stages\":{";
+        for (size_t i = 0; i < stages.size(); ++i)
+        {
+            if (i)
+                result += ",";
+            json::AppendString(result, stages[i].first);
+            result += ":" + FormatNumber(stages[i].second);
+        }
+        result += "},\"totalMs\":" + FormatNumber(totalMs);
+        result += ",\"throughputMBps\":" + FormatNumber(totalMs > 0 ? inputBytes / 1048576.0 / (totalMs / 1000) : 0);
+        if (scenario.kind == "files")
+            result += ",\"filesPerSecond\":" + FormatNumber(totalMs > 0 ? fileCount / (totalMs / 1000) : 0);
+        result += ",\"peakRssBytes\":" + std::to_string(utils::PeakResidentBytes()) + "}";
+        WriteFile(resultPath, std::as_bytes(std::span(result)));
+
+        std::cout << std::left << std::setw(14) << scenario.name() << std::setw(10) << scenario.mode;
+        for (auto &[stage, ms] : stages)
+            std::cout << stage << "=" << FormatNumber(ms) << "ms ";
+        std::cout << "peak=" << utils::PeakResidentBytes() / 1024 << "KB" << std::endl;
+        return 0;
+    }
+
+    // Runs this benchmark again with `args` and waits for it. No shell is involved, so paths need no quoting
+    // beyond what the Windows command line itself requires. True when the child exits with 0.
+    bool RunChild([[maybe_unused]] const char *self, const std::vector<std::string> &args)
+    {
+        std::cout.flush();
+#ifdef _WIN32
+        // quoted the way CommandLineToArgvW splits it again: backslashes only escape a following quote
+        auto quote = [](const std::wstring &arg)
+        {
+            std::wstring quoted = L"\"";
+            size_t backslashes = 0;
+            for (auto c : arg)
+            {
+                if (c == L'\\')
+                {
+                    ++backslashes;
+                    continue;
+                }
+                quoted.append(c == L'"' ? backslashes * 2 + 1 : backslashes, L'\\');
+                backslashes = 0;
+                quoted += c;
+            }
+            quoted.append(backslashes * 2, L'\\');
+            return quoted + L"\"";
+        };
+        // arguments arrive in the ANSI code page, as main's argv did
+        auto wide = [](const std::string &text)
+        {
+            int length = MultiByteToWideChar(CP_ACP, 0, text.c_str(), -1, nullptr, 0);
+            std::wstring result(length, L'\0');
+            MultiByteToWideChar(CP_ACP, 0, text.c_str(), -1, result.data(), length);
+            result.resize(length ? length - 1 : 0);
+            return result;
+        };
+        // argv[0] may lack the directory, the module path does not
+        std::wstring program(32768, L'\0');
+        program.resize(GetModuleFileNameW(nullptr, program.data(), static_cast<DWORD>(program.size())));
+        auto commandLine = quote(program);
+        for (auto &arg : args)
+            commandLine += L" " + quote(wide(arg));
+        STARTUPINFOW startup = {};
+        startup.cb = sizeof(startup);
+        PROCESS_INFORMATION process = {};
+        if (!CreateProcessW(program.c_str(), commandLine.data(), nullptr, nullptr, TRUE, 0, nullptr, nullptr, &startup, &process))
+            return false;
+        WaitForSingleObject(process.hProcess, INFINITE);
+        DWORD exitCode = 1;
+        GetExitCodeProcess(process.hProcess, &exitCode);
+        CloseHandle(process.hThread);
+        CloseHandle(process.hProcess);
+        return exitCode == 0;
+#else
+        std::vector<char *> argv{const_cast<char *>(self)};
+        for (auto &arg : args)
+            argv.push_back(const_cast<char *>(arg.c_str()));
+        argv.push_back(nullptr);
+        pid_t pid;
+        if (posix_spawnp(&pid, self, nullptr, nullptr, argv.data(), environ) != 0)
+            return false;
+        int status = 0;
+        while (waitpid(pid, &status, 0) < 0)
+            if (errno != EINTR)
+                return false;
+        return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+#endif
+    }
+
+    int Main(int argc, char *argv[])
+    {
+        Options options;
+        std::optional<Scenario> child;
+        std::filesystem::path childResult;
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            auto value = [&]() -> std::string
+            {
+                if (i + 1 >= argc)
+                    utils::Fail("Missing value for " + arg);
+                return argv[++i];
+            };
+            if (arg == "--help")
+            {
+                std::cout << "Usage: eziapp-packager-bench [options]\n"
+                             "  --work-dir <path>       Where synthetic inputs are generated and reused (default: temp dir)\n"
+                             "  --out <file.json>       Write results here (default: <work-dir>/results.json)\n"
+                             "  --sizes <1M,16M,...>    Asset payload sizes embedded with --ezi-asset semantics, up to 2G\n"
+                             "  --files <10,1000,...>   Asset file counts bundled with --ezi-asset-dir semantics, up to 100000\n"
+                             "  --modes <resource,overlay>  Asset modes compared side by side\n"
+                             "  --index <json|binary>   Asset index of the bundled corpora\n"
+                             "  --exe-size <size>       Size of the synthetic base executable's code section (default: 4M)\n"
+                             "  --threads <count>       Compression threads (default: all cores)\n"
+                             "  --full                  Sizes 1M..2G and file counts 10..100000\n"
+                             "  --keep                  Keep the packaged outputs\n";
+                return 0;
+            }
+            else if (arg == "--work-dir")
+                options.workDir = value();
+            else if (arg == "--out")
+                options.out = value();
+            else if (arg == "--sizes")
+                options.payloadSizes = ParseSizeList(value());
+            else if (arg == "--files")
+                options.fileCounts = ParseSizeList(value());
+            else if (arg == "--modes")
+                options.modes = ParseList(value());
+            else if (arg == "--index")
+                options.index = value();
+            else if (arg == "--exe-size")
+                options.exeSize = ParseSize(value());
+            else if (arg == "--threads")
+                options.threads = std::stoul(value());
+            else if (arg == "--full")
+            {
+                options.payloadSizes = {1ull << 20, 16ull << 20, 256ull << 20, 1ull << 30, 2ull << 30};
+                options.fileCounts = {10, 100, 1000, 10000, 100000};
+            }
+            else if (arg == "--keep")
+                options.keep = true;
+            else if (arg == "--run")
+            {
+                // 内部参数：--run <kind> <value> <mode> <result.json>
+                Scenario scenario;
+                scenario.kind = value();
+                scenario.value = ParseSize(value());
+                scenario.mode = value();
+                childResult = value();
+                child = scenario;
+            }
+            else
+                utils::Fail("Unknown option: " + arg);
+        }
+        for (auto &mode : options.modes)
+            if (mode != "resource" && mode != "overlay")
+                utils::Fail("Unknown asset mode: " + mode);
+        if (options.index != "json" && options.index != "binary")
+            utils::Fail("Unknown asset index: " + options.index);
+
+        if (child)
+            return RunScenario(options, *child, childResult);
+
+        std::vector<Scenario> scenarios;
+        for (auto size : options.payloadSizes)
+            for (auto &mode : options.modes)
+                scenarios.push_back({"payload", size, mode});
+        for (auto count : options.fileCounts)
+            for (auto &mode : options.modes)
+                scenarios.push_back({"files", count, mode});
+        PrepareInputs(options, scenarios);
+
+        // 每个场景一个子进程，峰值内存互不影响
+        std::vector<std::string> forwarded = {"--work-dir", options.workDir.string(), "--index", options.index,
+                                              "--exe-size", std::to_string(options.exeSize), "--threads", std::to_string(options.threads)};
+        if (options.keep)
+            forwarded.push_back("--keep");
+        std::vector<std::string> results;
+        for (auto &scenario : scenarios)
+        {
+            auto resultPath = options.workDir / ("result-" + scenario.name() + "-" + scenario.mode + ".json");
+            std::error_code error;
+            std::filesystem::remove(resultPath, error);
+            auto args = forwarded;
+            args.insert(args.end(), {"--run", scenario.kind, std::to_string(scenario.value), scenario.mode, resultPath.string()});
+            if (!RunChild(argv[0], args) || !std::filesystem::exists(resultPath))
+            {
+                std::cerr << "Scenario " << scenario.name() << " (" << scenario.mode << ") failed." << std::endl;
+                continue;
+            }
+            std::ifstream file(resultPath, std::ios::binary);
+            results.emplace_back(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+            file.close();
+            std::filesystem::remove(resultPath, error);
+        }
+
+        std::string report = "{\"version\":1,\"platform\":";
+#if defined(_WIN32)
+        json::AppendString(report, "windows");
+#elif defined(__APPLE__)
+        json::AppendString(report, "macos");
+#else
+        json::AppendString(report, "linux");
+#endif
+        report += ",\"hardwareThreads\":" + std::to_string(std::thread::hardware_concurrency());
+        report += ",\"threads\":" + std::to_string(options.threads);
+        report += ",\"results\":[";
+        for (size_t i = 0; i < results.size(); ++i)
+            report += (i ? ",\n" : "\n") + results[i];
+        report += "\n]}\n";
+
+        auto out = options.out.empty() ? options.workDir / "results.json" : options.out;
+        WriteFile(out, std::as_bytes(std::span(report)));
+        std::cout << "Results written to " << out.string() << std::endl;
+        return results.size() == scenarios.size() ? 0 : EXIT_FAILURE;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    try
+    {
+        return ezi::builder::packager::bench::Main(argc, argv);
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << error.what() << std::endl;
+        return EXIT_FAILURE;
+    }
+}
@@ -0,0 +1,138 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <vector>
+#include <zstd.h>
+
+namespace ezi::builder::packager
+{
+    // Container formats whose payload is already entropy coded. zstd gains next to nothing on them.
+    inline std::string_view CompressedFormat(std::span<const std::byte> data)
+    {
+        auto starts = [&](size_t at, std::string_view magic)
+        { return data.size() >= at + magic.size() && std::memcmp(data.data() + at, magic.data(), magic.size()) == 0; };
+
+        if (starts(0, "\x89PNG\r\n\x1a\n"))
+            return "png";
+        if (starts(0, "\xff\xd8\xff"))
+            return "jpeg";
+        if (starts(0, "GIF87a") || starts(0, "GIF89a"))
+            return "gif";
+        if (starts(0, "RIFF") && starts(8, "WEBP"))
+            return "webp";
+        if (starts(0, "wOF2") || starts(0, "wOFF"))
+            return "woff";
+        if (starts(4, "ftyp"))
+            return "mp4"; // also mov, m4a, heic and avif
+        if (starts(0, "\x1a\x45\xdf\xa3"))
+            return "webm";
+        if (starts(0, "OggS"))
+            return "ogg";
+        if (starts(0, "fLaC"))
+            return "flac";
+        if (starts(0, "ID3") || (data.size() >= 2 && data[0] == std::byte{0xff} && (static_cast<std::uint8_t>(data[1]) & 0xe0) == 0xe0))
+            return "mp3";
+        if (starts(0, "PK\x03\x04"))
+            return "zip";
+        if (starts(0, "\x1f\x8b"))
+            return "gzip";
+        if (starts(0, "\x28\xb5\x2f\xfd"))
+            return "zstd";
+        if (starts(0, "\xfd" "7zXZ"))
+            return "xz";
+        if (starts(0, "BZh"))
+            return "bzip2";
+        if (starts(0, "7z\xbc\xaf\x27\x1c"))
+            return "7z";
+        return {};
+    }
+
+    // Order-0 entropy in bits per byte over up to three 64KB samples (head, middle, tail).
+    // The histogram is split over four tables fed 16 bytes per iteration, so consecutive equal bytes do
+    // not serialize on one counter; this is what keeps byte histograms near memory speed.
+    inline double SampledEntropy(std::span<const std::byte> data)
+    {
+        constexpr size_t sampleSize = 64 << 10;
+        std::uint32_t counts[4][256] = {};
+        size_t total = 0;
+        auto count = [&](std::span<const std::byte> sample)
+        {
+            auto *bytes = reinterpret_cast<const std::uint8_t *>(sample.data());
+            size_t i = 0;
+            for (; i + 16 <= sample.size(); i += 16)
+            {
+                std::uint64_t a, b;
+                std::memcpy(&a, bytes + i, 8);
+                std::memcpy(&b, bytes + i + 8, 8);
+                for (int shift = 0; shift < 64; shift += 16)
+                {
+                    ++counts[0][(a >> shift) & 0xff];
+                    ++counts[1][(a >> (shift + 8)) & 0xff];
+                    ++counts[2][(b >> shift) & 0xff];
+                    ++counts[3][(b >> (shift + 8)) & 0xff];
+                }
+            }
+            for (; i < sample.size(); ++i)
+                ++counts[0][bytes[i]];
+            total += sample.size();
+        };
+
+        if (data.size() <= sampleSize * 3)
+        {
+            count(data);
+        }
+        else
+        {
+            count(data.first(sampleSize));
+            count(data.subspan(data.size() / 2 - sampleSize / 2, sampleSize));
+            count(data.last(sampleSize));
+        }
+        if (total == 0)
+            return 0;
+
+        double entropy = 0;
+        for (int value = 0; value < 256; ++value)
+        {
+            auto n = counts[0][value] + counts[1][value] + counts[2][value] + counts[3][value];
+            if (n == 0)
+                continue;
+            double p = static_cast<double>(n) / total;
+            entropy -= p * std::log2(p);
+        }
+        return entropy;
+    }
+
+    // Files below this are always tried with zstd: detection would cost about as much as compressing them.
+    constexpr std::uint64_t RawDetectionMinSize = 4096;
+    constexpr double IncompressibleEntropy = 7.8;
+    // Known containers only need to look mostly random, which rules out e.g. PNGs saved without deflate.
+    constexpr double CompressedFormatEntropy = 7.0;
+
+    // Byte statistics miss repeats (an uncompressed image of a tiled pattern looks random byte by byte),
+    // so candidates are confirmed by compressing one 64KB sample at the fastest level.
+    inline bool SampleCompresses(std::span<const std::byte> data)
+    {
+        constexpr size_t sampleSize = 64 << 10;
+        auto sample = data.size() <= sampleSize ? data : data.subspan(data.size() / 2 - sampleSize / 2, sampleSize);
+        thread_local std::vector<std::byte> buffer(ZSTD_compressBound(sampleSize));
+        auto size = ZSTD_compress(buffer.data(), buffer.size(), sample.data(), sample.size(), 1);
+        return !ZSTD_isError(size) && size < sample.size() - sample.size() / 32;
+    }
+
+    // True when the bytes should be stored raw instead of as a zstd frame.
+    inline bool IsIncompressible(std::span<const std::byte> data)
+    {
+        if (data.size() < RawDetectionMinSize)
+            return false;
+        auto entropy = SampledEntropy(data);
+        if (entropy < IncompressibleEntropy && (entropy < CompressedFormatEntropy || CompressedFormat(data).empty()))
+            return false;
+        return !SampleCompresses(data);
+    }
+}
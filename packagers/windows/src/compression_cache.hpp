@@ -0,0 +1,122 @@
+#pragma once
+
+#include "utils.hpp"
+#include "hash.hpp"
+#include "zstd_codec.hpp"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+#include <zstd.h>
+
+namespace ezi::builder::packager
+{
+    // Content-addressed store of compressed frames, shared between builds. A frame is keyed by the digest and
+    // size of the raw content plus everything that changes the compressed bytes, so a hit never needs validation
+    // beyond a cheap header check. Entries are written to a temp file and renamed into place, which keeps
+    // concurrent builds sharing one cache directory safe.
+    class CompressionCache
+    {
+    private:
+        static constexpr const char *LayoutVersion = "v1";
+
+        std::filesystem::path root;
+        std::atomic<size_t> hits{0};
+        std::atomic<size_t> misses{0};
+        std::atomic<std::uint64_t> hitBytes{0};
+
+        std::filesystem::path entryPath(const std::string &key) const
+        {
+            return root / LayoutVersion / key.substr(0, 2) / (key + ".zst");
+        }
+
+    public:
+        explicit CompressionCache(std::filesystem::path root) : root(std::move(root)) {}
+
+        static std::string Key(const hash::Digest128 &digest, std::uint64_t rawSize, int level, unsigned dictionaryId = 0, std::uint32_t chunkSize = 0)
+        {
+            auto key = digest.hex() + "-" + std::to_string(rawSize) + "-l" + std::to_string(level);
+            if (dictionaryId)
+                key += "-d" + std::to_string(dictionaryId);
+            if (chunkSize)
+                key += "-c" + std::to_string(chunkSize);
+            return key;
+        }
+
+        std::optional<std::vector<std::byte>> load(const std::string &key, std::uint64_t rawSize, unsigned dictionaryId = 0)
+        {
+            std::ifstream file(entryPath(key), std::ios::binary | std::ios::ate);
+            if (!file)
+            {
+                ++misses;
+                return std::nullopt;
+            }
+            std::vector<std::byte> frame(static_cast<size_t>(file.tellg()));
+            file.seekg(0);
+            file.read(reinterpret_cast<char *>(frame.data()), static_cast<std::streamsize>(frame.size()));
+            // a truncated or foreign file is treated as a miss and overwritten by the caller
+            bool valid;
+            if (auto table = file ? ReadSeekTable(frame) : std::nullopt)
+            {
+                // chunked entry: the seek table must account for every byte
+                std::uint64_t decompressed = 0;
+                for (auto &entry : *table)
+                    decompressed += entry.decompressedSize;
+                valid = decompressed == rawSize && dictionaryId == 0;
+            }
+            else
+            {
+                valid = file && ZSTD_getFrameContentSize(frame.data(), frame.size()) == rawSize &&
+                        ZSTD_findFrameCompressedSize(frame.data(), frame.size()) == frame.size() &&
+                        ZSTD_getDictID_fromFrame(frame.data(), frame.size()) == dictionaryId;
+            }
+            if (!valid)
+            {
+                ++misses;
+                return std::nullopt;
+            }
+            ++hits;
+            hitBytes += frame.size();
+            return frame;
+        }
+
+        // Failing to populate the cache is not fatal, the build simply stays uncached.
+        void store(const std::string &key, std::span<const std::byte> frame)
+        {
+            auto target = entryPath(key);
+            std::error_code error;
+            std::filesystem::create_directories(target.parent_path(), error);
+            auto temp = target;
+            // unique per process and thread, another build may be writing the same key right now
+            static const auto processTag = std::random_device{}();
+            temp += ".tmp" + std::to_string(processTag) + "-" + std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+            {
+                std::ofstream file(temp, std::ios::binary | std::ios::trunc);
+                if (!file)
+                    return;
+                file.write(reinterpret_cast<const char *>(frame.data()), static_cast<std::streamsize>(frame.size()));
+                if (!file)
+                {
+                    file.close();
+                    std::filesystem::remove(temp, error);
+                    return;
+                }
+            }
+            std::filesystem::rename(temp, target, error);
+            if (error)
+                std::filesystem::remove(temp, error);
+        }
+
+        size_t hitCount() const { return hits.load(); }
+        size_t missCount() const { return misses.load(); }
+        std::uint64_t hitByteCount() const { return hitBytes.load(); }
+    };
+}
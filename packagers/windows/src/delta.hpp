@@ -0,0 +1,939 @@
+#pragma once
+
+#include "utils.hpp"
+#include "hash.hpp"
+#include "json.hpp"
+#include "mapped_file.hpp"
+#include "pe_image.hpp"
+#include "asset_format.hpp"
+#include "asset_index.hpp"
+#include "zstd_codec.hpp"
+#include "thread_pool.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <span>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <zstd.h>
+
+namespace ezi::builder::packager::delta
+{
+    // Suffix array over a reference buffer, sorted with Larsson-Sadakane prefix doubling as in bsdiff.
+    // Building needs 8 bytes per reference byte, the finished array keeps 4.
+    class SuffixArray
+    {
+    private:
+        std::span<const std::byte> text;
+        std::vector<std::int32_t> index;
+
+        static void Split(std::int32_t *I, std::int32_t *V, std::int64_t start, std::int64_t length, std::int64_t h)
+        {
+            while (true)
+            {
+                if (length < 16)
+                {
+                    for (std::int64_t k = start, j; k < start + length; k += j)
+                    {
+                        j = 1;
+                        auto x = V[I[k] + h];
+                        for (std::int64_t i = 1; k + i < start + length; ++i)
+                        {
+                            if (V[I[k + i] + h] < x)
+                            {
+                                x = V[I[k + i] + h];
+                                j = 0;
+                            }
+                            if (V[I[k + i] + h] == x)
+                            {
+                                std::swap(I[k + j], I[k + i]);
+                                ++j;
+                            }
+                        }
+                        for (std::int64_t i = 0; i < j; ++i)
+                            V[I[k + i]] = static_cast<std::int32_t>(k + j - 1);
+                        if (j == 1)
+                            I[k] = -1;
+                    }
+                    return;
+                }
+
+                auto x = V[I[start + length / 2] + h];
+                std::int64_t jj = 0, kk = 0;
+                for (std::int64_t i = start; i < start + length; ++i)
+                {
+                    if (V[I[i] + h] < x)
+                        ++jj;
+                    if (V[I[i] + h] == x)
+                        ++kk;
+                }
+                jj += start;
+                kk += jj;
+
+                std::int64_t i = start, j = 0, k = 0;
+                while (i < jj)
+                {
+                    if (V[I[i] + h] < x)
+                        ++i;
+                    else if (V[I[i] + h] == x)
+                        std::swap(I[i], I[jj + j++]);
+                    else
+                        std::swap(I[i], I[kk + k++]);
+                }
+                while (jj + j < kk)
+                {
+                    if (V[I[jj + j] + h] == x)
+                        ++j;
+                    else
+                        std::swap(I[jj + j], I[kk + k++]);
+                }
+
+                if (jj > start)
+                    Split(I, V, start, jj - start, h);
+                for (i = 0; i < kk - jj; ++i)
+                    V[I[jj + i]] = static_cast<std::int32_t>(kk - 1);
+                if (jj == kk - 1)
+                    I[jj] = -1;
+                // the upper partition is handled by the loop instead of recursing, which bounds the stack depth
+                if (start + length <= kk)
+                    return;
+                length = start + length - kk;
+                start = kk;
+            }
+        }
+
+        static std::int64_t MatchLength(std::span<const std::byte> a, std::span<const std::byte> b)
+        {
+            auto limit = std::min(a.size(), b.size());
+            size_t i = 0;
+            while (i < limit && a[i] == b[i])
+                ++i;
+            return static_cast<std::int64_t>(i);
+        }
+
+    public:
+        explicit SuffixArray(std::span<const std::byte> text) : text(text)
+        {
+            if (text.size() >= INT32_MAX)
+                utils::Fail("Delta reference window exceeds 2GB.");
+            auto n = static_cast<std::int64_t>(text.size());
+            index.resize(n + 1);
+            std::vector<std::int32_t> rank(n + 1);
+            auto *I = index.data();
+            auto *V = rank.data();
+
+            std::int64_t buckets[256] = {};
+            for (auto b : text)
+                ++buckets[static_cast<std::uint8_t>(b)];
+            for (int i = 1; i < 256; ++i)
+                buckets[i] += buckets[i - 1];
+            for (int i = 255; i > 0; --i)
+                buckets[i] = buckets[i - 1];
+            buckets[0] = 0;
+            for (std::int64_t i = 0; i < n; ++i)
+                I[++buckets[static_cast<std::uint8_t>(text[i])]] = static_cast<std::int32_t>(i);
+            I[0] = static_cast<std::int32_t>(n);
+            for (std::int64_t i = 0; i < n; ++i)
+                V[i] = static_cast<std::int32_t>(buckets[static_cast<std::uint8_t>(text[i])]);
+            V[n] = 0;
+            for (int i = 1; i < 256; ++i)
+                if (buckets[i] == buckets[i - 1] + 1)
+                    I[buckets[i]] = -1;
+            I[0] = -1;
+
+            for (std::int64_t h = 1; I[0] != -(n + 1); h += h)
+            {
+                std::int64_t length = 0, i = 0;
+                while (i < n + 1)
+                {
+                    if (I[i] < 0)
+                    {
+                        length -= I[i];
+                        i -= I[i];
+                    }
+                    else
+                    {
+                        if (length)
+                            I[i - length] = static_cast<std::int32_t>(-length);
+                        length = V[I[i]] + 1 - i;
+                        Split(I, V, i, length, h);
+                        i += length;
+                        length = 0;
+                    }
+                }
+                if (length)
+                    I[i - length] = static_cast<std::int32_t>(-length);
+            }
+            for (std::int64_t i = 0; i < n + 1; ++i)
+                I[V[i]] = static_cast<std::int32_t>(i);
+        }
+
+        std::span<const std::byte> reference() const { return text; }
+
+        // Longest prefix of `target` occurring in the reference; returns its length and sets `position`.
+        std::int64_t longestMatch(std::span<const std::byte> target, std::int64_t &position) const
+        {
+            std::int64_t st = 0, en = static_cast<std::int64_t>(text.size());
+            while (en - st >= 2)
+            {
+                auto x = st + (en - st) / 2;
+                auto suffix = text.subspan(index[x]);
+                auto length = std::min(suffix.size(), target.size());
+                if (std::memcmp(suffix.data(), target.data(), length) < 0)
+                    st = x;
+                else
+                    en = x;
+            }
+            auto x = MatchLength(text.subspan(index[st]), target);
+            auto y = MatchLength(text.subspan(index[en]), target);
+            position = x > y ? index[st] : index[en];
+            return std::max(x, y);
+        }
+    };
+
+    // bsdiff control/diff/extra stream, uncompressed:
+    //   [u64 control count][control count x (u64 diffLength, u64 extraLength, i64 seek)][diff bytes][extra bytes]
+    // Each control adds diffLength bytes of (new - old) starting at the old cursor, copies extraLength bytes
+    // verbatim, then moves the old cursor by seek.
+    inline std::vector<std::byte> Diff(const SuffixArray &suffixes, std::span<const std::byte> target)
+    {
+        auto old = suffixes.reference();
+        auto oldSize = static_cast<std::int64_t>(old.size());
+        auto newSize = static_cast<std::int64_t>(target.size());
+        std::vector<std::int64_t> controls;
+        std::vector<std::byte> diff, extra;
+        diff.reserve(target.size());
+
+        std::int64_t scan = 0, length = 0, position = 0;
+        std::int64_t lastScan = 0, lastPosition = 0, lastOffset = 0;
+        auto at = [&](std::int64_t i)
+        { return old[static_cast<size_t>(i)]; };
+        while (scan < newSize)
+        {
+            std::int64_t oldScore = 0;
+            std::int64_t scoreScan = scan += length;
+            for (; scan < newSize; ++scan)
+            {
+                length = suffixes.longestMatch(target.subspan(scan), position);
+                for (; scoreScan < scan + length; ++scoreScan)
+                    if (scoreScan + lastOffset < oldSize && at(scoreScan + lastOffset) == target[scoreScan])
+                        ++oldScore;
+                if ((length == oldScore && length != 0) || length > oldScore + 8)
+                    break;
+                if (scan + lastOffset < oldSize && at(scan + lastOffset) == target[scan])
+                    --oldScore;
+            }
+            if (length == oldScore && scan != newSize)
+                continue;
+
+            std::int64_t forward = 0;
+            {
+                std::int64_t s = 0, best = 0;
+                for (std::int64_t i = 0; lastScan + i < scan && lastPosition + i < oldSize;)
+                {
+                    if (at(lastPosition + i) == target[lastScan + i])
+                        ++s;
+                    ++i;
+                    if (s * 2 - i > best * 2 - forward)
+                    {
+                        best = s;
+                        forward = i;
+                    }
+                }
+            }
+            std::int64_t backward = 0;
+            if (scan < newSize)
+            {
+                std::int64_t s = 0, best = 0;
+                for (std::int64_t i = 1; scan >= lastScan + i && position >= i; ++i)
+                {
+                    if (at(position - i) == target[scan - i])
+                        ++s;
+                    if (s * 2 - i > best * 2 - backward)
+                    {
+                        best = s;
+                        backward = i;
+                    }
+                }
+            }
+            if (lastScan + forward > scan - backward)
+            {
+                auto overlap = (lastScan + forward) - (scan - backward);
+                std::int64_t s = 0, best = 0, split = 0;
+                for (std::int64_t i = 0; i < overlap; ++i)
+                {
+                    if (target[lastScan + forward - overlap + i] == at(lastPosition + forward - overlap + i))
+                        ++s;
+                    if (target[scan - backward + i] == at(position - backward + i))
+                        --s;
+                    if (s > best)
+                    {
+                        best = s;
+                        split = i + 1;
+                    }
+                }
+                forward += split - overlap;
+                backward -= split;
+            }
+
+            for (std::int64_t i = 0; i < forward; ++i)
+                diff.push_back(static_cast<std::byte>(static_cast<std::uint8_t>(target[lastScan + i]) - static_cast<std::uint8_t>(at(lastPosition + i))));
+            auto extraLength = (scan - backward) - (lastScan + forward);
+            extra.insert(extra.end(), target.begin() + (lastScan + forward), target.begin() + (lastScan + forward + extraLength));
+            controls.push_back(forward);
+            controls.push_back(extraLength);
+            controls.push_back((position - backward) - (lastPosition + forward));
+
+            lastScan = scan - backward;
+            lastPosition = position - backward;
+            lastOffset = position - scan;
+        }
+
+        std::uint64_t count = controls.size() / 3;
+        std::vector<std::byte> stream(sizeof(count) + controls.size() * sizeof(std::int64_t) + diff.size() + extra.size());
+        auto *out = stream.data();
+        std::memcpy(out, &count, sizeof(count));
+        out += sizeof(count);
+        if (!controls.empty())
+            std::memcpy(out, controls.data(), controls.size() * sizeof(std::int64_t));
+        out += controls.size() * sizeof(std::int64_t);
+        if (!diff.empty())
+            std::memcpy(out, diff.data(), diff.size());
+        out += diff.size();
+        if (!extra.empty())
+            std::memcpy(out, extra.data(), extra.size());
+        return stream;
+    }
+
+    // Rebuilds the target of Diff(); false when the stream does not fit the reference or the expected size.
+    inline bool Patch(std::span<const std::byte> old, std::span<const std::byte> stream, std::span<std::byte> target)
+    {
+        std::uint64_t count;
+        if (stream.size() < sizeof(count))
+            return false;
+        std::memcpy(&count, stream.data(), sizeof(count));
+        if (count > (stream.size() - sizeof(count)) / (3 * sizeof(std::int64_t)))
+            return false;
+        std::vector<std::int64_t> controls(count * 3);
+        if (count)
+            std::memcpy(controls.data(), stream.data() + sizeof(count), controls.size() * sizeof(std::int64_t));
+        auto diff = stream.subspan(sizeof(count) + controls.size() * sizeof(std::int64_t));
+
+        std::uint64_t diffTotal = 0;
+        for (std::uint64_t i = 0; i < count; ++i)
+        {
+            if (controls[i * 3] < 0 || controls[i * 3 + 1] < 0)
+                return false;
+            diffTotal += controls[i * 3];
+        }
+        if (diffTotal > diff.size())
+            return false;
+        auto extra = diff.subspan(diffTotal);
+        diff = diff.first(diffTotal);
+
+        std::int64_t oldCursor = 0;
+        size_t newCursor = 0, diffCursor = 0, extraCursor = 0;
+        for (std::uint64_t i = 0; i < count; ++i)
+        {
+            auto diffLength = static_cast<size_t>(controls[i * 3]);
+            auto extraLength = static_cast<size_t>(controls[i * 3 + 1]);
+            if (diffLength > target.size() - newCursor || oldCursor < 0 ||
+                static_cast<std::uint64_t>(oldCursor) + diffLength > old.size())
+                return false;
+            for (size_t k = 0; k < diffLength; ++k)
+                target[newCursor + k] = static_cast<std::byte>(static_cast<std::uint8_t>(diff[diffCursor + k]) + static_cast<std::uint8_t>(old[oldCursor + k]));
+            newCursor += diffLength;
+            diffCursor += diffLength;
+            oldCursor += static_cast<std::int64_t>(diffLength);
+
+            if (extraLength > target.size() - newCursor || extraLength > extra.size() - extraCursor)
+                return false;
+            std::memcpy(target.data() + newCursor, extra.data() + extraCursor, extraLength);
+            newCursor += extraLength;
+            extraCursor += extraLength;
+            oldCursor += controls[i * 3 + 2];
+        }
+        return newCursor == target.size();
+    }
+
+    // Where the stored asset frames of a packaged executable are, in file offsets. Everything else is the core.
+    struct Layout
+    {
+        struct Frame
+        {
+            std::uint64_t offset;
+            std::uint64_t size;
+            std::vector<std::string> ids;
+        };
+        std::vector<Frame> frames; // sorted by offset, non-overlapping
+        std::vector<format::DeltaRange> core;
+        std::uint64_t coreSize = 0;
+    };
+
+    inline std::optional<std::span<const std::byte>> FindBundle(std::span<const std::byte> file, const std::shared_ptr<MappedFile> &owner)
+    {
+        format::OverlayFooter footer;
+        if (file.size() >= sizeof(footer))
+        {
+            std::memcpy(&footer, file.data() + file.size() - sizeof(footer), sizeof(footer));
+            if (std::memcmp(footer.magic, format::OverlayMagic, sizeof(footer.magic)) == 0 &&
+                footer.offset <= file.size() - sizeof(footer) && footer.length <= file.size() - sizeof(footer) - footer.offset)
+                return file.subspan(footer.offset, footer.length);
+        }
+        if (file.size() < 2 || file[0] != std::byte{'M'} || file[1] != std::byte{'Z'})
+            return std::nullopt;
+        pe::Image image(file, owner, true);
+        auto type = image.resources().find(pe::ResourceId(std::uint16_t(10)));
+        if (type == image.resources().end())
+            return std::nullopt;
+        auto name = type->second.find(pe::ResourceId(std::uint16_t(1004)));
+        if (name == type->second.end() || name->second.empty() || name->second.begin()->second.parts.size() != 1)
+            return std::nullopt;
+        return name->second.begin()->second.parts.front();
+    }
+
+    struct BundleEntry
+    {
+        std::string id;
+        std::uint64_t offset; // relative to the bundle start
+        std::uint64_t size;
+    };
+
+    // Entries of the binary index, or of the JSON manifest frame before the trailing u32 size. Anything
+    // unexpected yields no entries.
+    inline std::vector<BundleEntry> ReadBundleEntries(std::span<const std::byte> bundle)
+    {
+        std::vector<BundleEntry> entries;
+        if (auto index = AssetIndexReader::Open(bundle))
+        {
+            for (auto &entry : index->all())
+                entries.push_back({std::string(index->id(entry)), entry.offset, entry.size});
+        }
+        else if (bundle.size() >= sizeof(std::uint32_t))
+        {
+            std::uint32_t manifestSize;
+            std::memcpy(&manifestSize, bundle.data() + bundle.size() - sizeof(manifestSize), sizeof(manifestSize));
+            if (manifestSize <= bundle.size() - sizeof(manifestSize))
+            {
+                auto frame = bundle.subspan(bundle.size() - sizeof(manifestSize) - manifestSize, manifestSize);
+                auto rawSize = ZSTD_getFrameContentSize(frame.data(), frame.size());
+                if (rawSize != ZSTD_CONTENTSIZE_ERROR && rawSize != ZSTD_CONTENTSIZE_UNKNOWN && rawSize < (256ull << 20))
+                {
+                    std::string manifest(rawSize, '\0');
+                    auto size = ZSTD_decompress(manifest.data(), manifest.size(), frame.data(), frame.size());
+                    if (!ZSTD_isError(size) && size == rawSize && !manifest.empty() && manifest.front() == '{')
+                    {
+                        auto root = json::Parser(manifest, "asset manifest").parse();
+                        if (auto members = root.object())
+                        {
+                            for (auto &[id, value] : *members)
+                            {
+                                auto offset = value.find("offset");
+                                auto length = value.find("size");
+                                if (offset && offset->number() && length && length->number())
+                                    entries.push_back({id, static_cast<std::uint64_t>(*offset->number()), static_cast<std::uint64_t>(*length->number())});
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        return entries;
+    }
+
+    // Frames are taken from the bundle entries; anything unexpected leaves the whole file as core, which
+    // still diffs correctly, only less precisely.
+    inline Layout ReadLayout(std::span<const std::byte> file, const std::shared_ptr<MappedFile> &owner)
+    {
+        Layout layout;
+        std::map<std::uint64_t, Layout::Frame> frames;
+        if (auto bundle = FindBundle(file, owner))
+        {
+            auto base = static_cast<std::uint64_t>(bundle->data() - file.data());
+            for (auto &entry : ReadBundleEntries(*bundle))
+            {
+                if (entry.size == 0 || entry.offset > bundle->size() || entry.size > bundle->size() - entry.offset)
+                    continue;
+                auto &frame = frames[base + entry.offset];
+                frame.offset = base + entry.offset;
+                frame.size = std::max(frame.size, entry.size);
+                frame.ids.push_back(std::move(entry.id));
+            }
+        }
+
+        std::uint64_t cursor = 0;
+        for (auto &[offset, frame] : frames)
+        {
+            if (offset < cursor)
+                continue; // overlapping entries would make the layout ambiguous, keep the first
+            if (offset > cursor)
+                layout.core.push_back({cursor, offset - cursor});
+            cursor = offset + frame.size;
+            layout.frames.push_back(std::move(frame));
+        }
+        if (cursor < file.size())
+            layout.core.push_back({cursor, file.size() - cursor});
+        for (auto &range : layout.core)
+            layout.coreSize += range.size;
+        return layout;
+    }
+
+    // Copies [start, start + length) of the concatenated ranges.
+    inline std::vector<std::byte> Gather(std::span<const std::byte> file, std::span<const format::DeltaRange> ranges, std::uint64_t start, std::uint64_t length)
+    {
+        std::vector<std::byte> out;
+        out.reserve(length);
+        std::uint64_t position = 0;
+        for (auto &range : ranges)
+        {
+            if (out.size() == length)
+                break;
+            if (position + range.size > start)
+            {
+                auto from = start > position ? start - position : 0;
+                auto take = std::min(range.size - from, length - out.size());
+                auto bytes = file.subspan(range.offset + from, take);
+                out.insert(out.end(), bytes.begin(), bytes.end());
+            }
+            position += range.size;
+        }
+        return out;
+    }
+
+    // Blocks tasks until their working memory fits, so concurrent diffs stay under --delta-memory.
+    class MemoryBudget
+    {
+    private:
+        std::uint64_t capacity;
+        std::uint64_t used = 0;
+        std::mutex mutex;
+        std::condition_variable released;
+
+    public:
+        explicit MemoryBudget(std::uint64_t capacity) : capacity(capacity) {}
+
+        std::uint64_t acquire(std::uint64_t bytes)
+        {
+            bytes = std::min(bytes, capacity);
+            std::unique_lock lock(mutex);
+            released.wait(lock, [&]
+                          { return used + bytes <= capacity; });
+            used += bytes;
+            return bytes;
+        }
+
+        void release(std::uint64_t bytes)
+        {
+            {
+                std::lock_guard lock(mutex);
+                used -= bytes;
+            }
+            released.notify_all();
+        }
+    };
+
+    struct Options
+    {
+        size_t threads = 0;
+        std::uint64_t memoryBudget = 1ull << 30;
+        int compressionLevel = 19; // patches are built once and downloaded many times
+        std::uint64_t chunkSize = 8ull << 20;
+    };
+
+    struct Stats
+    {
+        std::uint64_t newSize = 0;
+        std::uint64_t patchSize = 0;
+        std::uint64_t copiedBytes = 0;
+        std::uint64_t diffedBytes = 0;
+        std::uint64_t literalBytes = 0;
+        size_t ops = 0;
+    };
+
+    inline std::uint64_t HashFile(std::span<const std::byte> file)
+    {
+        hash::Xxh64 hasher;
+        constexpr size_t slice = 16 << 20;
+        for (size_t at = 0; at < file.size(); at += slice)
+            hasher.update(file.subspan(at, std::min(slice, file.size() - at)));
+        return hasher.digest();
+    }
+
+    // Per asset frame: an identical old frame becomes a Copy, a changed frame with the same id is diffed against
+    // its previous version, anything else is stored. The rest of the file is diffed against the old core in
+    // reference windows sized to the memory budget, in chunks spread over the thread pool.
+    inline Stats Create(const std::string &oldPath, const std::string &newPath, const std::string &patchPath, const Options &options)
+    {
+        trace::Scope scope("delta");
+        auto oldFile = MappedFile::Open(oldPath);
+        auto newFile = MappedFile::Open(newPath);
+        auto old = oldFile->bytes();
+        auto target = newFile->bytes();
+        auto oldLayout = ReadLayout(old, oldFile);
+        auto newLayout = ReadLayout(target, newFile);
+        ThreadPool pool(options.threads);
+
+        format::DeltaHeader header{};
+        std::memcpy(header.magic, format::DeltaMagic, sizeof(header.magic));
+        header.version = format::DeltaVersion;
+        header.hashAlgorithm = format::HashAlgorithm::Xxh64;
+        header.oldSize = old.size();
+        header.newSize = target.size();
+        {
+            trace::Scope hashScope("hash", "phase", old.size() + target.size());
+            pool.parallelFor(2, [&](size_t i)
+                             {
+                if (i == 0)
+                    header.oldHash = HashFile(old);
+                else
+                    header.newHash = HashFile(target); });
+        }
+
+        struct Piece
+        {
+            format::DeltaOp op{};
+            std::vector<std::byte> data; // Diff ops only, Literal data is streamed from the new file
+            std::uint64_t newOffset = 0;
+            std::uint64_t coreOffset = 0; // position in the new core, for core pieces
+            const Layout::Frame *frame = nullptr;
+        };
+        // A reference window with its margins (1.5 windows at 9 bytes each) takes 3/4 of the budget. Chunks are at most
+        // a quarter window so that one mapped anywhere inside a window is still covered by its margins.
+        auto maxWindow = std::clamp<std::uint64_t>(options.memoryBudget / 18, 256 << 10, INT32_MAX / 2);
+        auto chunkSize = std::clamp<std::uint64_t>(options.chunkSize, 64 << 10, maxWindow / 4);
+        // never below what the smallest window and its chunks take, or a window would hold the whole budget while
+        // its chunks wait for it
+        MemoryBudget budget(std::max(options.memoryBudget, maxWindow * 18));
+        std::vector<Piece> pieces;
+        {
+            std::uint64_t coreCursor = 0;
+            auto addCore = [&](std::uint64_t offset, std::uint64_t size)
+            {
+                for (std::uint64_t at = 0; at < size; at += chunkSize)
+                {
+                    Piece piece;
+                    piece.newOffset = offset + at;
+                    piece.coreOffset = coreCursor + at;
+                    piece.op.newSize = std::min(chunkSize, size - at);
+                    pieces.push_back(std::move(piece));
+                }
+                coreCursor += size;
+            };
+            std::uint64_t cursor = 0;
+            for (auto &frame : newLayout.frames)
+            {
+                addCore(cursor, frame.offset - cursor);
+                Piece piece;
+                piece.newOffset = frame.offset;
+                piece.op.newSize = frame.size;
+                piece.frame = &frame;
+                pieces.push_back(std::move(piece));
+                cursor = frame.offset + frame.size;
+            }
+            addCore(cursor, target.size() - cursor);
+        }
+
+        // asset frames: exact matches by content, then previous versions by id
+        {
+            trace::Scope assetScope("deltaAssets");
+            std::unordered_map<std::uint64_t, std::vector<const Layout::Frame *>> byHash;
+            std::unordered_map<std::string_view, const Layout::Frame *> byId;
+            std::vector<std::uint64_t> oldHashes(oldLayout.frames.size());
+            pool.parallelFor(oldLayout.frames.size(), [&](size_t i)
+                             { oldHashes[i] = hash::Xxh64::Of(old.subspan(oldLayout.frames[i].offset, oldLayout.frames[i].size)); });
+            for (size_t i = 0; i < oldLayout.frames.size(); ++i)
+            {
+                byHash[oldHashes[i]].push_back(&oldLayout.frames[i]);
+                for (auto &id : oldLayout.frames[i].ids)
+                    byId.emplace(id, &oldLayout.frames[i]);
+            }
+
+            pool.parallelFor(pieces.size(), [&](size_t p)
+                             {
+                auto &piece = pieces[p];
+                if (!piece.frame)
+                    return;
+                auto bytes = target.subspan(piece.frame->offset, piece.frame->size);
+                auto candidates = byHash.find(hash::Xxh64::Of(bytes));
+                if (candidates != byHash.end())
+                {
+                    for (auto *candidate : candidates->second)
+                    {
+                        if (candidate->size == bytes.size() && std::memcmp(old.data() + candidate->offset, bytes.data(), bytes.size()) == 0)
+                        {
+                            piece.op.kind = format::DeltaOpKind::Copy;
+                            piece.op.oldOffset = candidate->offset;
+                            piece.op.oldSize = candidate->size;
+                            return;
+                        }
+                    }
+                }
+
+                piece.op.kind = format::DeltaOpKind::Literal;
+                const Layout::Frame *previous = nullptr;
+                for (auto &id : piece.frame->ids)
+                {
+                    auto it = byId.find(id);
+                    if (it != byId.end())
+                    {
+                        previous = it->second;
+                        break;
+                    }
+                }
+                auto cost = previous ? previous->size * 9 + bytes.size() * 3 : 0;
+                if (!previous || cost > options.memoryBudget || previous->size >= INT32_MAX)
+                    return;
+                auto reserved = budget.acquire(cost);
+                trace::Scope diffScope("diff", "asset", bytes.size());
+                diffScope.detail(piece.frame->ids.front());
+                auto reference = old.subspan(previous->offset, previous->size);
+                auto stream = Diff(SuffixArray(reference), bytes);
+                auto frame = CompressFrame(stream, options.compressionLevel);
+                budget.release(reserved);
+                diffScope.bytesOut(frame.size());
+                if (frame.size() >= bytes.size())
+                    return;
+                piece.op.kind = format::DeltaOpKind::Diff;
+                piece.op.space = format::DeltaSpace::File;
+                piece.op.oldOffset = previous->offset;
+                piece.op.oldSize = previous->size;
+                piece.data = std::move(frame); });
+        }
+
+        // core: one suffix array per reference window, built once and shared by every chunk mapped onto it
+        {
+            trace::Scope coreScope("deltaCore", "phase", newLayout.coreSize);
+            std::vector<size_t> corePieces;
+            for (size_t p = 0; p < pieces.size(); ++p)
+                if (!pieces[p].frame)
+                    corePieces.push_back(p);
+
+            auto windows = std::max<std::uint64_t>(1, (oldLayout.coreSize + maxWindow - 1) / maxWindow);
+            auto window = (oldLayout.coreSize + windows - 1) / windows;
+            auto margin = windows > 1 ? window / 4 : 0;
+            std::vector<std::vector<size_t>> assigned(windows);
+            for (auto p : corePieces)
+            {
+                // chunk centres map proportionally onto the old core, which tracks insertions and removals well enough
+                auto centre = pieces[p].coreOffset + pieces[p].op.newSize / 2;
+                auto mapped = newLayout.coreSize ? centre * oldLayout.coreSize / newLayout.coreSize : 0;
+                assigned[std::min<std::uint64_t>(mapped / std::max<std::uint64_t>(window, 1), windows - 1)].push_back(p);
+            }
+
+            for (std::uint64_t w = 0; w < windows; ++w)
+            {
+                if (assigned[w].empty())
+                    continue;
+                auto start = w * window > margin ? w * window - margin : 0;
+                auto end = std::min(oldLayout.coreSize, (w + 1) * window + margin);
+                auto reserved = budget.acquire((end - start) * 9);
+                auto reference = Gather(old, oldLayout.core, start, end - start);
+                std::optional<SuffixArray> suffixes;
+                {
+                    trace::Scope sortScope("suffixSort", "phase", reference.size());
+                    suffixes.emplace(reference);
+                }
+                pool.parallelFor(assigned[w].size(), [&](size_t i)
+                                 {
+                    auto &piece = pieces[assigned[w][i]];
+                    auto chunkReserved = budget.acquire(piece.op.newSize * 3);
+                    trace::Scope diffScope("diff", "core", piece.op.newSize);
+                    auto frame = CompressFrame(Diff(*suffixes, target.subspan(piece.newOffset, piece.op.newSize)), options.compressionLevel);
+                    budget.release(chunkReserved);
+                    diffScope.bytesOut(frame.size());
+                    if (frame.size() >= piece.op.newSize)
+                    {
+                        piece.op.kind = format::DeltaOpKind::Literal;
+                        return;
+                    }
+                    piece.op.kind = format::DeltaOpKind::Diff;
+                    piece.op.space = format::DeltaSpace::Core;
+                    piece.op.oldOffset = start;
+                    piece.op.oldSize = end - start;
+                    piece.data = std::move(frame); });
+                suffixes.reset();
+                budget.release(reserved);
+            }
+        }
+
+        Stats stats;
+        stats.newSize = target.size();
+        stats.ops = pieces.size();
+        header.coreRangeCount = static_cast<std::uint32_t>(oldLayout.core.size());
+        header.opCount = static_cast<std::uint32_t>(pieces.size());
+        std::uint64_t dataOffset = sizeof(header) + oldLayout.core.size() * sizeof(format::DeltaRange) + pieces.size() * sizeof(format::DeltaOp);
+        for (auto &piece : pieces)
+        {
+            piece.op.dataOffset = dataOffset;
+            if (piece.op.kind == format::DeltaOpKind::Literal)
+                piece.op.dataSize = piece.op.newSize;
+            else if (piece.op.kind == format::DeltaOpKind::Diff)
+                piece.op.dataSize = piece.data.size();
+            dataOffset += piece.op.dataSize;
+            (piece.op.kind == format::DeltaOpKind::Copy ? stats.copiedBytes : piece.op.kind == format::DeltaOpKind::Diff ? stats.diffedBytes
+                                                                                                                      : stats.literalBytes) += piece.op.newSize;
+        }
+        stats.patchSize = dataOffset;
+
+        trace::Scope writeScope("write");
+        auto writePath = patchPath + ".tmp";
+        utils::RemoveOnFailure cleanup(writePath);
+        {
+            std::ofstream out(writePath, std::ios::binary | std::ios::trunc);
+            if (!out)
+                utils::Fail("Failed to create patch file.");
+            auto put = [&](const void *data, size_t size)
+            { out.write(static_cast<const char *>(data), static_cast<std::streamsize>(size)); };
+            put(&header, sizeof(header));
+            if (!oldLayout.core.empty())
+                put(oldLayout.core.data(), oldLayout.core.size() * sizeof(format::DeltaRange));
+            for (auto &piece : pieces)
+                put(&piece.op, sizeof(piece.op));
+            for (auto &piece : pieces)
+            {
+                if (piece.op.kind == format::DeltaOpKind::Literal)
+                    put(target.data() + piece.newOffset, piece.op.newSize);
+                else if (piece.op.kind == format::DeltaOpKind::Diff)
+                    put(piece.data.data(), piece.data.size());
+            }
+            out.close();
+            if (!out)
+                utils::Fail("Failed to write patch file.");
+        }
+        writeScope.bytesOut(stats.patchSize);
+        std::error_code error;
+        std::filesystem::rename(writePath, patchPath, error);
+        if (error)
+            utils::Fail("Failed to replace patch file.");
+        cleanup.release();
+        return stats;
+    }
+
+    // Verifies the old file against the patch, streams the new file to a temp path and only renames it into place
+    // once its hash matches.
+    inline void Apply(const std::string &oldPath, const std::string &patchPath, const std::string &newPath)
+    {
+        trace::Scope scope("deltaApply");
+        auto oldFile = MappedFile::Open(oldPath);
+        auto patchFile = MappedFile::Open(patchPath);
+        auto old = oldFile->bytes();
+        auto patch = patchFile->bytes();
+
+        format::DeltaHeader header;
+        if (patch.size() < sizeof(header))
+            utils::Fail("Not a delta patch: " + patchPath);
+        std::memcpy(&header, patch.data(), sizeof(header));
+        if (std::memcmp(header.magic, format::DeltaMagic, sizeof(header.magic)) != 0 || header.version != format::DeltaVersion ||
+            header.hashAlgorithm != format::HashAlgorithm::Xxh64)
+            utils::Fail("Not a supported delta patch: " + patchPath);
+        auto tableSize = static_cast<std::uint64_t>(header.coreRangeCount) * sizeof(format::DeltaRange) +
+                         static_cast<std::uint64_t>(header.opCount) * sizeof(format::DeltaOp);
+        if (tableSize > patch.size() - sizeof(header))
+            utils::Fail("Truncated delta patch: " + patchPath);
+        if (old.size() != header.oldSize || HashFile(old) != header.oldHash)
+            utils::Fail("The patch was not created from " + oldPath + ".");
+
+        std::vector<format::DeltaRange> core(header.coreRangeCount);
+        std::vector<format::DeltaOp> ops(header.opCount);
+        if (!core.empty())
+            std::memcpy(core.data(), patch.data() + sizeof(header), core.size() * sizeof(format::DeltaRange));
+        if (!ops.empty())
+            std::memcpy(ops.data(), patch.data() + sizeof(header) + core.size() * sizeof(format::DeltaRange), ops.size() * sizeof(format::DeltaOp));
+        std::uint64_t coreSize = 0;
+        for (auto &range : core)
+        {
+            if (range.offset > old.size() || range.size > old.size() - range.offset)
+                utils::Fail("Malformed delta patch: core range outside of the old file.");
+            coreSize += range.size;
+        }
+
+        auto writePath = newPath + ".tmp";
+        utils::RemoveOnFailure cleanup(writePath);
+        hash::Xxh64 hasher;
+        std::uint64_t written = 0;
+        {
+            std::ofstream out(writePath, std::ios::binary | std::ios::trunc);
+            if (!out)
+                utils::Fail("Failed to create output file.");
+            auto put = [&](std::span<const std::byte> bytes)
+            {
+                hasher.update(bytes);
+                out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+                written += bytes.size();
+            };
+            std::vector<std::byte> buffer, stream;
+            for (auto &op : ops)
+            {
+                auto malformed = [&]
+                { utils::Fail("Malformed delta patch: bad operation at output offset " + std::to_string(written) + "."); };
+                if (op.dataOffset > patch.size() || op.dataSize > patch.size() - op.dataOffset)
+                    malformed();
+                auto data = patch.subspan(op.dataOffset, op.dataSize);
+                switch (op.kind)
+                {
+                case format::DeltaOpKind::Copy:
+                    if (op.oldOffset > old.size() || op.newSize > old.size() - op.oldOffset)
+                        malformed();
+                    put(old.subspan(op.oldOffset, op.newSize));
+                    break;
+                case format::DeltaOpKind::Literal:
+                    if (data.size() != op.newSize)
+                        malformed();
+                    put(data);
+                    break;
+                case format::DeltaOpKind::Diff:
+                {
+                    auto rawSize = ZSTD_getFrameContentSize(data.data(), data.size());
+                    if (rawSize == ZSTD_CONTENTSIZE_ERROR || rawSize == ZSTD_CONTENTSIZE_UNKNOWN || rawSize > op.newSize * 3 + (1 << 20))
+                        malformed();
+                    stream.resize(rawSize);
+                    if (ZSTD_decompress(stream.data(), stream.size(), data.data(), data.size()) != rawSize)
+                        malformed();
+                    std::vector<std::byte> gathered;
+                    std::span<const std::byte> reference;
+                    if (op.space == format::DeltaSpace::File)
+                    {
+                        if (op.oldOffset > old.size() || op.oldSize > old.size() - op.oldOffset)
+                            malformed();
+                        reference = old.subspan(op.oldOffset, op.oldSize);
+                    }
+                    else
+                    {
+                        if (op.oldOffset > coreSize || op.oldSize > coreSize - op.oldOffset)
+                            malformed();
+                        gathered = Gather(old, core, op.oldOffset, op.oldSize);
+                        reference = gathered;
+                    }
+                    buffer.resize(op.newSize);
+                    if (!Patch(reference, stream, buffer))
+                        malformed();
+                    put(buffer);
+                    break;
+                }
+                default:
+                    malformed();
+                }
+            }
+            out.close();
+            if (!out)
+                utils::Fail("Failed to write output file.");
+        }
+        std::error_code error;
+        if (written != header.newSize || hasher.digest() != header.newHash)
+            utils::Fail("Patched output does not match the expected hash.");
+        utils::SyncFile(writePath);
+        std::filesystem::rename(writePath, newPath, error);
+        if (error)
+            utils::Fail("Failed to replace output file.");
+        cleanup.release();
+    }
+}
@@ -0,0 +1,362 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#ifdef _MSC_VER
+#include <intrin.h>
+#define EZI_CRC32C_TARGET
+#else
+#include <cpuid.h>
+#include <nmmintrin.h>
+#define EZI_CRC32C_TARGET __attribute__((target("sse4.2")))
+#endif
+#define EZI_CRC32C_SSE42 1
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define EZI_CRC32C_TARGET
+#define EZI_CRC32C_ARM 1
+#endif
+
+namespace ezi::builder::packager::hash
+{
+    // Streaming XXH64, bit-compatible with the reference implementation.
+    class Xxh64
+    {
+    private:
+        static constexpr std::uint64_t P1 = 11400714785074694791ULL;
+        static constexpr std::uint64_t P2 = 14029467366897019727ULL;
+        static constexpr std::uint64_t P3 = 1609587929392839161ULL;
+        static constexpr std::uint64_t P4 = 9650029242287828579ULL;
+        static constexpr std::uint64_t P5 = 2870177450012600261ULL;
+
+        std::uint64_t seed;
+        std::uint64_t v[4];
+        std::uint64_t totalLength = 0;
+        std::byte buffer[32];
+        size_t buffered = 0;
+
+        static std::uint64_t rotl(std::uint64_t x, int r) { return (x << r) | (x >> (64 - r)); }
+
+        static std::uint64_t read64(const std::byte *p)
+        {
+            std::uint64_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        static std::uint32_t read32(const std::byte *p)
+        {
+            std::uint32_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        static std::uint64_t round(std::uint64_t acc, std::uint64_t input)
+        {
+            acc += input * P2;
+            acc = rotl(acc, 31);
+            return acc * P1;
+        }
+
+        static std::uint64_t mergeRound(std::uint64_t acc, std::uint64_t value)
+        {
+            acc ^= round(0, value);
+            return acc * P1 + P4;
+        }
+
+        void consumeStripe(const std::byte *p)
+        {
+            v[0] = round(v[0], read64(p));
+            v[1] = round(v[1], read64(p + 8));
+            v[2] = round(v[2], read64(p + 16));
+            v[3] = round(v[3], read64(p + 24));
+        }
+
+    public:
+        explicit Xxh64(std::uint64_t seed = 0) : seed(seed)
+        {
+            v[0] = seed + P1 + P2;
+            v[1] = seed + P2;
+            v[2] = seed;
+            v[3] = seed - P1;
+        }
+
+        void update(std::span<const std::byte> data)
+        {
+            const std::byte *p = data.data();
+            size_t length = data.size();
+            totalLength += length;
+
+            if (buffered + length < 32)
+            {
+                if (length)
+                    std::memcpy(buffer + buffered, p, length);
+                buffered += length;
+                return;
+            }
+            if (buffered)
+            {
+                size_t fill = 32 - buffered;
+                std::memcpy(buffer + buffered, p, fill);
+                consumeStripe(buffer);
+                p += fill;
+                length -= fill;
+                buffered = 0;
+            }
+            for (; length >= 32; p += 32, length -= 32)
+                consumeStripe(p);
+            if (length)
+                std::memcpy(buffer, p, length);
+            buffered = length;
+        }
+
+        std::uint64_t digest() const
+        {
+            std::uint64_t h;
+            if (totalLength >= 32)
+            {
+                h = rotl(v[0], 1) + rotl(v[1], 7) + rotl(v[2], 12) + rotl(v[3], 18);
+                for (auto lane : v)
+                    h = mergeRound(h, lane);
+            }
+            else
+            {
+                h = seed + P5;
+            }
+            h += totalLength;
+
+            const std::byte *p = buffer;
+            size_t length = buffered;
+            for (; length >= 8; p += 8, length -= 8)
+            {
+                h ^= round(0, read64(p));
+                h = rotl(h, 27) * P1 + P4;
+            }
+            if (length >= 4)
+            {
+                h ^= static_cast<std::uint64_t>(read32(p)) * P1;
+                h = rotl(h, 23) * P2 + P3;
+                p += 4;
+                length -= 4;
+            }
+            for (; length > 0; ++p, --length)
+            {
+                h ^= static_cast<std::uint64_t>(std::to_integer<std::uint8_t>(*p)) * P5;
+                h = rotl(h, 11) * P1;
+            }
+
+            h ^= h >> 33;
+            h *= P2;
+            h ^= h >> 29;
+            h *= P3;
+            h ^= h >> 32;
+            return h;
+        }
+
+        static std::uint64_t Of(std::span<const std::byte> data, std::uint64_t seed = 0)
+        {
+            Xxh64 state(seed);
+            state.update(data);
+            return state.digest();
+        }
+    };
+
+    // Streaming CRC32C (Castagnoli), as used by iSCSI, ext4 and SSE4.2's crc32 instruction. Uses the instruction
+    // on x86-64 when the CPU has it and on ARMv8 builds with the CRC extension, table-driven slicing-by-8 elsewhere.
+    // CRCs of consecutive ranges can be combined without the data, so per-asset CRCs also give the payload's.
+    class Crc32c
+    {
+    private:
+        static constexpr std::uint32_t Polynomial = 0x82F63B78; // reflected
+
+        static constexpr auto Tables = []
+        {
+            std::array<std::array<std::uint32_t, 256>, 8> tables{};
+            for (std::uint32_t i = 0; i < 256; ++i)
+            {
+                auto crc = i;
+                for (int bit = 0; bit < 8; ++bit)
+                    crc = crc & 1 ? (crc >> 1) ^ Polynomial : crc >> 1;
+                tables[0][i] = crc;
+            }
+            for (int k = 1; k < 8; ++k)
+                for (int i = 0; i < 256; ++i)
+                    tables[k][i] = (tables[k - 1][i] >> 8) ^ tables[0][tables[k - 1][i] & 0xFF];
+            return tables;
+        }();
+
+        std::uint32_t state = 0xFFFFFFFF;
+
+        static std::uint64_t read64(const std::byte *p)
+        {
+            std::uint64_t value;
+            std::memcpy(&value, p, sizeof(value));
+            return value;
+        }
+
+        // a * b modulo the polynomial, both as reflected polynomials
+        static std::uint32_t multiply(std::uint32_t a, std::uint32_t b)
+        {
+            std::uint32_t product = 0;
+            for (std::uint32_t m = 1u << 31; m; m >>= 1)
+            {
+                if (a & m)
+                    product ^= b;
+                b = b & 1 ? (b >> 1) ^ Polynomial : b >> 1;
+            }
+            return product;
+        }
+
+        // x^(8 * length) modulo the polynomial: multiplying a CRC register by it appends `length` zero bytes
+        static std::uint32_t zeroBytesOperator(std::uint64_t length)
+        {
+            static const auto powers = []
+            {
+                std::array<std::uint32_t, 64> table{}; // x^(2^k)
+                table[0] = 1u << 30;
+                for (size_t k = 1; k < table.size(); ++k)
+                    table[k] = multiply(table[k - 1], table[k - 1]);
+                return table;
+            }();
+            std::uint32_t result = 1u << 31; // x^0
+            for (size_t k = 3; length; length >>= 1, ++k)
+                if (length & 1)
+                    result = multiply(powers[k], result);
+            return result;
+        }
+
+        static std::uint32_t extendSoftware(std::uint32_t crc, const std::byte *p, size_t length)
+        {
+            for (; length >= 8; p += 8, length -= 8)
+            {
+                auto word = read64(p) ^ crc;
+                crc = Tables[7][word & 0xFF] ^ Tables[6][(word >> 8) & 0xFF] ^ Tables[5][(word >> 16) & 0xFF] ^
+                      Tables[4][(word >> 24) & 0xFF] ^ Tables[3][(word >> 32) & 0xFF] ^ Tables[2][(word >> 40) & 0xFF] ^
+                      Tables[1][(word >> 48) & 0xFF] ^ Tables[0][word >> 56];
+            }
+            for (; length; ++p, --length)
+                crc = (crc >> 8) ^ Tables[0][(crc ^ std::to_integer<std::uint8_t>(*p)) & 0xFF];
+            return crc;
+        }
+
+#if defined(EZI_CRC32C_SSE42) || defined(EZI_CRC32C_ARM)
+        EZI_CRC32C_TARGET static std::uint64_t step(std::uint64_t crc, std::uint64_t word)
+        {
+#ifdef EZI_CRC32C_SSE42
+            return _mm_crc32_u64(crc, word);
+#else
+            return __crc32cd(static_cast<std::uint32_t>(crc), word);
+#endif
+        }
+
+        // The instruction has a latency of about three cycles but a throughput of one per cycle, so large inputs
+        // are split into three lanes hashed together and joined with zeroBytesOperator.
+        EZI_CRC32C_TARGET static std::uint32_t extendHardware(std::uint32_t crc, const std::byte *p, size_t length)
+        {
+            constexpr size_t lane = 8192;
+            static const std::uint32_t shiftOne = zeroBytesOperator(lane);
+            static const std::uint32_t shiftTwo = zeroBytesOperator(2 * lane);
+            for (; length >= 3 * lane; p += 3 * lane, length -= 3 * lane)
+            {
+                std::uint64_t a = crc, b = 0, c = 0;
+                for (size_t i = 0; i < lane; i += 8)
+                {
+                    a = step(a, read64(p + i));
+                    b = step(b, read64(p + lane + i));
+                    c = step(c, read64(p + 2 * lane + i));
+                }
+                crc = multiply(shiftTwo, static_cast<std::uint32_t>(a)) ^ multiply(shiftOne, static_cast<std::uint32_t>(b)) ^ static_cast<std::uint32_t>(c);
+            }
+            std::uint64_t wide = crc;
+            for (; length >= 8; p += 8, length -= 8)
+                wide = step(wide, read64(p));
+            return extendSoftware(static_cast<std::uint32_t>(wide), p, length);
+        }
+
+        static bool hardwareSupported()
+        {
+#if defined(EZI_CRC32C_ARM)
+            return true;
+#elif defined(_MSC_VER)
+            int info[4];
+            __cpuid(info, 1);
+            return (info[2] & (1 << 20)) != 0;
+#else
+            unsigned eax, ebx, ecx, edx;
+            return __get_cpuid(1, &eax, &ebx, &ecx, &edx) && (ecx & bit_SSE4_2);
+#endif
+        }
+#endif
+
+    public:
+        void update(std::span<const std::byte> data)
+        {
+#if defined(EZI_CRC32C_SSE42) || defined(EZI_CRC32C_ARM)
+            static const bool hardware = hardwareSupported();
+            if (hardware)
+            {
+                state = extendHardware(state, data.data(), data.size());
+                return;
+            }
+#endif
+            state = extendSoftware(state, data.data(), data.size());
+        }
+
+        std::uint32_t digest() const { return ~state; }
+
+        static std::uint32_t Of(std::span<const std::byte> data)
+        {
+            Crc32c state;
+            state.update(data);
+            return state.digest();
+        }
+
+        // CRC of A followed by B from the CRCs of A and B.
+        static std::uint32_t Combine(std::uint32_t first, std::uint32_t second, std::uint64_t secondLength)
+        {
+            return multiply(zeroBytesOperator(secondLength), first) ^ second;
+        }
+    };
+
+    // 128-bit content digest made of two independently seeded XXH64 lanes, used to address cached frames.
+    struct Digest128
+    {
+        std::uint64_t low = 0;
+        std::uint64_t high = 0;
+
+        bool operator==(const Digest128 &) const = default;
+        bool operator<(const Digest128 &other) const { return high != other.high ? high < other.high : low < other.low; }
+
+        std::string hex() const
+        {
+            static const char digits[] = "0123456789abcdef";
+            std::string text(32, '0');
+            for (int i = 0; i < 16; ++i)
+            {
+                text[15 - i] = digits[(high >> (i * 4)) & 0xF];
+                text[31 - i] = digits[(low >> (i * 4)) & 0xF];
+            }
+            return text;
+        }
+    };
+
+    inline Digest128 ContentDigest(std::span<const std::byte> data)
+    {
+        Xxh64 low(0), high(0x9E3779B97F4A7C15ULL);
+        constexpr size_t slice = 64 << 10;
+        for (size_t at = 0; at < data.size(); at += slice)
+        {
+            auto part = data.subspan(at, std::min(slice, data.size() - at));
+            low.update(part);
+            high.update(part);
+        }
+        return {low.digest(), high.digest()};
+    }
+}
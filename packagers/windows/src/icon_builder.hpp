@@ -0,0 +1,326 @@
+#pragma once
+
+#include "utils.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <numbers>
+#include <span>
+#include <string>
+#include <vector>
+#include <png.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define EZI_ICON_SSE2 1
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#define EZI_ICON_NEON 1
+#endif
+
+namespace ezi::builder::packager::icon
+{
+    // Standard Windows icon sizes; shell views pick the nearest entry instead of scaling a single 256px image.
+    constexpr std::uint32_t StandardSizes[] = {16, 24, 32, 48, 64, 256};
+    // Entries at least this large are stored PNG-compressed, smaller ones as 32bpp DIBs for old shell code paths.
+    constexpr std::uint32_t PngEntryMinSize = 64;
+    constexpr std::uint32_t MaxSourceDimension = 16384;
+
+    struct Rgba8Image
+    {
+        std::uint32_t width = 0;
+        std::uint32_t height = 0;
+        std::vector<std::uint8_t> pixels; // RGBA, straight alpha, top-down
+    };
+
+    // Premultiplied RGBA as floats, 4 lanes per pixel so a pixel maps onto one SIMD register.
+    struct FloatImage
+    {
+        std::uint32_t width = 0;
+        std::uint32_t height = 0;
+        std::vector<float> pixels;
+    };
+
+    inline Rgba8Image DecodePng(std::span<const std::byte> data, const std::string &source)
+    {
+        png_image image = {};
+        image.version = PNG_IMAGE_VERSION;
+        if (!png_image_begin_read_from_memory(&image, data.data(), data.size()))
+            utils::Fail("Failed to read PNG " + source + ": " + image.message);
+        if (image.width == 0 || image.height == 0 || image.width > MaxSourceDimension || image.height > MaxSourceDimension)
+        {
+            png_image_free(&image);
+            utils::Fail("Unsupported PNG dimensions: " + source);
+        }
+        image.format = PNG_FORMAT_RGBA;
+        Rgba8Image result;
+        result.width = image.width;
+        result.height = image.height;
+        result.pixels.resize(PNG_IMAGE_SIZE(image));
+        if (!png_image_finish_read(&image, nullptr, result.pixels.data(), 0, nullptr))
+            utils::Fail("Failed to decode PNG " + source + ": " + image.message);
+        return result;
+    }
+
+    inline std::vector<std::byte> EncodePng(const Rgba8Image &input)
+    {
+        png_image image = {};
+        image.version = PNG_IMAGE_VERSION;
+        image.width = input.width;
+        image.height = input.height;
+        image.format = PNG_FORMAT_RGBA;
+        png_alloc_size_t size = 0;
+        if (!png_image_write_to_memory(&image, nullptr, &size, 0, input.pixels.data(), 0, nullptr))
+            utils::Fail(std::string("Failed to encode PNG: ") + image.message);
+        std::vector<std::byte> encoded(size);
+        if (!png_image_write_to_memory(&image, encoded.data(), &size, 0, input.pixels.data(), 0, nullptr))
+            utils::Fail(std::string("Failed to encode PNG: ") + image.message);
+        encoded.resize(size);
+        return encoded;
+    }
+
+    // Centered square crop of the source converted to premultiplied floats, the same framing as fit: 'cover'.
+    inline FloatImage PremultipliedSquare(const Rgba8Image &input)
+    {
+        auto side = std::min(input.width, input.height);
+        auto left = (input.width - side) / 2;
+        auto top = (input.height - side) / 2;
+        FloatImage result;
+        result.width = result.height = side;
+        result.pixels.resize(static_cast<size_t>(side) * side * 4);
+        for (std::uint32_t y = 0; y < side; ++y)
+        {
+            auto src = input.pixels.data() + ((static_cast<size_t>(top) + y) * input.width + left) * 4;
+            auto dst = result.pixels.data() + static_cast<size_t>(y) * side * 4;
+            for (std::uint32_t x = 0; x < side; ++x, src += 4, dst += 4)
+            {
+                float alpha = src[3] / 255.0f;
+                dst[0] = src[0] / 255.0f * alpha;
+                dst[1] = src[1] / 255.0f * alpha;
+                dst[2] = src[2] / 255.0f * alpha;
+                dst[3] = alpha;
+            }
+        }
+        return result;
+    }
+
+    // Lanczos-3 contributions of the source samples to every destination sample along one axis.
+    struct Contributions
+    {
+        std::vector<std::uint32_t> first;
+        std::vector<std::uint32_t> count;
+        std::vector<float> weights; // `stride` weights per destination sample
+        std::uint32_t stride = 0;
+
+        Contributions(std::uint32_t source, std::uint32_t target)
+        {
+            constexpr double lobes = 3.0;
+            double scale = static_cast<double>(source) / target;
+            double filterScale = std::max(scale, 1.0);
+            double support = lobes * filterScale;
+            stride = static_cast<std::uint32_t>(std::ceil(support) * 2 + 2);
+            first.resize(target);
+            count.resize(target);
+            weights.assign(static_cast<size_t>(target) * stride, 0.0f);
+
+            auto lanczos = [&](double x)
+            {
+                x = std::abs(x);
+                if (x < 1e-8)
+                    return 1.0;
+                if (x >= lobes)
+                    return 0.0;
+                double px = std::numbers::pi * x;
+                return lobes * std::sin(px) * std::sin(px / lobes) / (px * px);
+            };
+
+            for (std::uint32_t i = 0; i < target; ++i)
+            {
+                double center = (i + 0.5) * scale;
+                auto begin = static_cast<std::int64_t>(std::floor(center - support));
+                auto end = static_cast<std::int64_t>(std::ceil(center + support));
+                begin = std::max<std::int64_t>(begin, 0);
+                end = std::min<std::int64_t>(end, source);
+                end = std::min<std::int64_t>(end, begin + stride);
+
+                double total = 0;
+                std::vector<double> raw(static_cast<size_t>(end - begin));
+                for (auto j = begin; j < end; ++j)
+                    total += raw[j - begin] = lanczos((j + 0.5 - center) / filterScale);
+                first[i] = static_cast<std::uint32_t>(begin);
+                count[i] = static_cast<std::uint32_t>(end - begin);
+                for (size_t k = 0; k < raw.size(); ++k)
+                    weights[static_cast<size_t>(i) * stride + k] = static_cast<float>(total != 0 ? raw[k] / total : 0);
+            }
+        }
+    };
+
+    // out[0..3] = sum over k of weights[k] * in[k * step .. k * step + 3]
+    inline void WeightedSum4(const float *in, size_t step, const float *weights, std::uint32_t count, float *out)
+    {
+#if defined(EZI_ICON_SSE2)
+        __m128 acc = _mm_setzero_ps();
+        for (std::uint32_t k = 0; k < count; ++k, in += step)
+            acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(in), _mm_set1_ps(weights[k])));
+        _mm_storeu_ps(out, acc);
+#elif defined(EZI_ICON_NEON)
+        float32x4_t acc = vdupq_n_f32(0.0f);
+        for (std::uint32_t k = 0; k < count; ++k, in += step)
+            acc = vmlaq_n_f32(acc, vld1q_f32(in), weights[k]);
+        vst1q_f32(out, acc);
+#else
+        float acc[4] = {};
+        for (std::uint32_t k = 0; k < count; ++k, in += step)
+            for (int c = 0; c < 4; ++c)
+                acc[c] += in[c] * weights[k];
+        std::memcpy(out, acc, sizeof(acc));
+#endif
+    }
+
+    // Separable resample: horizontal pass into a (target x source) buffer, then a vertical pass.
+    inline FloatImage Resize(const FloatImage &input, std::uint32_t size)
+    {
+        Contributions horizontal(input.width, size);
+        Contributions vertical(input.height, size);
+
+        FloatImage rows;
+        rows.width = size;
+        rows.height = input.height;
+        rows.pixels.resize(static_cast<size_t>(size) * input.height * 4);
+        for (std::uint32_t y = 0; y < input.height; ++y)
+        {
+            auto src = input.pixels.data() + static_cast<size_t>(y) * input.width * 4;
+            auto dst = rows.pixels.data() + static_cast<size_t>(y) * size * 4;
+            for (std::uint32_t x = 0; x < size; ++x)
+                WeightedSum4(src + static_cast<size_t>(horizontal.first[x]) * 4, 4, &horizontal.weights[static_cast<size_t>(x) * horizontal.stride],
+                             horizontal.count[x], dst + static_cast<size_t>(x) * 4);
+        }
+
+        FloatImage result;
+        result.width = result.height = size;
+        result.pixels.resize(static_cast<size_t>(size) * size * 4);
+        size_t rowStride = static_cast<size_t>(size) * 4;
+        for (std::uint32_t y = 0; y < size; ++y)
+        {
+            auto src = rows.pixels.data() + static_cast<size_t>(vertical.first[y]) * rowStride;
+            auto weights = &vertical.weights[static_cast<size_t>(y) * vertical.stride];
+            auto dst = result.pixels.data() + static_cast<size_t>(y) * rowStride;
+            for (std::uint32_t x = 0; x < size; ++x)
+                WeightedSum4(src + static_cast<size_t>(x) * 4, rowStride, weights, vertical.count[y], dst + static_cast<size_t>(x) * 4);
+        }
+        return result;
+    }
+
+    inline Rgba8Image ToRgba8(const FloatImage &input)
+    {
+        Rgba8Image result;
+        result.width = input.width;
+        result.height = input.height;
+        result.pixels.resize(static_cast<size_t>(input.width) * input.height * 4);
+        auto quantize = [](float value)
+        { return static_cast<std::uint8_t>(std::clamp(value * 255.0f + 0.5f, 0.0f, 255.0f)); };
+        for (size_t i = 0; i < result.pixels.size(); i += 4)
+        {
+            // Lanczos overshoots; clamp alpha first so colors are never divided by a negative or tiny weight
+            float alpha = std::clamp(input.pixels[i + 3], 0.0f, 1.0f);
+            float inverse = alpha > 1.0f / 512 ? 1.0f / alpha : 0.0f;
+            result.pixels[i + 0] = quantize(input.pixels[i + 0] * inverse);
+            result.pixels[i + 1] = quantize(input.pixels[i + 1] * inverse);
+            result.pixels[i + 2] = quantize(input.pixels[i + 2] * inverse);
+            result.pixels[i + 3] = inverse == 0.0f ? 0 : quantize(alpha);
+        }
+        return result;
+    }
+
+    // 32bpp BITMAPINFOHEADER + bottom-up BGRA + AND mask, the classic icon image layout.
+    inline std::vector<std::byte> EncodeDib(const Rgba8Image &image)
+    {
+        std::uint32_t maskStride = (image.width + 31) / 32 * 4;
+        std::uint32_t colorBytes = image.width * image.height * 4;
+        std::uint32_t maskBytes = maskStride * image.height;
+        std::vector<std::byte> out(40 + colorBytes + maskBytes);
+        auto put32 = [&](size_t at, std::uint32_t value)
+        { std::memcpy(out.data() + at, &value, 4); };
+        auto put16 = [&](size_t at, std::uint16_t value)
+        { std::memcpy(out.data() + at, &value, 2); };
+        put32(0, 40);
+        put32(4, image.width);
+        put32(8, image.height * 2); // color rows + mask rows
+        put16(12, 1);
+        put16(14, 32);
+        put32(20, colorBytes + maskBytes);
+
+        auto color = out.data() + 40;
+        auto mask = color + colorBytes;
+        for (std::uint32_t row = 0; row < image.height; ++row)
+        {
+            auto src = image.pixels.data() + static_cast<size_t>(image.height - 1 - row) * image.width * 4;
+            for (std::uint32_t x = 0; x < image.width; ++x, src += 4)
+            {
+                auto dst = color + (static_cast<size_t>(row) * image.width + x) * 4;
+                dst[0] = std::byte{src[2]};
+                dst[1] = std::byte{src[1]};
+                dst[2] = std::byte{src[0]};
+                dst[3] = std::byte{src[3]};
+                if (src[3] == 0)
+                    mask[row * maskStride + x / 8] |= std::byte{static_cast<std::uint8_t>(0x80 >> (x % 8))};
+            }
+        }
+        return out;
+    }
+
+    struct IconSetStats
+    {
+        std::uint32_t sourceWidth = 0;
+        std::uint32_t sourceHeight = 0;
+        size_t sizes = 0;
+        double resizeSeconds = 0;
+        std::uint64_t resizedSourcePixels = 0; // source pixels consumed by all resize passes
+    };
+
+    // Builds a multi-resolution .ico from a source PNG.
+    inline std::vector<std::byte> BuildIconSet(std::span<const std::byte> png, const std::string &source, IconSetStats &stats,
+                                               std::span<const std::uint32_t> sizes = StandardSizes)
+    {
+        auto decoded = DecodePng(png, source);
+        stats.sourceWidth = decoded.width;
+        stats.sourceHeight = decoded.height;
+        auto square = PremultipliedSquare(decoded);
+
+        std::vector<std::vector<std::byte>> images;
+        for (auto size : sizes)
+        {
+            auto start = std::chrono::steady_clock::now();
+            auto resized = ToRgba8(Resize(square, size));
+            stats.resizeSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            stats.resizedSourcePixels += static_cast<std::uint64_t>(square.width) * square.height;
+            images.push_back(size >= PngEntryMinSize ? EncodePng(resized) : EncodeDib(resized));
+        }
+        stats.sizes = sizes.size();
+
+        // ICONDIR, ICONDIRENTRY x n, image data
+        std::vector<std::byte> ico(6 + 16 * images.size());
+        auto put16 = [&](size_t at, std::uint16_t value)
+        { std::memcpy(ico.data() + at, &value, 2); };
+        auto put32 = [&](size_t at, std::uint32_t value)
+        { std::memcpy(ico.data() + at, &value, 4); };
+        put16(2, 1);
+        put16(4, static_cast<std::uint16_t>(images.size()));
+        for (size_t i = 0; i < images.size(); ++i)
+        {
+            size_t entry = 6 + 16 * i;
+            auto dimension = static_cast<std::uint8_t>(sizes[i] >= 256 ? 0 : sizes[i]);
+            ico[entry + 0] = std::byte{dimension};
+            ico[entry + 1] = std::byte{dimension};
+            put16(entry + 4, 1);
+            put16(entry + 6, 32);
+            put32(entry + 8, static_cast<std::uint32_t>(images[i].size()));
+            put32(entry + 12, static_cast<std::uint32_t>(ico.size()));
+            ico.insert(ico.end(), images[i].begin(), images[i].end());
+        }
+        return ico;
+    }
+}
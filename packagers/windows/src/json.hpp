@@ -0,0 +1,324 @@
+#pragma once
+
+#include "utils.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+namespace ezi::builder::packager::json
+{
+    // Same escaping as JSON.stringify, so manifests match the ones produced by builder.ts.
+    inline void AppendString(std::string &out, std::string_view text)
+    {
+        static const char hex[] = "0123456789abcdef";
+        out.push_back('"');
+        for (char c : text)
+        {
+            auto u = static_cast<unsigned char>(c);
+            switch (c)
+            {
+            case '"':
+                out += "\\\"";
+                break;
+            case '\\':
+                out += "\\\\";
+                break;
+            case '\b':
+                out += "\\b";
+                break;
+            case '\f':
+                out += "\\f";
+                break;
+            case '\n':
+                out += "\\n";
+                break;
+            case '\r':
+                out += "\\r";
+                break;
+            case '\t':
+                out += "\\t";
+                break;
+            default:
+                if (u < 0x20)
+                {
+                    out += "\\u00";
+                    out.push_back(hex[u >> 4]);
+                    out.push_back(hex[u & 0xF]);
+                }
+                else
+                {
+                    out.push_back(c);
+                }
+            }
+        }
+        out.push_back('"');
+    }
+
+    // Minimal DOM for the small JSON documents the packager reads (job files). Strings are UTF-8.
+    class Value
+    {
+    public:
+        using Array = std::vector<Value>;
+        using Object = std::map<std::string, Value, std::less<>>;
+
+    private:
+        std::variant<std::nullptr_t, bool, double, std::string, Array, Object> data;
+
+    public:
+        Value() : data(nullptr) {}
+        Value(bool value) : data(value) {}
+        Value(double value) : data(value) {}
+        Value(std::string value) : data(std::move(value)) {}
+        Value(Array value) : data(std::move(value)) {}
+        Value(Object value) : data(std::move(value)) {}
+
+        bool isNull() const { return std::holds_alternative<std::nullptr_t>(data); }
+        bool isString() const { return std::holds_alternative<std::string>(data); }
+        bool isNumber() const { return std::holds_alternative<double>(data); }
+        bool isArray() const { return std::holds_alternative<Array>(data); }
+        bool isObject() const { return std::holds_alternative<Object>(data); }
+
+        const std::string *string() const { return std::get_if<std::string>(&data); }
+        const double *number() const { return std::get_if<double>(&data); }
+        const bool *boolean() const { return std::get_if<bool>(&data); }
+        const Array *array() const { return std::get_if<Array>(&data); }
+        const Object *object() const { return std::get_if<Object>(&data); }
+
+        // Member lookup on objects; nullptr when this is not an object or the key is absent.
+        const Value *find(std::string_view key) const
+        {
+            auto members = object();
+            if (!members)
+                return nullptr;
+            auto it = members->find(key);
+            return it == members->end() ? nullptr : &it->second;
+        }
+
+        std::string stringOr(std::string_view key, std::string fallback = {}) const
+        {
+            auto value = find(key);
+            return value && value->string() ? *value->string() : fallback;
+        }
+    };
+
+    class Parser
+    {
+    private:
+        std::string_view text;
+        size_t at = 0;
+        std::string source;
+
+        [[noreturn]] void fail(const std::string &message)
+        {
+            utils::Fail("Invalid JSON in " + source + " at offset " + std::to_string(at) + ": " + message);
+        }
+
+        void skipWhitespace()
+        {
+            while (at < text.size() && (text[at] == ' ' || text[at] == '\t' || text[at] == '\n' || text[at] == '\r'))
+                ++at;
+        }
+
+        bool consume(std::string_view token)
+        {
+            if (text.substr(at, token.size()) != token)
+                return false;
+            at += token.size();
+            return true;
+        }
+
+        void expect(char c)
+        {
+            skipWhitespace();
+            if (at >= text.size() || text[at] != c)
+                fail(std::string("expected '") + c + "'");
+            ++at;
+        }
+
+        static void appendUtf8(std::string &out, std::uint32_t codePoint)
+        {
+            if (codePoint < 0x80)
+            {
+                out.push_back(static_cast<char>(codePoint));
+            }
+            else if (codePoint < 0x800)
+            {
+                out.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+                out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+            }
+            else if (codePoint < 0x10000)
+            {
+                out.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+                out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+            }
+            else
+            {
+                out.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+                out.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+                out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+            }
+        }
+
+        std::uint32_t parseHex4()
+        {
+            if (at + 4 > text.size())
+                fail("truncated \\u escape");
+            std::uint32_t value = 0;
+            for (int i = 0; i < 4; ++i)
+            {
+                char c = text[at++];
+                value <<= 4;
+                if (c >= '0' && c <= '9')
+                    value |= c - '0';
+                else if (c >= 'a' && c <= 'f')
+                    value |= c - 'a' + 10;
+                else if (c >= 'A' && c <= 'F')
+                    value |= c - 'A' + 10;
+                else
+                    fail("bad \\u escape");
+            }
+            return value;
+        }
+
+        std::string parseString()
+        {
+            expect('"');
+            std::string out;
+            while (true)
+            {
+                if (at >= text.size())
+                    fail("unterminated string");
+                char c = text[at++];
+                if (c == '"')
+                    return out;
+                if (c != '\\')
+                {
+                    out.push_back(c);
+                    continue;
+                }
+                if (at >= text.size())
+                    fail("unterminated escape");
+                switch (text[at++])
+                {
+                case '"':
+                    out.push_back('"');
+                    break;
+                case '\\':
+                    out.push_back('\\');
+                    break;
+                case '/':
+                    out.push_back('/');
+                    break;
+                case 'b':
+                    out.push_back('\b');
+                    break;
+                case 'f':
+                    out.push_back('\f');
+                    break;
+                case 'n':
+                    out.push_back('\n');
+                    break;
+                case 'r':
+                    out.push_back('\r');
+                    break;
+                case 't':
+                    out.push_back('\t');
+                    break;
+                case 'u':
+                {
+                    auto codePoint = parseHex4();
+                    if (codePoint >= 0xD800 && codePoint < 0xDC00 && consume("\\u"))
+                    {
+                        auto low = parseHex4();
+                        codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+                    }
+                    appendUtf8(out, codePoint);
+                    break;
+                }
+                default:
+                    fail("unknown escape");
+                }
+            }
+        }
+
+        Value parseValue(int depth)
+        {
+            if (depth > 64)
+                fail("nesting too deep");
+            skipWhitespace();
+            if (at >= text.size())
+                fail("unexpected end of input");
+            char c = text[at];
+            if (c == '{')
+            {
+                ++at;
+                Value::Object members;
+                skipWhitespace();
+                if (consume("}"))
+                    return members;
+                do
+                {
+                    skipWhitespace();
+                    auto key = parseString();
+                    expect(':');
+                    members.insert_or_assign(std::move(key), parseValue(depth + 1));
+                    skipWhitespace();
+                } while (consume(","));
+                expect('}');
+                return members;
+            }
+            if (c == '[')
+            {
+                ++at;
+                Value::Array items;
+                skipWhitespace();
+                if (consume("]"))
+                    return items;
+                do
+                {
+                    items.push_back(parseValue(depth + 1));
+                    skipWhitespace();
+                } while (consume(","));
+                expect(']');
+                return items;
+            }
+            if (c == '"')
+                return parseString();
+            if (consume("true"))
+                return true;
+            if (consume("false"))
+                return false;
+            if (consume("null"))
+                return Value();
+
+            std::string number;
+            while (at < text.size() && std::string_view("+-0123456789.eE").find(text[at]) != std::string_view::npos)
+                number.push_back(text[at++]);
+            char *end = nullptr;
+            double value = std::strtod(number.c_str(), &end);
+            if (number.empty() || end != number.c_str() + number.size())
+                fail("unexpected character");
+            return value;
+        }
+
+    public:
+        Parser(std::string_view text, std::string source) : text(text), source(std::move(source)) {}
+
+        Value parse()
+        {
+            if (text.substr(0, 3) == "\xEF\xBB\xBF")
+                at = 3;
+            auto value = parseValue(0);
+            skipWhitespace();
+            if (at != text.size())
+                fail("trailing characters");
+            return value;
+        }
+    };
+}
@@ -0,0 +1,255 @@
+#pragma once
+
+#include "utils.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <memory>
+#include <span>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ezi::builder::packager
+{
+    // Read-only view of a whole file. Pages are faulted in on demand by the OS, nothing is copied to the heap.
+    // The file handle is closed as soon as the view exists, so mapping many assets holds no descriptors.
+    // Streams that cannot be mapped (stdin, pipes) are spooled to a temporary file first.
+    class MappedFile
+    {
+    private:
+        const std::byte *data = nullptr;
+        size_t size = 0;
+        std::filesystem::path source;
+        std::vector<std::byte> buffer;
+#ifdef __linux__
+        struct stat identity = {}; // of the mapped file, to recognise it when reopened for range copies
+#endif
+
+        MappedFile() = default;
+
+#ifdef _WIN32
+        using Handle = HANDLE;
+
+        // Closes `file` without losing the error code Fail reports.
+        [[noreturn]] static void Fail(HANDLE file, const std::string &message)
+        {
+            auto error = GetLastError();
+            CloseHandle(file);
+            SetLastError(error);
+            utils::Fail(message);
+        }
+#else
+        using Handle = int;
+
+        // Closes `file` without losing the errno Fail reports.
+        [[noreturn]] static void Fail(int file, const std::string &message)
+        {
+            auto error = errno;
+            close(file);
+            errno = error;
+            utils::Fail(message);
+        }
+#endif
+
+        // Maps the whole of an open file and closes it.
+        void map(Handle file)
+        {
+#ifdef _WIN32
+            LARGE_INTEGER fileSize;
+            if (!GetFileSizeEx(file, &fileSize))
+                Fail(file, "Failed to query file size: " + utils::PathText(source));
+            size = static_cast<size_t>(fileSize.QuadPart);
+            if (size != 0)
+            {
+                HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+                if (!mapping)
+                    Fail(file, "Failed to map file: " + utils::PathText(source));
+                data = static_cast<const std::byte *>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+                CloseHandle(mapping);
+            }
+            CloseHandle(file);
+#else
+            struct stat st;
+            if (fstat(file, &st) != 0)
+                Fail(file, "Failed to query file size: " + utils::PathText(source));
+            size = static_cast<size_t>(st.st_size);
+            if (size != 0)
+            {
+                void *view = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file, 0);
+                data = view == MAP_FAILED ? nullptr : static_cast<const std::byte *>(view);
+                if (data)
+                    madvise(view, size, MADV_SEQUENTIAL);
+            }
+#ifdef __linux__
+            identity = st;
+#endif
+            close(file);
+#endif
+            if (size != 0 && !data)
+                utils::Fail("Failed to map file: " + utils::PathText(source));
+        }
+
+    public:
+        explicit MappedFile(const std::filesystem::path &path) : source(path)
+        {
+#ifdef _WIN32
+            HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+            if (file == INVALID_HANDLE_VALUE)
+#else
+            int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            if (file < 0)
+#endif
+                utils::Fail("Failed to open file: " + utils::PathText(path));
+            map(file);
+        }
+
+        ~MappedFile()
+        {
+            if (!mapped())
+                return;
+#ifdef _WIN32
+            if (data)
+                UnmapViewOfFile(data);
+#else
+            if (data)
+                munmap(const_cast<std::byte *>(data), size);
+#endif
+        }
+
+        MappedFile(const MappedFile &) = delete;
+        MappedFile &operator=(const MappedFile &) = delete;
+
+        static std::shared_ptr<MappedFile> Open(const std::filesystem::path &path)
+        {
+            return std::make_shared<MappedFile>(path);
+        }
+
+        // Spools a stream, e.g. stdin for inputs given as `-`, into a temporary file that is deleted once unmapped,
+        // then maps it like any other input: a large payload is written out once instead of growing on the heap.
+        static std::shared_ptr<MappedFile> Read(std::FILE *stream)
+        {
+#ifdef _WIN32
+            _setmode(_fileno(stream), _O_BINARY);
+#endif
+            std::shared_ptr<MappedFile> file(new MappedFile());
+            auto directory = std::filesystem::temp_directory_path();
+#ifdef _WIN32
+            wchar_t name[MAX_PATH];
+            if (!GetTempFileNameW(directory.c_str(), L"ezi", 0, name))
+                utils::Fail("Failed to create a temporary file in " + utils::PathText(directory));
+            file->source = name;
+            HANDLE spool = CreateFileW(name, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, CREATE_ALWAYS,
+                                       FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+            if (spool == INVALID_HANDLE_VALUE)
+            {
+                auto error = GetLastError();
+                DeleteFileW(name);
+                SetLastError(error);
+                utils::Fail("Failed to create a temporary file: " + utils::PathText(file->source));
+            }
+#else
+            auto name = (directory / "ezi-stdin-XXXXXX").string();
+            int spool = mkstemp(name.data());
+            if (spool < 0)
+                utils::Fail("Failed to create a temporary file in " + utils::PathText(directory));
+            unlink(name.c_str()); // the mapping keeps the data
+            file->source = name;
+#endif
+            std::vector<std::byte> chunk(1 << 20);
+            for (;;)
+            {
+                auto read = std::fread(chunk.data(), 1, chunk.size(), stream);
+                for (size_t done = 0; done < read;)
+                {
+#ifdef _WIN32
+                    DWORD written = 0;
+                    if (!WriteFile(spool, chunk.data() + done, static_cast<DWORD>(read - done), &written, nullptr) || written == 0)
+#else
+                    auto written = ::write(spool, chunk.data() + done, read - done);
+                    if (written < 0 && errno == EINTR)
+                        continue;
+                    if (written <= 0)
+#endif
+                        Fail(spool, "Failed to write a temporary file: " + utils::PathText(file->source));
+                    done += written;
+                }
+                if (read < chunk.size())
+                    break;
+            }
+            if (std::ferror(stream))
+                Fail(spool, "Failed to read from standard input.");
+            file->map(spool);
+            return file;
+        }
+
+        // Takes over bytes already read into memory, e.g. by the batched asset reader.
+        static std::shared_ptr<MappedFile> FromBuffer(std::vector<std::byte> bytes)
+        {
+            std::shared_ptr<MappedFile> file(new MappedFile());
+            file->buffer = std::move(bytes);
+            file->data = file->buffer.data();
+            file->size = file->buffer.size();
+            return file;
+        }
+
+        // Opens a path, or reads standard input for `-`.
+        static std::shared_ptr<MappedFile> OpenOrRead(const std::string &path)
+        {
+            return path == "-" ? Read(stdin) : Open(path);
+        }
+
+        std::span<const std::byte> bytes() const { return {data, size}; }
+
+        // Backed by the file at path() rather than heap memory. Only mapped pages may be evicted, and only
+        // mapped ranges can be copied from their file by the kernel.
+        bool mapped() const { return !source.empty(); }
+        const std::filesystem::path &path() const { return source; }
+#ifdef __linux__
+        // Opens path() again for a range copy; -1 when it no longer is the file that was mapped (replaced,
+        // modified since) or cannot be opened. The caller closes the descriptor.
+        int reopen() const
+        {
+            if (!mapped() || !data)
+                return -1;
+            int fd = open(source.c_str(), O_RDONLY | O_CLOEXEC);
+            if (fd < 0)
+                return -1;
+            struct stat st;
+            if (fstat(fd, &st) != 0 || st.st_dev != identity.st_dev || st.st_ino != identity.st_ino || st.st_size != identity.st_size ||
+                st.st_mtim.tv_sec != identity.st_mtim.tv_sec || st.st_mtim.tv_nsec != identity.st_mtim.tv_nsec)
+            {
+                close(fd);
+                return -1;
+            }
+            return fd;
+        }
+#endif
+
+        // Drops already consumed pages of a mapped range from the working set so that streaming a large
+        // file through the mapping does not grow the resident set. The data stays valid and is re-read on access.
+        static void Evict(std::span<const std::byte> range)
+        {
+            constexpr std::uintptr_t pageSize = 4096;
+            auto begin = utils::AlignUp(reinterpret_cast<std::uintptr_t>(range.data()), pageSize);
+            auto end = reinterpret_cast<std::uintptr_t>(range.data() + range.size()) / pageSize * pageSize;
+            if (end <= begin)
+                return;
+#ifdef _WIN32
+            VirtualUnlock(reinterpret_cast<void *>(begin), end - begin);
+#else
+            madvise(reinterpret_cast<void *>(begin), end - begin, MADV_DONTNEED);
+#endif
+        }
+    };
+}
@@ -0,0 +1,206 @@
+#pragma once
+
+#include "utils.hpp"
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <span>
+#include <string>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace ezi::builder::packager
+{
+    // Sequential writer for packaged outputs. Ranges taken unchanged from a mapped input file are handed to
+    // copy_file_range where the OS has it: on reflink filesystems (btrfs, XFS) page-aligned ranges then share
+    // extents with the input, elsewhere the kernel copies them without passing the data through user space.
+    // The input is reopened for this and only used while it still is the file that was mapped. Other
+    // platforms, changed inputs and filesystems that refuse the call fall back to writing from the mapping.
+    class OutputFile
+    {
+    private:
+#ifdef _WIN32
+        HANDLE handle = INVALID_HANDLE_VALUE;
+#else
+        int fd = -1;
+        bool rangeCopy = true;
+        const MappedFile *copySource = nullptr; // the input `copyFd` was reopened from, kept for consecutive ranges
+        int copyFd = -1;
+#endif
+        std::uint64_t written = 0;
+        std::uint64_t copied = 0;
+
+        void writeAll(const std::byte *bytes, size_t length)
+        {
+            while (length)
+            {
+#ifdef _WIN32
+                DWORD done = 0;
+                if (!WriteFile(handle, bytes, static_cast<DWORD>(std::min<size_t>(length, 1u << 30)), &done, nullptr) || done == 0)
+                    utils::Fail("Failed to write output file.");
+#else
+                auto done = ::write(fd, bytes, length);
+                if (done < 0 && errno == EINTR)
+                    continue;
+                if (done <= 0)
+                    utils::Fail("Failed to write output file.");
+#endif
+                bytes += done;
+                length -= done;
+                written += done;
+            }
+        }
+
+    public:
+        // Creates or truncates `path`; with `append` an existing file is kept and written at its end.
+        explicit OutputFile(const std::filesystem::path &path, bool append = false)
+        {
+#ifdef _WIN32
+            handle = CreateFileW(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ, nullptr, append ? OPEN_EXISTING : CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (handle == INVALID_HANDLE_VALUE)
+                utils::Fail("Failed to create output file.");
+            LARGE_INTEGER end;
+            if (append && SetFilePointerEx(handle, LARGE_INTEGER{}, &end, FILE_END))
+                written = end.QuadPart;
+#else
+            fd = open(path.c_str(), O_WRONLY | O_CLOEXEC | (append ? 0 : O_CREAT | O_TRUNC), 0666);
+            if (fd < 0)
+                utils::Fail("Failed to create output file.");
+            if (append)
+            {
+                auto end = lseek(fd, 0, SEEK_END);
+                written = end < 0 ? 0 : end;
+            }
+#endif
+        }
+
+        ~OutputFile()
+        {
+#ifdef _WIN32
+            if (handle != INVALID_HANDLE_VALUE)
+                CloseHandle(handle);
+#else
+            if (fd >= 0)
+                ::close(fd);
+            if (copyFd >= 0)
+                ::close(copyFd);
+#endif
+        }
+
+        OutputFile(const OutputFile &) = delete;
+        OutputFile &operator=(const OutputFile &) = delete;
+
+        std::uint64_t position() const { return written; }
+        // Bytes placed by the kernel instead of being written from memory.
+        std::uint64_t copiedBytes() const { return copied; }
+
+        // Mapped inputs are written in slices and dropped from the working set behind the writer.
+        void write(std::span<const std::byte> bytes, bool evict = false)
+        {
+            constexpr size_t slice = 16 << 20;
+            for (size_t at = 0; at < bytes.size(); at += slice)
+            {
+                auto part = bytes.subspan(at, std::min(slice, bytes.size() - at));
+                writeAll(part.data(), part.size());
+                if (evict)
+                    MappedFile::Evict(part);
+            }
+        }
+
+        // `bytes` must lie within `source`, which outlives the writer.
+        void copy(const MappedFile &source, std::span<const std::byte> bytes)
+        {
+#ifdef __linux__
+            if (rangeCopy && source.mapped() && !bytes.empty() && copySource != &source)
+            {
+                if (copyFd >= 0)
+                    ::close(copyFd);
+                copySource = &source;
+                copyFd = source.reopen();
+            }
+            if (rangeCopy && copySource == &source && copyFd >= 0 && !bytes.empty())
+            {
+                loff_t offset = bytes.data() - source.bytes().data();
+                size_t done = 0;
+                while (done < bytes.size())
+                {
+                    auto n = copy_file_range(copyFd, &offset, fd, nullptr, bytes.size() - done, 0);
+                    if (n < 0 && errno == EINTR)
+                        continue;
+                    if (n <= 0)
+                    {
+                        // cross-device copies before Linux 5.3, or a filesystem without support
+                        if (n < 0 && done == 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP))
+                            rangeCopy = false;
+                        break;
+                    }
+                    done += n;
+                }
+                written += done;
+                copied += done;
+                bytes = bytes.subspan(done);
+            }
+#endif
+            write(bytes, source.mapped());
+        }
+
+        // Overwrites bytes already written, e.g. a header field only known at the end. Call it last: on
+        // Windows the write moves the file pointer.
+        void writeAt(std::uint64_t offset, std::span<const std::byte> bytes)
+        {
+#ifdef _WIN32
+            OVERLAPPED at = {};
+            at.Offset = static_cast<DWORD>(offset);
+            at.OffsetHigh = static_cast<DWORD>(offset >> 32);
+            DWORD done = 0;
+            if (!WriteFile(handle, bytes.data(), static_cast<DWORD>(bytes.size()), &done, &at) || done != bytes.size())
+                utils::Fail("Failed to write output file.");
+#else
+            if (pwrite(fd, bytes.data(), bytes.size(), static_cast<off_t>(offset)) != static_cast<ssize_t>(bytes.size()))
+                utils::Fail("Failed to write output file.");
+#endif
+        }
+
+        void padTo(std::uint64_t position)
+        {
+            static const std::byte zeros[4096] = {};
+            while (written < position)
+                writeAll(zeros, static_cast<size_t>(std::min<std::uint64_t>(sizeof(zeros), position - written)));
+        }
+
+        // Flushes to stable storage, so a rename over the previous version never exposes a partially written
+        // file after a crash. Best effort: filesystems without flush support are not an error.
+        bool sync()
+        {
+#ifdef _WIN32
+            return FlushFileBuffers(handle) != 0;
+#else
+            return fsync(fd) == 0;
+#endif
+        }
+
+        void close()
+        {
+#ifdef _WIN32
+            bool closed = CloseHandle(handle) != 0;
+            handle = INVALID_HANDLE_VALUE;
+#else
+            bool closed = ::close(fd) == 0;
+            fd = -1;
+            if (copyFd >= 0)
+                ::close(copyFd);
+            copyFd = -1;
+            copySource = nullptr;
+#endif
+            if (!closed)
+                utils::Fail("Failed to write output file.");
+        }
+    };
+}
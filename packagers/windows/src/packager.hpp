@@ -0,0 +1,593 @@
+#pragma once
+
+#include "platform.hpp"
+#include "utils.hpp"
+#include "pe_image.hpp"
+#include "mapped_file.hpp"
+#include "asset_format.hpp"
+#include "hash.hpp"
+#include "asset_bundle.hpp"
+#include "json.hpp"
+#include "thread_pool.hpp"
+#include "icon_builder.hpp"
+#include "version_info.hpp"
+#include "resource_updater.hpp"
+#include "trace.hpp"
+#include "argument_parser.hpp"
+#include "delta.hpp"
+#include "access_profile.hpp"
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <sstream>
+#include <cstring>
+#include <iomanip>
+#include <filesystem>
+#include <optional>
+#include <chrono>
+#include <atomic>
+#include <tuple>
+#include <unordered_map>
+#include <cstdlib>
+
+// Windows 打包流程，命令行 main.cpp 与 C API 库 packager_api.cpp 共用
+namespace ezi::builder::packager
+{
+    // 命令行选项
+    inline const std::vector<Option> PackagerOptions{
+        {"--help", "", "Show this help message"},
+        {"--version", "", "Show version information"},
+        {"--input", "<path>", "Specify the input executable path, updated in place unless --output is given"},
+        {"--output", "<path>", "Write the packaged executable here, leaving --input untouched"},
+        {"--jobs", "<file.json>", "Write several output executables sharing one asset payload, in parallel"},
+        {"--icon", "<path>", "Specify the path to the icon file (.ico)"},
+        {"--icon-png", "<path>", "Generate a multi-size icon (16-256px) from a PNG instead of --icon"},
+        {"--icon-out", "<path>", "Also write the icon generated by --icon-png to a file"},
+        {"--ezi-asset", "<path>", "Specify the path to the eziapp's asset file, or - to read it from stdin"},
+        {"--ezi-asset-dir", "<path>", "Build the eziapp's asset bundle from a directory instead of --ezi-asset"},
+        {"--ezi-config", "<path>", "Specify the path to the eziapp's config json, used with --ezi-asset-dir"},
+        {"--ezi-package", "<name>", "Specify the package name used in asset ids, used with --ezi-asset-dir"},
+        {"--ezi-asset-out", "<path>", "Also write the built asset bundle to a file"},
+        {"--threads", "<count>", "Number of compression threads (default: all cores)"},
+        {"--io-depth", "<count>", "Asset reads kept in flight while scanning the asset directory (default: 64)"},
+        {"--io-backend", "<auto|threads>", "Read assets with io_uring where available (default: auto) or with blocking reads on threads"},
+        {"--cache-dir", "<path>", "Reuse compressed frames across builds from this directory"},
+        {"--asset-index", "<json|binary>", "Write the asset manifest as JSON (default) or as a binary hashed index"},
+        {"--store-raw", "<auto|never>", "Store already compressed or high-entropy assets without zstd, page-aligned; the runtime must support raw entries (default: never)"},
+        {"--chunk-threshold", "<KB>", "Split assets larger than this into seekable zstd chunks; the runtime must read seek tables (default: 0, never)"},
+        {"--chunk-size", "<KB>", "Uncompressed size of each seekable chunk (default: 1024)"},
+        {"--access-profile", "<file.json>", "Lay out the assets listed in this recorded startup order first"},
+        {"--access-block", "<KB>", "Compress the first profiled assets up to this size as one shared zstd frame"},
+        {"--access-report", "<exe|bundle>", "Report the pages a cold start reads for --access-profile, without packaging"},
+        {"--zstd-dict", "<path>", "Compress small assets with this zstd dictionary, stored once in the bundle"},
+        {"--train-dict", "true", "Train a zstd dictionary over the bundle's small assets"},
+        {"--dict-report", "true", "Report compression ratio and decompression speed with and without the dictionary"},
+        {"--asset-mode", "<resource|overlay>", "Embed the asset as a resource (default) or append it as an overlay"},
+        {"--delta-from", "<old.exe>", "Write a binary patch from this earlier build to the output (or to --delta-to)"},
+        {"--delta-to", "<new.exe>", "Target of --delta-out without packaging, or the file written by --delta-apply"},
+        {"--delta-out", "<patch>", "Path of the patch written with --delta-from"},
+        {"--delta-apply", "<patch>", "Rebuild --delta-to from --delta-from and this patch"},
+        {"--delta-memory", "<MB>", "Memory budget for building a patch (default: 1024)"},
+        {"--trace", "<file.json>", "Write a Chrome trace of every packaging phase with durations, bytes and allocations"},
+        {"--trace-summary", "<file.json>", "Write per-phase totals, resource sizes and warnings for the build report"},
+        {"--update-version", "true", "Update version information"},
+        {"--ver-companyName", "<name>", "Set the company name in version info"},
+        {"--ver-fileDescription", "<description>", "Set the file description in version info"},
+        {"--ver-fileVersion", "<version>", "Set the file version in version info"},
+        {"--ver-productName", "<name>", "Set the product name in version info"},
+        {"--ver-productVersion", "<version>", "Set the product version in version info"},
+        {"--ver-fileVersionParts", "<x.x.x.x>", "Set the file version parts in version info"},
+        {"--ver-productVersionParts", "<x.x.x.x>", "Set the product version parts in version info"},
+        {"--ver-languages", "<zh-CN,en-US>", "String table languages in version info (default: en-US)"},
+        {"--ver-string", "<[lang:]Key=Value>", "Set any version info string, may be repeated"},
+    };
+
+    inline void ParseVersionParts(const std::string &versionStr, WORD parts[4])
+    {
+        std::istringstream iss(versionStr);
+        std::string token;
+        int index = 0;
+        while (std::getline(iss, token, '.') && index < 4)
+        {
+            parts[index++] = static_cast<WORD>(std::stoi(token));
+        }
+        while (index < 4)
+        {
+            parts[index++] = 0;
+        }
+    }
+
+    // 由PNG生成多尺寸图标，并输出缩放吞吐量
+    inline std::shared_ptr<std::vector<std::byte>> GenerateIcon(std::span<const std::byte> png, const std::string &source, bool verbose = true)
+    {
+        trace::Scope scope("icon");
+        icon::IconSetStats stats;
+        auto ico = std::make_shared<std::vector<std::byte>>(icon::BuildIconSet(png, source, stats));
+        scope.bytesIn(png.size());
+        scope.bytesOut(ico->size());
+        if (verbose)
+        {
+            double megapixels = stats.resizedSourcePixels / 1e6;
+            std::cout << "Icon generated: " << stats.sourceWidth << "x" << stats.sourceHeight << " -> " << stats.sizes << " size(s), "
+                      << ico->size() / 1024 << "KB, resized in " << static_cast<int>(stats.resizeSeconds * 1000) << "ms ("
+                      << static_cast<int>(stats.resizeSeconds > 0 ? megapixels / stats.resizeSeconds : 0) << " MPix/s)." << std::endl;
+        }
+        return ico;
+    }
+
+    inline std::shared_ptr<std::vector<std::byte>> GenerateIcon(const std::filesystem::path &pngPath, bool verbose = true)
+    {
+        auto file = MappedFile::Open(pngPath);
+        return GenerateIcon(file->bytes(), utils::PathText(pngPath), verbose);
+    }
+
+    // 生成旧版本到新版本的差分补丁，并输出各部分字节数
+    inline void CreateDelta(AgrumentParser &parser, const std::string &oldPath, const std::string &newPath, const std::string &patchPath)
+    {
+        delta::Options options;
+        options.threads = static_cast<size_t>(parser.getNumberValue("--threads").value_or(0));
+        if (auto memory = parser.getNumberValue("--delta-memory"))
+            options.memoryBudget = std::max<std::uint64_t>(*memory, 16) << 20;
+        auto startTime = std::chrono::steady_clock::now();
+        auto stats = delta::Create(oldPath, newPath, patchPath, options);
+        auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+        std::cout << "Delta patch written: " << patchPath << " (" << stats.patchSize / 1024 << "KB for a " << stats.newSize / 1024
+                  << "KB output; copied " << stats.copiedBytes / 1024 << "KB, diffed " << stats.diffedBytes / 1024 << "KB, stored "
+                  << stats.literalBytes / 1024 << "KB) in " << static_cast<int>(elapsed * 1000) << "ms." << std::endl;
+    }
+
+    // 统计按访问记录冷启动需要读取的页数，输入为打包后的程序或 --ezi-asset-out 输出的资源包
+    inline void ReportAccessPages(const std::string &path, const std::vector<std::string> &profile)
+    {
+        auto file = MappedFile::Open(path);
+        auto bundle = delta::FindBundle(file->bytes(), file).value_or(file->bytes());
+        auto entries = delta::ReadBundleEntries(bundle);
+        if (entries.empty())
+            throw utils::PackagerError("No asset bundle found in " + path);
+
+        std::unordered_map<std::string_view, const delta::BundleEntry *> byPath;
+        for (auto &entry : entries)
+            byPath.emplace(AccessProfilePath(entry.id), &entry);
+        // 配置在启动时总会读取
+        std::vector<std::pair<std::uint64_t, std::uint64_t>> ranges;
+        if (auto config = byPath.find("ezi.config.manifest"); config != byPath.end())
+            ranges.emplace_back(config->second->offset, config->second->size);
+        size_t found = 0, missing = 0;
+        for (auto &id : profile)
+        {
+            auto it = byPath.find(AccessProfilePath(id));
+            if (it == byPath.end())
+            {
+                ++missing;
+                continue;
+            }
+            ++found;
+            ranges.emplace_back(it->second->offset, it->second->size);
+        }
+        auto count = CountPages(std::move(ranges));
+        auto bundlePages = (bundle.size() + format::OverlayAlignment - 1) / format::OverlayAlignment;
+        std::cout << "Startup reads " << found << " asset(s): " << count.bytes / 1024 << "KB in " << count.pages << " of "
+                  << bundlePages << " page(s), " << count.runs << " contiguous run(s)." << std::endl;
+        if (missing)
+            trace::Warn(std::to_string(missing) + " access profile id(s) are not in the bundle.");
+        trace::Count("access.assets", found);
+        trace::Count("access.pages", count.pages);
+        trace::Count("access.runs", count.runs);
+    }
+
+    // 解析以逗号分隔的语言列表，如 zh-CN,en-US
+    inline bool ParseVersionLanguages(const std::string &list, std::vector<WORD> &languages)
+    {
+        std::istringstream iss(list);
+        std::string token;
+        while (std::getline(iss, token, ','))
+        {
+            if (token.empty())
+                continue;
+            auto language = version::ParseLanguage(token);
+            if (!language)
+                return false;
+            languages.push_back(*language);
+        }
+        return true;
+    }
+
+    // 解析 [lang:]Key=Value 形式的版本字符串
+    template <typename Convert>
+    inline bool ParseVersionString(const std::string &entry, Convert convert, std::vector<std::tuple<WORD, std::u16string, std::u16string>> &strings)
+    {
+        auto equals = entry.find('=');
+        if (equals == std::string::npos || equals == 0)
+            return false;
+        std::string key = entry.substr(0, equals);
+        WORD language = 0;
+        if (auto colon = key.find(':'); colon != std::string::npos)
+        {
+            auto parsed = version::ParseLanguage(key.substr(0, colon));
+            if (!parsed)
+                return false;
+            language = *parsed;
+            key = key.substr(colon + 1);
+        }
+        if (key.empty())
+            return false;
+        strings.emplace_back(language, convert(key), convert(entry.substr(equals + 1)));
+        return true;
+    }
+
+    struct PackageJob
+    {
+        std::filesystem::path input;
+        std::filesystem::path output;
+        std::filesystem::path icon;
+        bool updateVersion = false;
+        VersionInfo version;
+    };
+
+    // 读取批量任务文件，格式：
+    // {"outputs": [{"output": "a.exe", "input"?: "base.exe", "icon"?: "a.ico 或 a.png",
+    //               "version"?: {"productName": "...", "fileVersionParts": "1.0.0.0", "languages": ["zh-CN", "en-US"],
+    //                            "strings": {"LegalCopyright": "...", "zh-CN:ProductName": "..."}, ...}}]}
+    // 未指定的字段沿用命令行参数，相对路径相对于任务文件所在目录
+    inline std::vector<PackageJob> ReadJobs(const std::string &jobsPath, const std::string &input, const std::string &icon, bool updateVersion, const VersionInfo &version)
+    {
+        auto file = MappedFile::Open(jobsPath);
+        auto text = file->bytes();
+        auto document = json::Parser(std::string_view(reinterpret_cast<const char *>(text.data()), text.size()), jobsPath).parse();
+        auto outputs = document.find("outputs");
+        if (!outputs || !outputs->array() || outputs->array()->empty())
+            utils::Fail("Job file has no \"outputs\": " + jobsPath);
+
+        auto baseDir = std::filesystem::absolute(jobsPath).parent_path();
+        auto resolve = [&](const std::string &utf8)
+        {
+            auto path = utils::Utf8Path(utf8);
+            return path.is_absolute() ? path : baseDir / path;
+        };
+
+        std::vector<PackageJob> jobs;
+        for (auto &entry : *outputs->array())
+        {
+            PackageJob job;
+            auto output = entry.stringOr("output");
+            if (output.empty())
+                utils::Fail("Every job needs an \"output\" path: " + jobsPath);
+            job.output = resolve(output);
+            auto jobInput = entry.stringOr("input");
+            job.input = jobInput.empty() ? std::filesystem::path(input) : resolve(jobInput);
+            if (job.input.empty() || !std::filesystem::exists(job.input))
+                utils::Fail("Input executable file does not exist for " + utils::PathText(job.output));
+            auto jobIcon = entry.stringOr("icon");
+            job.icon = jobIcon.empty() ? std::filesystem::path(icon) : resolve(jobIcon);
+
+            job.updateVersion = updateVersion;
+            job.version = version;
+            if (auto fields = entry.find("version"); fields && fields->object())
+            {
+                job.updateVersion = true;
+                auto text = [&](const char *key, std::u16string &target)
+                {
+                    if (auto value = fields->find(key); value && value->string())
+                        target = utils::Utf8ToUtf16(*value->string());
+                };
+                text("companyName", job.version.companyName);
+                text("fileDescription", job.version.fileDescription);
+                text("fileVersion", job.version.fileVersion);
+                text("productName", job.version.productName);
+                text("productVersion", job.version.productVersion);
+                if (auto value = fields->find("fileVersionParts"); value && value->string())
+                    ParseVersionParts(*value->string(), job.version.fileVersionParts);
+                if (auto value = fields->find("productVersionParts"); value && value->string())
+                    ParseVersionParts(*value->string(), job.version.productVersionParts);
+                if (auto value = fields->find("languages"); value && value->array())
+                {
+                    job.version.languages.clear();
+                    for (auto &language : *value->array())
+                        if (!language.string() || !ParseVersionLanguages(*language.string(), job.version.languages))
+                            utils::Fail("Unknown version info language in " + jobsPath);
+                }
+                if (auto value = fields->find("strings"); value && value->object())
+                {
+                    for (auto &[key, text] : *value->object())
+                        if (!text.string() || !ParseVersionString(key + "=" + *text.string(), utils::Utf8ToUtf16, job.version.strings))
+                            utils::Fail("Invalid version string \"" + key + "\" in " + jobsPath);
+                }
+            }
+            jobs.push_back(std::move(job));
+        }
+
+        for (size_t i = 0; i < jobs.size(); ++i)
+            for (size_t j = i + 1; j < jobs.size(); ++j)
+            {
+                if (std::filesystem::weakly_canonical(jobs[i].output) == std::filesystem::weakly_canonical(jobs[j].output))
+                    utils::Fail("Two jobs write the same output: " + utils::PathText(jobs[i].output));
+                // outputs replace their file by rename, which must not happen under another job still reading it
+                if (std::filesystem::weakly_canonical(jobs[i].output) == std::filesystem::weakly_canonical(jobs[j].input) ||
+                    std::filesystem::weakly_canonical(jobs[j].output) == std::filesystem::weakly_canonical(jobs[i].input))
+                    utils::Fail("A job output overwrites the input of another job: " + utils::PathText(jobs[i].output));
+            }
+        return jobs;
+    }
+
+    // 执行一次命令行打包，argc/argv 之外的全部逻辑；失败时抛出 utils::PackagerError
+    inline int Run(AgrumentParser &parser)
+    {
+        auto &args = parser.arguments();
+
+        // 无参数
+        if (args.empty())
+        {
+            parser.printHelp();
+            return 0;
+        }
+
+        // 帮助信息
+        if (args[0] == "--help")
+        {
+            parser.printHelp();
+            return 0;
+        }
+
+        // 版本信息
+        if (args[0] == "--version")
+        {
+            parser.printVersion();
+            return 0;
+        }
+
+        // 参数小于4个
+        if (args.size() < 3)
+        {
+            throw utils::PackagerError("Insufficient arguments provided. Use --help for usage information.");
+        }
+
+        // 性能追踪，结束时写出 Chrome trace 与汇总
+        std::string tracePath = parser.getOptionValue("--trace");
+        std::string traceSummaryPath = parser.getOptionValue("--trace-summary");
+        if (!tracePath.empty() || !traceSummaryPath.empty())
+        {
+            trace::Recorder::Instance().enable();
+        }
+        auto writeTrace = [&]()
+        {
+            auto &recorder = trace::Recorder::Instance();
+            if (!tracePath.empty())
+                recorder.writeChromeTrace(tracePath);
+            if (!traceSummaryPath.empty())
+                recorder.writeSummary(traceSummaryPath);
+        };
+
+        // 差分补丁：不打包时直接在两个已有文件之间生成或应用
+        std::string deltaFrom = parser.getOptionValue("--delta-from");
+        std::string deltaTo = parser.getOptionValue("--delta-to");
+        std::string deltaOut = parser.getOptionValue("--delta-out");
+        std::string deltaApply = parser.getOptionValue("--delta-apply");
+        if (!deltaApply.empty())
+        {
+            if (deltaFrom.empty() || deltaTo.empty())
+            {
+                throw utils::PackagerError("--delta-apply requires --delta-from and --delta-to.");
+            }
+            delta::Apply(deltaFrom, deltaApply, deltaTo);
+            std::cout << "Patched: " << deltaTo << std::endl;
+            writeTrace();
+            return 0;
+        }
+        if (!deltaFrom.empty() != !deltaOut.empty())
+        {
+            throw utils::PackagerError("--delta-from and --delta-out must be used together.");
+        }
+        if (!deltaFrom.empty() && !deltaTo.empty())
+        {
+            CreateDelta(parser, deltaFrom, deltaTo, deltaOut);
+            writeTrace();
+            return 0;
+        }
+
+        // 访问记录报告：只读取已有文件，不打包
+        std::string accessReport = parser.getOptionValue("--access-report");
+        if (!accessReport.empty())
+        {
+            std::string accessProfile = parser.getOptionValue("--access-profile");
+            if (accessProfile.empty())
+            {
+                throw utils::PackagerError("--access-report requires --access-profile.");
+            }
+            ReportAccessPages(accessReport, ReadAccessProfile(accessProfile));
+            writeTrace();
+            return 0;
+        }
+
+        // 批量输出任务文件
+        std::string jobsPath = parser.getOptionValue("--jobs");
+
+        // 输入程序文件
+        std::string inputPath = parser.getOptionValue("--input");
+        if (inputPath.empty() && jobsPath.empty())
+        {
+            throw utils::PackagerError("Input executable path is required.");
+        }
+
+        if (!inputPath.empty() && std::filesystem::exists(inputPath) == false)
+        {
+            throw utils::PackagerError("Input executable file does not exist.");
+        }
+
+        if (!deltaFrom.empty() && !jobsPath.empty())
+        {
+            throw utils::PackagerError("--delta-from cannot be combined with --jobs.");
+        }
+
+        // 准备ezi asset，批量模式下所有输出共享同一份资源
+        std::shared_ptr<AssetBundle> bundle;
+        std::shared_ptr<MappedFile> assetFile;
+        auto assetMode = AssetMode::Resource;
+        std::string assetPath = parser.getOptionValue("--ezi-asset");
+        std::string assetDir = parser.getOptionValue("--ezi-asset-dir");
+        if (!assetPath.empty() || !assetDir.empty())
+        {
+            std::string assetModeName = parser.getOptionValue("--asset-mode");
+            if (assetModeName == "overlay")
+            {
+                assetMode = AssetMode::Overlay;
+            }
+            else if (!assetModeName.empty() && assetModeName != "resource")
+            {
+                throw utils::PackagerError("Unknown asset mode: " + assetModeName);
+            }
+
+            if (assetDir.empty())
+            {
+                trace::Scope scope("read");
+                scope.detail(assetPath);
+                assetFile = MappedFile::OpenOrRead(assetPath);
+                scope.bytesIn(assetFile->bytes().size());
+            }
+            else
+            {
+                AssetBundleOptions options;
+                ReadAssetBundleOptions(parser, options);
+                bundle = AssetBundle::Build(options);
+                WriteAssetBundle(parser, *bundle);
+            }
+        }
+
+        // 版本信息
+        using utils::ToUtf16;
+
+        bool updateVersion = parser.getOptionValue("--update-version") == "true";
+        VersionInfo verInfo;
+        verInfo.companyName = ToUtf16(parser.getOptionValue("--ver-companyName"));
+        verInfo.fileDescription = ToUtf16(parser.getOptionValue("--ver-fileDescription"));
+        verInfo.fileVersion = ToUtf16(parser.getOptionValue("--ver-fileVersion"));
+        verInfo.productName = ToUtf16(parser.getOptionValue("--ver-productName"));
+        verInfo.productVersion = ToUtf16(parser.getOptionValue("--ver-productVersion"));
+        ParseVersionParts(parser.getOptionValue("--ver-fileVersionParts"), verInfo.fileVersionParts);
+        ParseVersionParts(parser.getOptionValue("--ver-productVersionParts"), verInfo.productVersionParts);
+        if (!ParseVersionLanguages(parser.getOptionValue("--ver-languages"), verInfo.languages))
+        {
+            throw utils::PackagerError("Unknown version info language: " + parser.getOptionValue("--ver-languages"));
+        }
+        for (auto &entry : parser.getOptionValues("--ver-string"))
+        {
+            if (!ParseVersionString(entry, ToUtf16, verInfo.strings))
+            {
+                throw utils::PackagerError("Invalid --ver-string, expected [lang:]Key=Value: " + entry);
+            }
+        }
+
+        std::string iconPath = parser.getOptionValue("--icon");
+        std::shared_ptr<std::vector<std::byte>> generatedIcon;
+        std::string iconPngPath = parser.getOptionValue("--icon-png");
+        if (!iconPngPath.empty())
+        {
+            generatedIcon = GenerateIcon(iconPngPath);
+            std::string iconOut = parser.getOptionValue("--icon-out");
+            if (!iconOut.empty())
+            {
+                std::ofstream out(iconOut, std::ios::binary | std::ios::trunc);
+                out.write(reinterpret_cast<const char *>(generatedIcon->data()), generatedIcon->size());
+                if (!out)
+                {
+                    throw utils::PackagerError("Failed to write icon.");
+                }
+            }
+        }
+
+        // 批量输出：资源只读取一次，各输出并行写入
+        if (!jobsPath.empty())
+        {
+            auto jobs = ReadJobs(jobsPath, inputPath, iconPath, updateVersion, verInfo);
+            std::optional<std::uint64_t> assetHash;
+            if (assetFile && assetMode == AssetMode::Overlay)
+            {
+                assetHash = hash::Crc32c::Of(assetFile->bytes());
+            }
+            else if (bundle && assetMode == AssetMode::Overlay)
+            {
+                assetHash = bundle->contentHash();
+            }
+
+            ThreadPool pool(static_cast<size_t>(parser.getNumberValue("--threads").value_or(0)));
+            std::cout << "Writing " << jobs.size() << " output(s) on " << pool.size() << " thread(s)..." << std::endl;
+            auto startTime = std::chrono::steady_clock::now();
+            std::atomic<size_t> finished{0};
+            pool.parallelFor(jobs.size(), [&](size_t i)
+                             {
+                auto &job = jobs[i];
+                auto jobStart = std::chrono::steady_clock::now();
+                ResourceUpdater updater(job.input, job.output, false);
+                if (!job.icon.empty() && job.icon.extension() == ".png")
+                {
+                    auto ico = GenerateIcon(job.icon, false);
+                    updater.updateIcon(ico, *ico);
+                }
+                else if (!job.icon.empty())
+                {
+                    updater.updateIcon(job.icon);
+                }
+                else if (generatedIcon)
+                {
+                    updater.updateIcon(generatedIcon, *generatedIcon);
+                }
+                if (bundle)
+                    updater.updateAsset(bundle, assetMode);
+                else if (assetFile)
+                    updater.updateAsset(pe::ResourceData(assetFile, assetFile->bytes()), assetMode, assetHash);
+                if (job.updateVersion)
+                    updater.updateVersionInfo(job.version);
+                updater.finalize();
+                auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - jobStart).count();
+                std::string line = "[" + std::to_string(++finished) + "/" + std::to_string(jobs.size()) + "] " + utils::PathText(job.output) +
+                                   " (" + std::to_string(static_cast<int>(elapsed * 1000)) + "ms)\n";
+                std::cout << line << std::flush; });
+            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+            std::cout << "Outputs written in " << static_cast<int>(elapsed * 1000) << "ms." << std::endl;
+            std::cout << "Peak memory: " << utils::PeakResidentBytes() / 1024 << "KB" << std::endl;
+            writeTrace();
+            return 0;
+        }
+
+        // 输出程序文件，未指定时原地更新输入文件
+        // 基础程序只读取一次，输出经临时文件一次写出后原子替换
+        std::string outputPath = parser.getOptionValue("--output");
+        ResourceUpdater updater(inputPath, outputPath);
+
+        // 修改icon
+        if (generatedIcon)
+        {
+            updater.updateIcon(generatedIcon, *generatedIcon);
+        }
+        else if (!iconPath.empty())
+        {
+            updater.updateIcon(iconPath);
+        }
+
+        // 修改ezi asset
+        if (bundle)
+        {
+            updater.updateAsset(bundle, assetMode);
+        }
+        else if (assetFile)
+        {
+            updater.updateAsset(assetFile, assetMode);
+        }
+
+        // 修改版本信息
+        if (updateVersion)
+        {
+            updater.updateVersionInfo(verInfo);
+        }
+
+        updater.finalize();
+
+        // 打包完成后生成上一版本到本次输出的差分补丁
+        if (!deltaFrom.empty())
+        {
+            CreateDelta(parser, deltaFrom, outputPath.empty() ? inputPath : outputPath, deltaOut);
+        }
+        writeTrace();
+        return 0;
+    }
+}
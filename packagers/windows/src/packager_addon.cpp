@@ -0,0 +1,428 @@
+// Node-API addon over the packager C API, loaded by packagers/windows/main.ts as
+// bin/eziapp-packager-winx64.node. Packaging runs on the libuv thread pool and settles a promise, so the
+// event loop keeps running; options are copied out of JS values before the work starts.
+//
+//   apiVersion(): number
+//   run(args: string[]): Promise<void>
+//   buildAssets(assets: Assets): Promise<Buffer>
+//   encodeVersion(version: Version): Buffer
+//   package(options: Package): Promise<string | undefined>   resolves to the summary json when options.summary is set
+//
+// Assets:  { assetDir: string, config: Buffer | string, packageName?, cacheDir?, threads?, binaryIndex?,
+//            accessProfile?: string[], accessBlockSize? }
+// Version: { companyName?, fileDescription?, fileVersion?, productName?, productVersion?, fileVersionParts?,
+//            productVersionParts?, languages?: string, strings?: string[] }
+// Package: { input: string, output?, icon?: Buffer, assets?: Assets, asset?: Buffer, overlay?, version?: Version, summary? }
+#include "packager_api.h"
+#include <node_api.h>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace
+{
+    // A malformed JS argument; reported as a TypeError.
+    class ArgumentError : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    void Check(napi_status status)
+    {
+        if (status != napi_ok)
+            throw ArgumentError("Unexpected Node-API failure.");
+    }
+
+    const char *OrNull(const std::string &text)
+    {
+        return text.empty() ? nullptr : text.c_str();
+    }
+
+    napi_valuetype TypeOf(napi_env env, napi_value value)
+    {
+        napi_valuetype type;
+        Check(napi_typeof(env, value, &type));
+        return type;
+    }
+
+    std::string ReadString(napi_env env, napi_value value, const char *name)
+    {
+        if (TypeOf(env, value) != napi_string)
+            throw ArgumentError(std::string(name) + " must be a string.");
+        size_t length = 0;
+        Check(napi_get_value_string_utf8(env, value, nullptr, 0, &length));
+        std::string text(length, '\0');
+        Check(napi_get_value_string_utf8(env, value, text.data(), length + 1, &length));
+        return text;
+    }
+
+    // The property, or nothing when it is missing, undefined or null.
+    std::optional<napi_value> Property(napi_env env, napi_value object, const char *name)
+    {
+        napi_value value;
+        Check(napi_get_named_property(env, object, name, &value));
+        auto type = TypeOf(env, value);
+        if (type == napi_undefined || type == napi_null)
+            return std::nullopt;
+        return value;
+    }
+
+    std::string StringProperty(napi_env env, napi_value object, const char *name)
+    {
+        auto value = Property(env, object, name);
+        return value ? ReadString(env, *value, name) : std::string();
+    }
+
+    // Buffer contents, or the UTF-8 bytes of a string.
+    std::string BytesProperty(napi_env env, napi_value object, const char *name)
+    {
+        auto value = Property(env, object, name);
+        if (!value)
+            return {};
+        bool isBuffer = false;
+        Check(napi_is_buffer(env, *value, &isBuffer));
+        if (!isBuffer)
+            return ReadString(env, *value, name);
+        void *data = nullptr;
+        size_t length = 0;
+        Check(napi_get_buffer_info(env, *value, &data, &length));
+        return std::string(static_cast<const char *>(data), length);
+    }
+
+    bool BoolProperty(napi_env env, napi_value object, const char *name)
+    {
+        auto value = Property(env, object, name);
+        if (!value)
+            return false;
+        bool result = false;
+        if (napi_get_value_bool(env, *value, &result) != napi_ok)
+            throw ArgumentError(std::string(name) + " must be a boolean.");
+        return result;
+    }
+
+    std::uint32_t NumberProperty(napi_env env, napi_value object, const char *name)
+    {
+        auto value = Property(env, object, name);
+        if (!value)
+            return 0;
+        std::uint32_t result = 0;
+        if (napi_get_value_uint32(env, *value, &result) != napi_ok)
+            throw ArgumentError(std::string(name) + " must be a number.");
+        return result;
+    }
+
+    std::vector<std::string> StringArray(napi_env env, napi_value value, const char *name)
+    {
+        bool isArray = false;
+        Check(napi_is_array(env, value, &isArray));
+        if (!isArray)
+            throw ArgumentError(std::string(name) + " must be an array of strings.");
+        std::uint32_t length = 0;
+        Check(napi_get_array_length(env, value, &length));
+        std::vector<std::string> result;
+        for (std::uint32_t i = 0; i < length; ++i)
+        {
+            napi_value element;
+            Check(napi_get_element(env, value, i, &element));
+            result.push_back(ReadString(env, element, name));
+        }
+        return result;
+    }
+
+    napi_value ObjectArgument(napi_env env, napi_callback_info info, const char *name)
+    {
+        size_t argc = 1;
+        napi_value argv[1];
+        Check(napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr));
+        if (argc < 1 || TypeOf(env, argv[0]) != napi_object)
+            throw ArgumentError(std::string(name) + " must be an object.");
+        return argv[0];
+    }
+
+    // Owned copies of the C API option structs, safe to use from the worker thread.
+    struct VersionInput
+    {
+        std::string companyName, fileDescription, fileVersion, productName, productVersion;
+        std::string fileVersionParts, productVersionParts, languages;
+        std::vector<std::string> strings;
+        std::vector<const char *> stringPointers;
+        ezi_packager_version version = {};
+
+        VersionInput(napi_env env, napi_value object)
+        {
+            version.struct_size = sizeof(version);
+            companyName = StringProperty(env, object, "companyName");
+            fileDescription = StringProperty(env, object, "fileDescription");
+            fileVersion = StringProperty(env, object, "fileVersion");
+            productName = StringProperty(env, object, "productName");
+            productVersion = StringProperty(env, object, "productVersion");
+            fileVersionParts = StringProperty(env, object, "fileVersionParts");
+            productVersionParts = StringProperty(env, object, "productVersionParts");
+            languages = StringProperty(env, object, "languages");
+            if (auto value = Property(env, object, "strings"))
+                strings = StringArray(env, *value, "strings");
+            for (auto &entry : strings)
+                stringPointers.push_back(entry.c_str());
+
+            version.company_name = OrNull(companyName);
+            version.file_description = OrNull(fileDescription);
+            version.file_version = OrNull(fileVersion);
+            version.product_name = OrNull(productName);
+            version.product_version = OrNull(productVersion);
+            version.file_version_parts = OrNull(fileVersionParts);
+            version.product_version_parts = OrNull(productVersionParts);
+            version.languages = OrNull(languages);
+            version.strings = stringPointers.data();
+            version.string_count = stringPointers.size();
+        }
+
+        VersionInput(const VersionInput &) = delete;
+        VersionInput &operator=(const VersionInput &) = delete;
+    };
+
+    struct AssetsInput
+    {
+        std::string assetDir, config, packageName, cacheDir;
+        std::vector<std::string> accessProfile;
+        std::vector<const char *> accessProfilePointers;
+        ezi_packager_assets assets = {};
+
+        AssetsInput(napi_env env, napi_value object)
+        {
+            assets.struct_size = sizeof(assets);
+            assetDir = StringProperty(env, object, "assetDir");
+            config = BytesProperty(env, object, "config");
+            packageName = StringProperty(env, object, "packageName");
+            cacheDir = StringProperty(env, object, "cacheDir");
+            assets.asset_dir = OrNull(assetDir);
+            assets.config = {reinterpret_cast<const std::uint8_t *>(config.data()), config.size()};
+            assets.package_name = OrNull(packageName);
+            assets.cache_dir = OrNull(cacheDir);
+            assets.threads = NumberProperty(env, object, "threads");
+            assets.binary_index = BoolProperty(env, object, "binaryIndex");
+            if (auto value = Property(env, object, "accessProfile"))
+                accessProfile = StringArray(env, *value, "accessProfile");
+            for (auto &id : accessProfile)
+                accessProfilePointers.push_back(id.c_str());
+            assets.access_profile = accessProfilePointers.data();
+            assets.access_profile_count = accessProfilePointers.size();
+            assets.access_block_size = NumberProperty(env, object, "accessBlockSize");
+        }
+
+        AssetsInput(const AssetsInput &) = delete;
+        AssetsInput &operator=(const AssetsInput &) = delete;
+    };
+
+    struct PackageInput
+    {
+        std::string input, output, icon, asset;
+        std::unique_ptr<AssetsInput> assets;
+        std::unique_ptr<VersionInput> version;
+        ezi_packager_package_options options = {};
+
+        PackageInput(napi_env env, napi_value object)
+        {
+            options.struct_size = sizeof(options);
+            input = StringProperty(env, object, "input");
+            output = StringProperty(env, object, "output");
+            icon = BytesProperty(env, object, "icon");
+            asset = BytesProperty(env, object, "asset");
+            if (auto value = Property(env, object, "assets"))
+                assets = std::make_unique<AssetsInput>(env, *value);
+            if (auto value = Property(env, object, "version"))
+                version = std::make_unique<VersionInput>(env, *value);
+            options.input = OrNull(input);
+            options.output = OrNull(output);
+            options.icon = {reinterpret_cast<const std::uint8_t *>(icon.data()), icon.size()};
+            options.assets = assets ? &assets->assets : nullptr;
+            options.asset = {reinterpret_cast<const std::uint8_t *>(asset.data()), asset.size()};
+            options.overlay = BoolProperty(env, object, "overlay");
+            options.version = version ? &version->version : nullptr;
+            options.summary = BoolProperty(env, object, "summary");
+        }
+    };
+
+    enum class ResultKind
+    {
+        None,
+        Buffer,
+        Text,
+    };
+
+    // One C API call on the libuv thread pool, settling a promise on the JS thread.
+    struct Work
+    {
+        napi_async_work work = nullptr;
+        napi_deferred deferred = nullptr;
+        std::function<int(ezi_packager_buffer *)> call;
+        ResultKind kind = ResultKind::None;
+        int status = EZI_PACKAGER_OK;
+        std::string error;
+        ezi_packager_buffer result = {};
+
+        ~Work() { ezi_packager_free(&result); }
+    };
+
+    void Execute(napi_env, void *data)
+    {
+        auto &work = *static_cast<Work *>(data);
+        work.status = work.call(&work.result);
+        // the last error is per thread, so it is taken here rather than on the JS thread
+        if (work.status != EZI_PACKAGER_OK)
+            work.error = ezi_packager_last_error();
+    }
+
+    void Complete(napi_env env, napi_status status, void *data)
+    {
+        std::unique_ptr<Work> work(static_cast<Work *>(data));
+        napi_value value = nullptr;
+        if (status == napi_ok && work->status == EZI_PACKAGER_OK)
+        {
+            if (work->kind == ResultKind::Buffer && work->result.data)
+            {
+                // the buffer takes over the library's allocation instead of copying it
+                auto buffer = work->result;
+                work->result = {};
+                napi_create_external_buffer(env, buffer.size, buffer.data, [](napi_env, void *, void *hint)
+                                            {
+                    auto owned = static_cast<ezi_packager_buffer *>(hint);
+                    ezi_packager_free(owned);
+                    delete owned; }, new ezi_packager_buffer(buffer), &value);
+            }
+            else if (work->kind == ResultKind::Text && work->result.data)
+            {
+                napi_create_string_utf8(env, reinterpret_cast<const char *>(work->result.data), work->result.size, &value);
+            }
+            else
+            {
+                napi_get_undefined(env, &value);
+            }
+            napi_resolve_deferred(env, work->deferred, value);
+        }
+        else
+        {
+            napi_value message;
+            auto text = status == napi_cancelled ? std::string("Packaging was cancelled.") : work->error;
+            napi_create_string_utf8(env, text.c_str(), text.size(), &message);
+            napi_create_error(env, nullptr, message, &value);
+            napi_reject_deferred(env, work->deferred, value);
+        }
+        napi_delete_async_work(env, work->work);
+    }
+
+    napi_value Start(napi_env env, const char *name, std::unique_ptr<Work> work)
+    {
+        napi_value promise, resourceName;
+        Check(napi_create_promise(env, &work->deferred, &promise));
+        Check(napi_create_string_utf8(env, name, NAPI_AUTO_LENGTH, &resourceName));
+        Check(napi_create_async_work(env, nullptr, resourceName, Execute, Complete, work.get(), &work->work));
+        Check(napi_queue_async_work(env, work->work));
+        work.release();
+        return promise;
+    }
+
+    // Runs body and turns an ArgumentError into a thrown TypeError.
+    template <typename Body>
+    napi_value Guard(napi_env env, Body &&body)
+    {
+        try
+        {
+            return body();
+        }
+        catch (const ArgumentError &error)
+        {
+            napi_throw_type_error(env, nullptr, error.what());
+        }
+        catch (const std::exception &error)
+        {
+            napi_throw_error(env, nullptr, error.what());
+        }
+        return nullptr;
+    }
+
+    napi_value ApiVersion(napi_env env, napi_callback_info)
+    {
+        napi_value value;
+        napi_create_int32(env, ezi_packager_api_version(), &value);
+        return value;
+    }
+
+    napi_value Run(napi_env env, napi_callback_info info)
+    {
+        return Guard(env, [&]
+                     {
+            size_t argc = 1;
+            napi_value argv[1];
+            Check(napi_get_cb_info(env, info, &argc, argv, nullptr, nullptr));
+            if (argc < 1)
+                throw ArgumentError("args must be an array of strings.");
+            auto args = std::make_shared<std::vector<std::string>>(StringArray(env, argv[0], "args"));
+            auto work = std::make_unique<Work>();
+            work->call = [args](ezi_packager_buffer *)
+            {
+                std::vector<const char *> pointers;
+                for (auto &arg : *args)
+                    pointers.push_back(arg.c_str());
+                return ezi_packager_run(static_cast<int>(pointers.size()), pointers.data());
+            };
+            return Start(env, "ezi_packager_run", std::move(work)); });
+    }
+
+    napi_value BuildAssets(napi_env env, napi_callback_info info)
+    {
+        return Guard(env, [&]
+                     {
+            auto input = std::make_shared<AssetsInput>(env, ObjectArgument(env, info, "assets"));
+            auto work = std::make_unique<Work>();
+            work->kind = ResultKind::Buffer;
+            work->call = [input](ezi_packager_buffer *result)
+            { return ezi_packager_build_assets(&input->assets, result); };
+            return Start(env, "ezi_packager_build_assets", std::move(work)); });
+    }
+
+    napi_value EncodeVersion(napi_env env, napi_callback_info info)
+    {
+        return Guard(env, [&]() -> napi_value
+                     {
+            VersionInput input(env, ObjectArgument(env, info, "version"));
+            ezi_packager_buffer resource = {};
+            if (ezi_packager_encode_version(&input.version, &resource) != EZI_PACKAGER_OK)
+                throw std::runtime_error(ezi_packager_last_error());
+            napi_value value;
+            auto status = napi_create_buffer_copy(env, resource.size, resource.data, nullptr, &value);
+            ezi_packager_free(&resource);
+            Check(status);
+            return value; });
+    }
+
+    napi_value Package(napi_env env, napi_callback_info info)
+    {
+        return Guard(env, [&]
+                     {
+            auto input = std::make_shared<PackageInput>(env, ObjectArgument(env, info, "options"));
+            auto work = std::make_unique<Work>();
+            work->kind = ResultKind::Text;
+            work->call = [input](ezi_packager_buffer *result)
+            { return ezi_packager_package(&input->options, result); };
+            return Start(env, "ezi_packager_package", std::move(work)); });
+    }
+}
+
+NAPI_MODULE_INIT()
+{
+    napi_property_descriptor properties[] = {
+        {"apiVersion", nullptr, ApiVersion, nullptr, nullptr, nullptr, napi_enumerable, nullptr},
+        {"run", nullptr, Run, nullptr, nullptr, nullptr, napi_enumerable, nullptr},
+        {"buildAssets", nullptr, BuildAssets, nullptr, nullptr, nullptr, napi_enumerable, nullptr},
+        {"encodeVersion", nullptr, EncodeVersion, nullptr, nullptr, nullptr, napi_enumerable, nullptr},
+        {"package", nullptr, Package, nullptr, nullptr, nullptr, napi_enumerable, nullptr},
+    };
+    if (napi_define_properties(env, exports, sizeof(properties) / sizeof(properties[0]), properties) != napi_ok)
+        return nullptr;
+    return exports;
+}
@@ -0,0 +1,264 @@
+#include "packager_api.h"
+#include "packager.hpp"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <filesystem>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using namespace ezi::builder::packager;
+
+    thread_local std::string LastError;
+    std::mutex CallMutex;
+
+    class InvalidArgument : public utils::PackagerError
+    {
+    public:
+        using utils::PackagerError::PackagerError;
+    };
+
+    std::string Text(const char *utf8)
+    {
+        return utf8 ? utf8 : "";
+    }
+
+    // Paths stay Unicode from the UTF-8 the C API takes down to the file APIs.
+    std::filesystem::path Path(const char *utf8)
+    {
+        return utils::Utf8Path(Text(utf8));
+    }
+
+    // The command line parser keeps option values in the ANSI code page on Windows, as they arrive on the
+    // packager's own command line. An argument that code page cannot represent is refused rather than
+    // turned into '?'; ezi_packager_package takes any path.
+    std::string Argument(const char *utf8)
+    {
+#ifdef _WIN32
+        if (!utf8 || !*utf8)
+            return {};
+        int wideLength = MultiByteToWideChar(CP_UTF8, 0, utf8, -1, nullptr, 0);
+        std::wstring wide(wideLength, L'\0');
+        MultiByteToWideChar(CP_UTF8, 0, utf8, -1, wide.data(), wideLength);
+        BOOL lossy = FALSE;
+        int length = WideCharToMultiByte(CP_ACP, WC_NO_BEST_FIT_CHARS, wide.c_str(), -1, nullptr, 0, nullptr, &lossy);
+        if (lossy)
+            throw InvalidArgument("Argument is not representable in the ANSI code page: " + Text(utf8));
+        std::string result(length, '\0');
+        WideCharToMultiByte(CP_ACP, WC_NO_BEST_FIT_CHARS, wide.c_str(), -1, result.data(), length, nullptr, nullptr);
+        result.resize(length ? length - 1 : 0);
+        return result;
+#else
+        return Text(utf8);
+#endif
+    }
+
+    // The part of a caller's struct its struct_size covers; fields added after the caller was built stay zero.
+    template <typename Options>
+    Options Covered(const Options &options, const char *name)
+    {
+        if (options.struct_size < sizeof(options.struct_size))
+            throw InvalidArgument(std::string(name) + ".struct_size must be set to the size of the struct.");
+        Options covered = {};
+        std::memcpy(&covered, &options, std::min(options.struct_size, sizeof(Options)));
+        return covered;
+    }
+
+    std::span<const std::byte> View(const ezi_packager_bytes &bytes)
+    {
+        return std::as_bytes(std::span(bytes.data, bytes.data ? bytes.size : 0));
+    }
+
+    void Give(const std::vector<std::span<const std::byte>> &parts, ezi_packager_buffer *buffer)
+    {
+        size_t size = 0;
+        for (auto &part : parts)
+            size += part.size();
+        auto data = static_cast<std::uint8_t *>(std::malloc(size ? size : 1));
+        if (!data)
+            throw std::bad_alloc();
+        size_t at = 0;
+        for (auto &part : parts)
+        {
+            std::memcpy(data + at, part.data(), part.size());
+            at += part.size();
+        }
+        buffer->data = data;
+        buffer->size = size;
+    }
+
+    // Calls are serialized: the trace recorder and the console are shared by the whole process. Every call
+    // starts with an empty trace.
+    template <typename Fn>
+    int Call(Fn &&fn)
+    {
+        std::lock_guard lock(CallMutex);
+        LastError.clear();
+        trace::Recorder::Instance().reset();
+        try
+        {
+            fn();
+            return EZI_PACKAGER_OK;
+        }
+        catch (const InvalidArgument &error)
+        {
+            LastError = error.what();
+            return EZI_PACKAGER_INVALID_ARGUMENT;
+        }
+        catch (const std::exception &error)
+        {
+            LastError = error.what();
+        }
+        catch (...)
+        {
+            LastError = "Unknown packaging error.";
+        }
+        return EZI_PACKAGER_ERROR;
+    }
+
+    VersionInfo ReadVersion(const ezi_packager_version &callerVersion)
+    {
+        auto version = Covered(callerVersion, "ezi_packager_version");
+        VersionInfo info;
+        info.companyName = utils::Utf8ToUtf16(Text(version.company_name));
+        info.fileDescription = utils::Utf8ToUtf16(Text(version.file_description));
+        info.fileVersion = utils::Utf8ToUtf16(Text(version.file_version));
+        info.productName = utils::Utf8ToUtf16(Text(version.product_name));
+        info.productVersion = utils::Utf8ToUtf16(Text(version.product_version));
+        ParseVersionParts(Text(version.file_version_parts), info.fileVersionParts);
+        ParseVersionParts(Text(version.product_version_parts), info.productVersionParts);
+        if (!ParseVersionLanguages(Text(version.languages), info.languages))
+            throw InvalidArgument("Unknown version info language: " + Text(version.languages));
+        for (size_t i = 0; i < version.string_count; ++i)
+            if (!ParseVersionString(Text(version.strings[i]), utils::Utf8ToUtf16, info.strings))
+                throw InvalidArgument("Invalid version string, expected [lang:]Key=Value: " + Text(version.strings[i]));
+        return info;
+    }
+
+    AssetBundleOptions ReadAssets(const ezi_packager_assets &callerAssets)
+    {
+        auto assets = Covered(callerAssets, "ezi_packager_assets");
+        if (!assets.asset_dir || !assets.config.size)
+            throw InvalidArgument("The asset directory and the config json are required.");
+        AssetBundleOptions options;
+        options.assetDir = Path(assets.asset_dir);
+        auto config = View(assets.config);
+        options.config.assign(reinterpret_cast<const char *>(config.data()), config.size());
+        if (assets.package_name && *assets.package_name)
+            options.packageName = assets.package_name;
+        options.cacheDir = Path(assets.cache_dir);
+        options.threads = assets.threads;
+        options.index = assets.binary_index ? format::IndexKind::Binary : format::IndexKind::Json;
+        for (size_t i = 0; i < assets.access_profile_count; ++i)
+            options.accessProfile.push_back(Text(assets.access_profile[i]));
+        options.accessBlockSize = assets.access_block_size;
+        return options;
+    }
+}
+
+extern "C"
+{
+    int ezi_packager_api_version(void)
+    {
+        return EZI_PACKAGER_API_VERSION;
+    }
+
+    const char *ezi_packager_last_error(void)
+    {
+        return LastError.c_str();
+    }
+
+    void ezi_packager_free(ezi_packager_buffer *buffer)
+    {
+        if (!buffer)
+            return;
+        std::free(buffer->data);
+        buffer->data = nullptr;
+        buffer->size = 0;
+    }
+
+    int ezi_packager_run(int argc, const char *const *argv)
+    {
+        return Call([&]
+                    {
+            std::vector<std::string> args;
+            for (int i = 0; i < argc; ++i)
+                args.push_back(Argument(argv[i]));
+            AgrumentParser parser(std::move(args), PackagerOptions);
+            if (Run(parser) != 0)
+                throw utils::PackagerError("Packaging failed."); });
+    }
+
+    int ezi_packager_build_assets(const ezi_packager_assets *assets, ezi_packager_buffer *bundle)
+    {
+        return Call([&]
+                    {
+            if (!assets || !bundle)
+                throw InvalidArgument("ezi_packager_build_assets needs assets and bundle.");
+            Give(AssetBundle::Build(ReadAssets(*assets))->parts(), bundle); });
+    }
+
+    int ezi_packager_encode_version(const ezi_packager_version *version, ezi_packager_buffer *resource)
+    {
+        return Call([&]
+                    {
+            if (!version || !resource)
+                throw InvalidArgument("ezi_packager_encode_version needs version and resource.");
+            auto encoded = EncodeVersionInfo(ReadVersion(*version));
+            Give({encoded}, resource); });
+    }
+
+    int ezi_packager_package(const ezi_packager_package_options *callerOptions, ezi_packager_buffer *summary)
+    {
+        return Call([&]
+                    {
+            if (!callerOptions)
+                throw InvalidArgument("ezi_packager_package needs options.");
+            auto options = Covered(*callerOptions, "ezi_packager_package_options");
+            if (!options.input || !*options.input)
+                throw InvalidArgument("The input executable is required.");
+            if (options.summary)
+                trace::Recorder::Instance().enable();
+
+            // everything is validated and built before the output is touched
+            std::shared_ptr<AssetBundle> bundle;
+            if (options.assets)
+                bundle = AssetBundle::Build(ReadAssets(*options.assets));
+            std::optional<VersionInfo> version;
+            if (options.version)
+                version = ReadVersion(*options.version);
+
+            ResourceUpdater updater(Path(options.input), Path(options.output));
+            auto icon = View(options.icon);
+            constexpr unsigned char pngSignature[] = {0x89, 'P', 'N', 'G'};
+            if (icon.size() >= sizeof(pngSignature) && std::memcmp(icon.data(), pngSignature, sizeof(pngSignature)) == 0)
+            {
+                auto ico = GenerateIcon(icon, "icon");
+                updater.updateIcon(ico, *ico);
+            }
+            else if (!icon.empty())
+            {
+                updater.updateIcon(nullptr, icon);
+            }
+            auto mode = options.overlay ? AssetMode::Overlay : AssetMode::Resource;
+            if (bundle)
+                updater.updateAsset(bundle, mode);
+            else if (options.asset.size)
+                updater.updateAsset(pe::ResourceData(View(options.asset)), mode);
+            if (version)
+                updater.updateVersionInfo(*version);
+            updater.finalize();
+
+            if (options.summary && summary)
+            {
+                auto text = trace::Recorder::Instance().summary();
+                Give({std::as_bytes(std::span(text))}, summary);
+            } });
+    }
+}
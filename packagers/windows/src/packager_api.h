@@ -0,0 +1,129 @@
+#ifndef EZI_PACKAGER_API_H
+#define EZI_PACKAGER_API_H
+
+/*
+ * C API of the Windows packager library, stable across releases. Every options struct starts with struct_size,
+ * which the caller sets to sizeof the struct as it was compiled. Structs only grow at the end, and
+ * EZI_PACKAGER_API_VERSION is raised when they do. The library reads only the fields struct_size covers and
+ * treats the rest as zero, so zero must always keep the earlier behaviour. Callers built against an older
+ * header therefore keep working. ezi_packager_bytes and ezi_packager_buffer never change. Version 2
+ * introduced struct_size, so callers built against version 1 must be rebuilt.
+ *
+ * All strings are UTF-8. Calls may come from any thread but run one at a time, since tracing and the
+ * console output are process-wide.
+ *
+ * Functions return EZI_PACKAGER_OK or an error status; ezi_packager_last_error() then describes the failure
+ * on the calling thread. Buffers returned by the library are released with ezi_packager_free().
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(EZI_PACKAGER_STATIC)
+#define EZI_PACKAGER_API
+#elif defined(_WIN32) && defined(EZI_PACKAGER_BUILD)
+#define EZI_PACKAGER_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define EZI_PACKAGER_API __declspec(dllimport)
+#else
+#define EZI_PACKAGER_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define EZI_PACKAGER_API_VERSION 2
+
+    enum
+    {
+        EZI_PACKAGER_OK = 0,
+        EZI_PACKAGER_ERROR = 1,            /* packaging failed, see ezi_packager_last_error() */
+        EZI_PACKAGER_INVALID_ARGUMENT = 2, /* a required pointer or field was missing */
+    };
+
+    /* Caller-owned input bytes, only read during the call. */
+    typedef struct ezi_packager_bytes
+    {
+        const uint8_t *data;
+        size_t size;
+    } ezi_packager_bytes;
+
+    /* Library-owned output bytes. */
+    typedef struct ezi_packager_buffer
+    {
+        uint8_t *data;
+        size_t size;
+    } ezi_packager_buffer;
+
+    /* VS_VERSIONINFO fields; NULL or empty strings are left out. */
+    typedef struct ezi_packager_version
+    {
+        size_t struct_size;
+        const char *company_name;
+        const char *file_description;
+        const char *file_version;
+        const char *product_name;
+        const char *product_version;
+        const char *file_version_parts;    /* "x.x.x.x" */
+        const char *product_version_parts; /* "x.x.x.x" */
+        const char *languages;             /* "zh-CN,en-US", en-US when NULL */
+        const char *const *strings;        /* "[lang:]Key=Value" */
+        size_t string_count;
+    } ezi_packager_version;
+
+    /* The asset bundle built from a directory, as with --ezi-asset-dir. */
+    typedef struct ezi_packager_assets
+    {
+        size_t struct_size;
+        const char *asset_dir;
+        ezi_packager_bytes config; /* the ezi.config.manifest json */
+        const char *package_name;  /* com.ezi.app when NULL */
+        const char *cache_dir;     /* NULL disables the compression cache */
+        uint32_t threads;          /* 0 uses every core */
+        int binary_index;          /* nonzero writes the binary hashed index instead of the JSON manifest */
+        const char *const *access_profile; /* asset ids in startup read order, laid out first */
+        size_t access_profile_count;
+        uint64_t access_block_size; /* compress the first profiled assets up to this many bytes as one frame, 0 for none */
+    } ezi_packager_assets;
+
+    /* One packaged executable, as with --input/--output and the resource options. */
+    typedef struct ezi_packager_package_options
+    {
+        size_t struct_size;
+        const char *input;
+        const char *output;                  /* NULL updates input in place */
+        ezi_packager_bytes icon;             /* .ico or .png contents, empty keeps the current icon */
+        const ezi_packager_assets *assets;   /* builds the bundle, or */
+        ezi_packager_bytes asset;            /* stores these bytes as the asset */
+        int overlay;                         /* nonzero appends the asset as an overlay instead of a resource */
+        const ezi_packager_version *version; /* NULL keeps the current version info */
+        int summary;                         /* nonzero returns the --trace-summary json */
+    } ezi_packager_package_options;
+
+    EZI_PACKAGER_API int ezi_packager_api_version(void);
+
+    /* Description of the last failure on this thread, empty after a success. */
+    EZI_PACKAGER_API const char *ezi_packager_last_error(void);
+
+    EZI_PACKAGER_API void ezi_packager_free(ezi_packager_buffer *buffer);
+
+    /* The command line packager: argv holds the options without the program name, one token each. On Windows
+     * every token must be representable in the ANSI code page, as on the packager's own command line. */
+    EZI_PACKAGER_API int ezi_packager_run(int argc, const char *const *argv);
+
+    /* Builds ezi.assets.binary into *bundle. */
+    EZI_PACKAGER_API int ezi_packager_build_assets(const ezi_packager_assets *assets, ezi_packager_buffer *bundle);
+
+    /* Encodes the RT_VERSION resource into *resource. */
+    EZI_PACKAGER_API int ezi_packager_encode_version(const ezi_packager_version *version, ezi_packager_buffer *resource);
+
+    /* Writes one packaged executable; *summary is filled when options->summary is set and summary is not NULL. */
+    EZI_PACKAGER_API int ezi_packager_package(const ezi_packager_package_options *options, ezi_packager_buffer *summary);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
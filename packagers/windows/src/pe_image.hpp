@@ -0,0 +1,793 @@
+#pragma once
+
+#include "utils.hpp"
+#include "asset_format.hpp"
+#include "mapped_file.hpp"
+#include "output_file.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace ezi::builder::packager::pe
+{
+#pragma pack(push, 1)
+    struct FileHeader
+    {
+        std::uint16_t machine;
+        std::uint16_t numberOfSections;
+        std::uint32_t timeDateStamp;
+        std::uint32_t pointerToSymbolTable;
+        std::uint32_t numberOfSymbols;
+        std::uint16_t sizeOfOptionalHeader;
+        std::uint16_t characteristics;
+    };
+
+    struct DataDirectory
+    {
+        std::uint32_t virtualAddress;
+        std::uint32_t size;
+    };
+
+    struct SectionHeader
+    {
+        char name[8];
+        std::uint32_t virtualSize;
+        std::uint32_t virtualAddress;
+        std::uint32_t sizeOfRawData;
+        std::uint32_t pointerToRawData;
+        std::uint32_t pointerToRelocations;
+        std::uint32_t pointerToLinenumbers;
+        std::uint16_t numberOfRelocations;
+        std::uint16_t numberOfLinenumbers;
+        std::uint32_t characteristics;
+    };
+
+    struct ResourceDirectory
+    {
+        std::uint32_t characteristics;
+        std::uint32_t timeDateStamp;
+        std::uint16_t majorVersion;
+        std::uint16_t minorVersion;
+        std::uint16_t numberOfNamedEntries;
+        std::uint16_t numberOfIdEntries;
+    };
+
+    struct ResourceDirectoryEntry
+    {
+        std::uint32_t name;
+        std::uint32_t offsetToData;
+    };
+
+    struct ResourceDataEntry
+    {
+        std::uint32_t offsetToData;
+        std::uint32_t size;
+        std::uint32_t codePage;
+        std::uint32_t reserved;
+    };
+#pragma pack(pop)
+
+    namespace layout
+    {
+        constexpr std::uint32_t PeOffsetField = 0x3C;
+        constexpr std::uint32_t PeSignature = 0x00004550; // "PE\0\0"
+        constexpr std::uint16_t Pe32Magic = 0x10B;
+        constexpr std::uint16_t Pe32PlusMagic = 0x20B;
+
+        // field offsets relative to the start of the optional header
+        constexpr std::uint32_t SizeOfInitializedData = 8;
+        constexpr std::uint32_t SectionAlignment = 32;
+        constexpr std::uint32_t FileAlignment = 36;
+        constexpr std::uint32_t SizeOfImage = 56;
+        constexpr std::uint32_t SizeOfHeaders = 60;
+        constexpr std::uint32_t CheckSum = 64;
+        constexpr std::uint32_t DataDirectories32 = 96;
+        constexpr std::uint32_t DataDirectories64 = 112;
+
+        constexpr std::uint32_t SecurityDirectory = 4;
+        constexpr std::uint32_t ResourceDirectory = 2;
+
+        constexpr std::uint32_t SubdirectoryFlag = 0x80000000;
+        constexpr std::uint32_t ResourceSectionFlags = 0x40000040; // INITIALIZED_DATA | MEM_READ
+        constexpr std::uint32_t ResourceDataAlignment = 8;
+    }
+
+    // Resource type/name: either a numeric id or a UTF-16 string.
+    struct ResourceId
+    {
+        std::uint16_t id = 0;
+        std::u16string name;
+
+        ResourceId() = default;
+        ResourceId(std::uint16_t id) : id(id) {}
+        ResourceId(std::u16string name) : name(std::move(name)) {}
+
+        bool isNamed() const { return !name.empty(); }
+
+        // Named entries must precede id entries; names compare case-insensitively like the loader does.
+        bool operator<(const ResourceId &other) const
+        {
+            if (isNamed() != other.isNamed())
+                return isNamed();
+            if (!isNamed())
+                return id < other.id;
+            auto upper = [](char16_t c)
+            { return c >= u'a' && c <= u'z' ? static_cast<char16_t>(c - 32) : c; };
+            return std::lexicographical_compare(name.begin(), name.end(), other.name.begin(), other.name.end(),
+                                                [&](char16_t a, char16_t b)
+                                                { return upper(a) < upper(b); });
+        }
+    };
+
+    struct ResourceData
+    {
+        std::vector<std::span<const std::byte>> parts; // written back to back
+        std::shared_ptr<const void> owner;               // keeps `parts` alive; empty when they point into the image itself
+        std::uint32_t codePage = 0;
+        bool mapped = false;    // `parts` are file mappings whose pages can be evicted once written
+        std::vector<const MappedFile *> sources; // per part when set: the mapping it lies in, copied by range
+        std::uint32_t alignment = layout::ResourceDataAlignment; // of the data's RVA, raised for page-aligned payloads
+
+        ResourceData() = default;
+        ResourceData(std::span<const std::byte> bytes, std::shared_ptr<const void> owner = {}, bool mapped = false)
+            : parts{bytes}, owner(std::move(owner)), mapped(mapped)
+        {
+        }
+        ResourceData(const std::shared_ptr<MappedFile> &file, std::span<const std::byte> bytes)
+            : parts{bytes}, owner(file), mapped(file->mapped()), sources{file.get()}
+        {
+        }
+
+        size_t size() const
+        {
+            size_t total = 0;
+            for (auto &part : parts)
+                total += part.size();
+            return total;
+        }
+    };
+
+    // Optional header CheckSum: the one's complement sum of the file's 16-bit words, with the field itself read
+    // as zero, plus the file size. Ranges may be added in any order. The sum runs over 32-bit words in four
+    // independent lanes, which compilers turn into vector adds; since 2^16 = 1 modulo 0xFFFF, folding
+    // the wide sum gives the same value, and a range at an odd offset only swaps the bytes of its sum.
+    class Checksum
+    {
+    private:
+        std::uint64_t sum = 0;
+
+        static std::uint32_t fold(std::uint64_t value)
+        {
+            while (value >> 16)
+                value = (value & 0xFFFF) + (value >> 16);
+            return static_cast<std::uint32_t>(value);
+        }
+
+    public:
+        void add(std::uint64_t offset, std::span<const std::byte> bytes)
+        {
+            // lanes stay far from overflow for slices below 2^34 bytes
+            constexpr size_t slice = size_t{1} << 30;
+            for (size_t at = 0; at < bytes.size(); at += slice)
+            {
+                auto part = bytes.subspan(at, std::min(slice, bytes.size() - at));
+                auto *p = reinterpret_cast<const std::uint8_t *>(part.data());
+                std::uint64_t lanes[4] = {};
+                size_t i = 0;
+                for (; i + 16 <= part.size(); i += 16)
+                {
+                    std::uint32_t words[4];
+                    std::memcpy(words, p + i, sizeof(words));
+                    for (int k = 0; k < 4; ++k)
+                        lanes[k] += words[k];
+                }
+                std::uint64_t partial = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+                for (; i + 2 <= part.size(); i += 2)
+                    partial += p[i] | (p[i + 1] << 8);
+                if (i < part.size())
+                    partial += p[i];
+                auto folded = fold(partial);
+                if ((offset + at) & 1)
+                    folded = ((folded & 0xFF) << 8) | (folded >> 8);
+                sum += folded;
+            }
+        }
+
+        // Takes back bytes that were added, e.g. a stale CheckSum field copied with the rest of the headers.
+        void remove(std::uint64_t offset, std::span<const std::byte> bytes)
+        {
+            std::vector<std::byte> complement(bytes.begin(), bytes.end());
+            for (auto &b : complement)
+                b = ~b;
+            add(offset, complement);
+        }
+
+        std::uint32_t value(std::uint64_t fileSize) const
+        {
+            return fold(sum) + static_cast<std::uint32_t>(fileSize);
+        }
+    };
+
+    using LanguageTable = std::map<std::uint16_t, ResourceData>;
+    using NameTable = std::map<ResourceId, LanguageTable>;
+    using ResourceTree = std::map<ResourceId, NameTable>;
+
+    class Image
+    {
+    private:
+        std::span<const std::byte> file;
+        std::shared_ptr<const void> fileOwner;
+        std::filesystem::path sourcePath;
+        const MappedFile *fileSource = nullptr; // the input mapping behind `file`, when loaded from a path
+        bool fileMapped = false;
+        std::uint32_t fileHeaderOffset = 0;
+        std::uint32_t optionalHeaderOffset = 0;
+        std::uint32_t sectionTableOffset = 0;
+        std::uint32_t dataDirectoryOffset = 0;
+        std::uint32_t dataDirectoryCount = 0;
+        std::vector<SectionHeader> sections;
+        ResourceTree tree;
+        bool resourcesChanged = false;
+        struct Overlay
+        {
+            ResourceData data;
+            std::uint32_t alignment;
+        };
+        std::vector<Overlay> overlays;
+
+    public:
+        Image(std::span<const std::byte> data, std::shared_ptr<const void> owner, bool mapped = false)
+            : file(data), fileOwner(std::move(owner)), fileMapped(mapped)
+        {
+            parseHeaders();
+            parseResources();
+        }
+
+        static Image Load(const std::filesystem::path &path)
+        {
+            auto mapping = MappedFile::Open(path);
+            Image image(mapping->bytes(), mapping, true);
+            image.sourcePath = path;
+            image.fileSource = mapping.get();
+            return image;
+        }
+
+        const ResourceTree &resources() const { return tree; }
+
+        void setResource(const ResourceId &type, const ResourceId &name, std::uint16_t language, ResourceData data)
+        {
+            resourcesChanged = true;
+            tree[type][name][language] = std::move(data);
+        }
+
+        // Removes every language of a resource; false when there was none.
+        bool removeResource(const ResourceId &type, const ResourceId &name)
+        {
+            auto names = tree.find(type);
+            if (names == tree.end() || !names->second.erase(name))
+                return false;
+            if (names->second.empty())
+                tree.erase(names);
+            resourcesChanged = true;
+            return true;
+        }
+
+    private:
+        template <typename T>
+        T read(size_t offset) const
+        {
+            if (offset + sizeof(T) > file.size())
+                utils::Fail("Malformed PE image: read past end of file.");
+            T value;
+            std::memcpy(&value, file.data() + offset, sizeof(T));
+            return value;
+        }
+
+        template <typename T>
+        static void write(std::vector<std::byte> &buffer, size_t offset, const T &value)
+        {
+            std::memcpy(buffer.data() + offset, &value, sizeof(T));
+        }
+
+        std::uint32_t optionalField(std::uint32_t field) const
+        {
+            return read<std::uint32_t>(optionalHeaderOffset + field);
+        }
+
+        DataDirectory dataDirectory(std::uint32_t index) const
+        {
+            if (index >= dataDirectoryCount)
+                return {0, 0};
+            return read<DataDirectory>(dataDirectoryOffset + index * sizeof(DataDirectory));
+        }
+
+        void parseHeaders()
+        {
+            if (file.size() < 0x40 || read<std::uint16_t>(0) != 0x5A4D)
+                utils::Fail("Not a PE image: missing MZ signature.");
+            auto peOffset = read<std::uint32_t>(layout::PeOffsetField);
+            if (read<std::uint32_t>(peOffset) != layout::PeSignature)
+                utils::Fail("Not a PE image: missing PE signature.");
+
+            fileHeaderOffset = peOffset + 4;
+            auto fileHeader = read<FileHeader>(fileHeaderOffset);
+            optionalHeaderOffset = fileHeaderOffset + sizeof(FileHeader);
+            sectionTableOffset = optionalHeaderOffset + fileHeader.sizeOfOptionalHeader;
+
+            auto magic = read<std::uint16_t>(optionalHeaderOffset);
+            if (magic == layout::Pe32Magic)
+                dataDirectoryOffset = optionalHeaderOffset + layout::DataDirectories32;
+            else if (magic == layout::Pe32PlusMagic)
+                dataDirectoryOffset = optionalHeaderOffset + layout::DataDirectories64;
+            else
+                utils::Fail("Unsupported PE optional header.");
+            dataDirectoryCount = read<std::uint32_t>(dataDirectoryOffset - 4);
+
+            for (std::uint16_t i = 0; i < fileHeader.numberOfSections; ++i)
+            {
+                auto section = read<SectionHeader>(sectionTableOffset + i * sizeof(SectionHeader));
+                if (std::uint64_t{section.pointerToRawData} + section.sizeOfRawData > file.size())
+                    utils::Fail("Malformed PE image: section data past end of file.");
+                sections.push_back(section);
+            }
+            if (sections.empty())
+                utils::Fail("PE image has no sections.");
+        }
+
+        size_t rvaToOffset(std::uint32_t rva, std::uint32_t size) const
+        {
+            for (auto &section : sections)
+            {
+                if (rva >= section.virtualAddress && std::uint64_t{rva} + size <= std::uint64_t{section.virtualAddress} + section.sizeOfRawData)
+                    return section.pointerToRawData + (rva - section.virtualAddress);
+            }
+            utils::Fail("Malformed PE image: RVA outside of sections.");
+            return 0;
+        }
+
+        ResourceId readResourceId(size_t base, std::uint32_t name) const
+        {
+            if (!(name & layout::SubdirectoryFlag))
+                return ResourceId(static_cast<std::uint16_t>(name));
+            size_t offset = base + (name & ~layout::SubdirectoryFlag);
+            auto length = read<std::uint16_t>(offset);
+            if (offset + 2 + length * 2 > file.size())
+                utils::Fail("Malformed resource name.");
+            std::u16string text(length, u'\0');
+            std::memcpy(text.data(), file.data() + offset + 2, length * 2);
+            return ResourceId(std::move(text));
+        }
+
+        template <typename Fn>
+        void forEachEntry(size_t base, std::uint32_t tableOffset, Fn &&fn) const
+        {
+            auto dir = read<ResourceDirectory>(base + tableOffset);
+            size_t count = dir.numberOfNamedEntries + dir.numberOfIdEntries;
+            for (size_t i = 0; i < count; ++i)
+                fn(read<ResourceDirectoryEntry>(base + tableOffset + sizeof(ResourceDirectory) + i * sizeof(ResourceDirectoryEntry)));
+        }
+
+        void parseResources()
+        {
+            auto dir = dataDirectory(layout::ResourceDirectory);
+            if (dir.virtualAddress == 0 || dir.size == 0)
+                return;
+            size_t base = rvaToOffset(dir.virtualAddress, sizeof(ResourceDirectory));
+
+            forEachEntry(base, 0, [&](const ResourceDirectoryEntry &typeEntry)
+                         {
+                if (!(typeEntry.offsetToData & layout::SubdirectoryFlag))
+                    utils::Fail("Malformed resource directory.");
+                auto type = readResourceId(base, typeEntry.name);
+                forEachEntry(base, typeEntry.offsetToData & ~layout::SubdirectoryFlag, [&](const ResourceDirectoryEntry &nameEntry)
+                             {
+                    if (!(nameEntry.offsetToData & layout::SubdirectoryFlag))
+                        utils::Fail("Malformed resource directory.");
+                    auto name = readResourceId(base, nameEntry.name);
+                    forEachEntry(base, nameEntry.offsetToData & ~layout::SubdirectoryFlag, [&](const ResourceDirectoryEntry &langEntry)
+                                 {
+                        if (langEntry.offsetToData & layout::SubdirectoryFlag)
+                            utils::Fail("Malformed resource directory.");
+                        auto entry = read<ResourceDataEntry>(base + langEntry.offsetToData);
+                        size_t offset = rvaToOffset(entry.offsetToData, entry.size);
+                        if (std::uint64_t{offset} + entry.size > file.size())
+                            utils::Fail("Malformed PE image: resource data past end of file.");
+                        ResourceData data(file.subspan(offset, entry.size), {}, fileMapped);
+                        data.codePage = entry.codePage;
+                        tree[type][name][static_cast<std::uint16_t>(langEntry.name)] = std::move(data); }); }); });
+        }
+
+        struct ResourceSection
+        {
+            std::vector<std::byte> directory;                 // tables, data entries and name strings
+            std::vector<std::pair<size_t, ResourceData>> data; // payloads with their offsets in the section
+            size_t size = 0;
+        };
+
+        // Lay out the .rsrc section: every directory table first (root, type level, name level),
+        // then the data entries, then the name strings, then the 8-byte aligned payloads.
+        ResourceSection buildResourceSection(std::uint32_t sectionRva) const
+        {
+            size_t tablesSize = sizeof(ResourceDirectory) + tree.size() * sizeof(ResourceDirectoryEntry);
+            size_t leafCount = 0;
+            std::map<std::u16string, size_t> strings;
+            size_t stringsSize = 0;
+            auto addString = [&](const ResourceId &id)
+            {
+                if (id.isNamed() && strings.emplace(id.name, stringsSize).second)
+                    stringsSize += 2 + id.name.size() * 2;
+            };
+            for (auto &[type, names] : tree)
+            {
+                addString(type);
+                tablesSize += sizeof(ResourceDirectory) + names.size() * sizeof(ResourceDirectoryEntry);
+                for (auto &[name, languages] : names)
+                {
+                    addString(name);
+                    tablesSize += sizeof(ResourceDirectory) + languages.size() * sizeof(ResourceDirectoryEntry);
+                    leafCount += languages.size();
+                }
+            }
+
+            size_t dataEntriesOffset = tablesSize;
+            size_t stringsOffset = dataEntriesOffset + leafCount * sizeof(ResourceDataEntry);
+
+            ResourceSection section;
+            section.directory.resize(utils::AlignUp<size_t>(stringsOffset + stringsSize, layout::ResourceDataAlignment));
+            size_t cursor = section.directory.size();
+
+            for (auto &[text, offset] : strings)
+            {
+                size_t at = stringsOffset + offset;
+                write(section.directory, at, static_cast<std::uint16_t>(text.size()));
+                std::memcpy(section.directory.data() + at + 2, text.data(), text.size() * 2);
+            }
+
+            auto entryName = [&](const ResourceId &id) -> std::uint32_t
+            {
+                if (!id.isNamed())
+                    return id.id;
+                return layout::SubdirectoryFlag | static_cast<std::uint32_t>(stringsOffset + strings.at(id.name));
+            };
+            auto writeTable = [&](size_t at, const auto &table)
+            {
+                ResourceDirectory dir = {};
+                for (auto &[key, value] : table)
+                {
+                    if constexpr (std::is_same_v<std::decay_t<decltype(key)>, ResourceId>)
+                    {
+                        if (key.isNamed())
+                            dir.numberOfNamedEntries++;
+                        else
+                            dir.numberOfIdEntries++;
+                    }
+                    else
+                    {
+                        dir.numberOfIdEntries++;
+                    }
+                }
+                write(section.directory, at, dir);
+            };
+
+            size_t nextTable = sizeof(ResourceDirectory) + tree.size() * sizeof(ResourceDirectoryEntry);
+            size_t nextNameTable = nextTable;
+            for (auto &[type, names] : tree)
+                nextNameTable += sizeof(ResourceDirectory) + names.size() * sizeof(ResourceDirectoryEntry);
+            size_t nextDataEntry = dataEntriesOffset;
+
+            writeTable(0, tree);
+            size_t rootEntry = sizeof(ResourceDirectory);
+            for (auto &[type, names] : tree)
+            {
+                size_t typeTable = nextTable;
+                nextTable += sizeof(ResourceDirectory) + names.size() * sizeof(ResourceDirectoryEntry);
+                write(section.directory, rootEntry, ResourceDirectoryEntry{entryName(type), layout::SubdirectoryFlag | static_cast<std::uint32_t>(typeTable)});
+                rootEntry += sizeof(ResourceDirectoryEntry);
+
+                writeTable(typeTable, names);
+                size_t typeEntry = typeTable + sizeof(ResourceDirectory);
+                for (auto &[name, languages] : names)
+                {
+                    size_t nameTable = nextNameTable;
+                    nextNameTable += sizeof(ResourceDirectory) + languages.size() * sizeof(ResourceDirectoryEntry);
+                    write(section.directory, typeEntry, ResourceDirectoryEntry{entryName(name), layout::SubdirectoryFlag | static_cast<std::uint32_t>(nameTable)});
+                    typeEntry += sizeof(ResourceDirectoryEntry);
+
+                    writeTable(nameTable, languages);
+                    size_t nameEntry = nameTable + sizeof(ResourceDirectory);
+                    for (auto &[language, data] : languages)
+                    {
+                        cursor = utils::AlignUp<size_t>(cursor, std::max(data.alignment, layout::ResourceDataAlignment));
+                        size_t size = data.size();
+                        if (cursor + size > UINT32_MAX - sectionRva)
+                            utils::Fail("Resource section exceeds 4GB limit.");
+                        write(section.directory, nameEntry, ResourceDirectoryEntry{language, static_cast<std::uint32_t>(nextDataEntry)});
+                        nameEntry += sizeof(ResourceDirectoryEntry);
+                        write(section.directory, nextDataEntry, ResourceDataEntry{static_cast<std::uint32_t>(sectionRva + cursor), static_cast<std::uint32_t>(size), data.codePage, 0});
+                        nextDataEntry += sizeof(ResourceDataEntry);
+
+                        section.data.emplace_back(cursor, data);
+                        cursor += size;
+                    }
+                }
+            }
+            section.size = cursor;
+            return section;
+        }
+
+        struct SaveLayout
+        {
+            bool appendOnly = false; // resources untouched: keep the file as is and only add overlays
+            SectionHeader target = {};
+            size_t targetIndex = 0;
+            size_t prefixEnd = 0;
+            std::uint32_t previousRawSize = 0;
+            size_t imageEnd = 0;
+            size_t overlayEnd = 0;
+            size_t end = 0;
+            ResourceSection section;
+            std::vector<std::uint64_t> overlayOffsets;
+        };
+
+        SaveLayout plan() const
+        {
+            SaveLayout plan;
+            auto sectionAlignment = optionalField(layout::SectionAlignment);
+            auto fileAlignment = optionalField(layout::FileAlignment);
+            auto sizeOfHeaders = optionalField(layout::SizeOfHeaders);
+
+            plan.imageEnd = sizeOfHeaders;
+            for (auto &section : sections)
+                plan.imageEnd = std::max<size_t>(plan.imageEnd, section.pointerToRawData + section.sizeOfRawData);
+
+            // An asset bundle appended by an earlier run ends the file with its footer; it is replaced by this run's
+            // overlay, or dropped when the assets now go into the resource section.
+            plan.overlayEnd = file.size();
+            format::OverlayFooter footer;
+            if (file.size() >= plan.imageEnd + sizeof(footer))
+            {
+                std::memcpy(&footer, file.data() + file.size() - sizeof(footer), sizeof(footer));
+                if (std::memcmp(footer.magic, format::OverlayMagic, sizeof(footer.magic)) == 0 &&
+                    footer.offset >= plan.imageEnd && footer.offset <= file.size() - sizeof(footer))
+                    plan.overlayEnd = footer.offset;
+            }
+
+            // The certificate table lives in the overlay and is invalidated by any change, drop it.
+            auto security = dataDirectory(layout::SecurityDirectory);
+            if (security.virtualAddress >= plan.imageEnd && security.virtualAddress < plan.overlayEnd)
+                plan.overlayEnd = security.virtualAddress;
+
+            plan.appendOnly = !resourcesChanged && plan.overlayEnd == file.size();
+            if (plan.appendOnly)
+            {
+                plan.end = file.size();
+            }
+            else
+            {
+                const auto &last = sections.back();
+                auto resourceDir = dataDirectory(layout::ResourceDirectory);
+                bool reuseLast = resourceDir.virtualAddress != 0 && resourceDir.virtualAddress == last.virtualAddress &&
+                                 last.pointerToRawData + last.sizeOfRawData == plan.imageEnd;
+
+                plan.targetIndex = sections.size();
+                plan.prefixEnd = plan.imageEnd;
+                if (reuseLast)
+                {
+                    plan.target = last;
+                    plan.targetIndex = sections.size() - 1;
+                    plan.prefixEnd = last.pointerToRawData;
+                    plan.previousRawSize = last.sizeOfRawData;
+                }
+                else
+                {
+                    size_t headerSlot = sectionTableOffset + sections.size() * sizeof(SectionHeader);
+                    size_t firstRaw = sizeOfHeaders;
+                    for (auto &section : sections)
+                        if (section.pointerToRawData)
+                            firstRaw = std::min<size_t>(firstRaw, section.pointerToRawData);
+                    bool slotFree = headerSlot + sizeof(SectionHeader) <= firstRaw &&
+                                    std::all_of(file.begin() + headerSlot, file.begin() + headerSlot + sizeof(SectionHeader),
+                                                [](std::byte b)
+                                                { return b == std::byte{0}; });
+                    if (!slotFree)
+                        utils::Fail("No room for an additional section header.");
+
+                    std::memcpy(plan.target.name, ".rsrc", 5);
+                    plan.target.virtualAddress = utils::AlignUp(last.virtualAddress + std::max(last.virtualSize, last.sizeOfRawData), sectionAlignment);
+                    plan.target.pointerToRawData = static_cast<std::uint32_t>(utils::AlignUp<size_t>(plan.imageEnd, fileAlignment));
+                    plan.target.characteristics = layout::ResourceSectionFlags;
+                }
+
+                plan.section = buildResourceSection(plan.target.virtualAddress);
+                plan.target.virtualSize = static_cast<std::uint32_t>(plan.section.size);
+                plan.target.sizeOfRawData = utils::AlignUp(plan.target.virtualSize, fileAlignment);
+                plan.end = plan.target.pointerToRawData + plan.target.sizeOfRawData + (plan.overlayEnd - plan.imageEnd);
+            }
+
+            for (auto &overlay : overlays)
+            {
+                plan.end = utils::AlignUp<size_t>(plan.end, overlay.alignment);
+                plan.overlayOffsets.push_back(plan.end);
+                plan.end += overlay.data.size();
+            }
+            return plan;
+        }
+
+        std::vector<std::byte> patchedHeaders(const SaveLayout &plan) const
+        {
+            auto sectionAlignment = optionalField(layout::SectionAlignment);
+            auto sizeOfHeaders = optionalField(layout::SizeOfHeaders);
+            const auto &target = plan.target;
+
+            std::vector<std::byte> headers(file.begin(), file.begin() + sizeOfHeaders);
+            write(headers, sectionTableOffset + plan.targetIndex * sizeof(SectionHeader), target);
+            write(headers, fileHeaderOffset + offsetof(FileHeader, numberOfSections),
+                  static_cast<std::uint16_t>(std::max(sections.size(), plan.targetIndex + 1)));
+            write(headers, optionalHeaderOffset + layout::SizeOfImage, utils::AlignUp(target.virtualAddress + target.virtualSize, sectionAlignment));
+            write(headers, optionalHeaderOffset + layout::SizeOfInitializedData,
+                  optionalField(layout::SizeOfInitializedData) - plan.previousRawSize + target.sizeOfRawData);
+            write(headers, optionalHeaderOffset + layout::CheckSum, std::uint32_t{0}); // summed as zero, patched after writing
+            write(headers, dataDirectoryOffset + layout::ResourceDirectory * sizeof(DataDirectory),
+                  DataDirectory{target.virtualAddress, target.virtualSize});
+            if (plan.overlayEnd != file.size())
+                write(headers, dataDirectoryOffset + layout::SecurityDirectory * sizeof(DataDirectory), DataDirectory{0, 0});
+            return headers;
+        }
+
+    public:
+        // Data placed after the last section, e.g. a payload the runtime maps by file offset.
+        void appendOverlay(ResourceData data, std::uint32_t alignment = 1)
+        {
+            overlays.push_back({std::move(data), alignment});
+        }
+
+        // File offsets at which save() will place the appended overlays.
+        std::vector<std::uint64_t> overlayOffsets() const
+        {
+            return plan().overlayOffsets;
+        }
+
+        // Writes the image with a rebuilt resource section. The existing .rsrc is rewritten in place when it
+        // is the last section, otherwise a new section is appended and the old one is left unreferenced.
+        // When only overlays were added and the output is the input file itself, they are simply appended.
+        // The input file is mapped while writing; when the output replaces it, the mapping is released
+        // before the rename and the image must not be used afterwards.
+        void save(const std::filesystem::path &outputPath)
+        {
+            SaveLayout plan;
+            {
+                trace::Scope scope("resourceBuild");
+                plan = this->plan();
+                scope.bytesOut(plan.section.size);
+            }
+            std::error_code ec;
+            bool inPlace = !sourcePath.empty() && std::filesystem::equivalent(sourcePath, outputPath, ec);
+            bool appendInPlace = plan.appendOnly && inPlace;
+            auto writePath = outputPath;
+            if (!appendInPlace)
+                writePath += ".tmp";
+            utils::RemoveOnFailure cleanup(appendInPlace ? std::filesystem::path() : writePath);
+            {
+                trace::Scope scope("write");
+                OutputFile out(writePath, appendInPlace);
+                auto start = out.position();
+                // every byte is summed into the CheckSum on its way out, which is patched into the headers last
+                Checksum checksum;
+                auto checksumOffset = optionalHeaderOffset + layout::CheckSum;
+                auto sum = [&](std::uint64_t offset, std::span<const std::byte> bytes, bool evict)
+                {
+                    constexpr size_t slice = 16 << 20;
+                    for (size_t at = 0; at < bytes.size(); at += slice)
+                    {
+                        auto part = bytes.subspan(at, std::min(slice, bytes.size() - at));
+                        checksum.add(offset + at, part);
+                        if (evict)
+                            MappedFile::Evict(part);
+                    }
+                };
+                auto put = [&](std::span<const std::byte> bytes)
+                {
+                    checksum.add(out.position(), bytes);
+                    out.write(bytes);
+                };
+                // ranges of the input are copied by the kernel, everything else is written from memory
+                auto putInput = [&](size_t offset, size_t length)
+                {
+                    auto bytes = file.subspan(offset, length);
+                    sum(out.position(), bytes, fileMapped);
+                    if (offset <= checksumOffset && checksumOffset < offset + length)
+                        checksum.remove(checksumOffset, file.subspan(checksumOffset, sizeof(std::uint32_t)));
+                    if (fileSource)
+                        out.copy(*fileSource, bytes);
+                    else
+                        out.write(bytes, fileMapped);
+                };
+                auto putData = [&](const ResourceData &data)
+                {
+                    for (size_t i = 0; i < data.parts.size(); ++i)
+                    {
+                        sum(out.position(), data.parts[i], data.mapped);
+                        if (i < data.sources.size() && data.sources[i])
+                            out.copy(*data.sources[i], data.parts[i]);
+                        else
+                            out.write(data.parts[i], data.mapped);
+                    }
+                };
+
+                if (plan.appendOnly)
+                {
+                    if (appendInPlace)
+                    {
+                        // the kept file is not rewritten but still counts towards the sum
+                        sum(0, file, fileMapped);
+                        checksum.remove(checksumOffset, file.subspan(checksumOffset, sizeof(std::uint32_t)));
+                    }
+                    else
+                    {
+                        putInput(0, file.size());
+                    }
+                }
+                else
+                {
+                    auto sizeOfHeaders = optionalField(layout::SizeOfHeaders);
+                    const auto &target = plan.target;
+                    put(patchedHeaders(plan));
+                    putInput(sizeOfHeaders, plan.prefixEnd - sizeOfHeaders);
+                    out.padTo(target.pointerToRawData);
+                    put(plan.section.directory);
+                    for (auto &[offset, data] : plan.section.data)
+                    {
+                        out.padTo(target.pointerToRawData + offset);
+                        putData(data);
+                    }
+                    out.padTo(target.pointerToRawData + target.sizeOfRawData);
+                    if (plan.overlayEnd > plan.imageEnd)
+                        putInput(plan.imageEnd, plan.overlayEnd - plan.imageEnd);
+                }
+                for (size_t i = 0; i < overlays.size(); ++i)
+                {
+                    out.padTo(plan.overlayOffsets[i]);
+                    putData(overlays[i].data);
+                }
+
+                auto value = checksum.value(out.position());
+                out.writeAt(checksumOffset, std::as_bytes(std::span(&value, 1)));
+
+                {
+                    trace::Scope sync("fsync");
+                    if (!out.sync())
+                        trace::Warn("Could not flush " + utils::PathText(writePath) + " to disk.");
+                }
+                out.close();
+                scope.bytesOut(out.position() - start);
+                trace::Count("output.rangeCopiedBytes", out.copiedBytes());
+            }
+            if (appendInPlace)
+                return;
+
+            if (inPlace)
+            {
+                plan.section.data.clear();
+                tree.clear();
+                file = {};
+                fileSource = nullptr;
+                fileOwner.reset();
+            }
+            trace::Scope scope("rename");
+            std::filesystem::rename(writePath, outputPath, ec);
+            if (ec)
+                utils::Fail("Failed to replace output file.");
+            cleanup.release();
+        }
+    };
+}
@@ -0,0 +1,322 @@
+#pragma once
+
+#include "platform.hpp"
+#include "utils.hpp"
+#include "pe_image.hpp"
+#include "mapped_file.hpp"
+#include "asset_format.hpp"
+#include "hash.hpp"
+#include "asset_bundle.hpp"
+#include "version_info.hpp"
+#include "trace.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#pragma pack(push, 1)
+struct ICONDIR
+{
+    WORD idReserved;
+    WORD idType;
+    WORD idCount;
+};
+
+struct ICONDIRENTRY
+{
+    BYTE bWidth;
+    BYTE bHeight;
+    BYTE bColorCount;
+    BYTE bReserved;
+    WORD wPlanes;
+    WORD wBitCount;
+    DWORD dwBytesInRes;
+    DWORD dwImageOffset;
+};
+
+struct GRPICONDIRENTRY
+{
+    BYTE bWidth;
+    BYTE bHeight;
+    BYTE bColorCount;
+    BYTE bReserved;
+    WORD wPlanes;
+    WORD wBitCount;
+    DWORD dwBytesInRes;
+    WORD nID;
+};
+
+struct VersionInfo
+{
+    std::u16string companyName;
+    std::u16string fileDescription;
+    std::u16string fileVersion;
+    std::u16string productName;
+    std::u16string productVersion;
+    WORD fileVersionParts[4];
+    WORD productVersionParts[4];
+    std::vector<WORD> languages;                                           // one string table each, en-US when empty
+    std::vector<std::tuple<WORD, std::u16string, std::u16string>> strings; // extra keys, language 0 means every table
+};
+
+#pragma pack(pop)
+
+namespace ezi::builder::packager
+{
+    enum class AssetMode
+    {
+        Resource, // RT_RCDATA 1004
+        Overlay,  // appended after the last section, located through format::OverlayFooter
+    };
+
+    // The RT_VERSION resource for `info`: the fixed file info and one string table per language.
+    inline std::vector<std::byte> EncodeVersionInfo(const VersionInfo &info)
+    {
+        version::VersionResource resource;
+        auto &fixed = resource.fixed;
+        fixed.dwSignature = 0xFEEF04BD;
+        fixed.dwStrucVersion = 0x00010000;
+        fixed.dwFileVersionMS = (info.fileVersionParts[0] << 16) | info.fileVersionParts[1];
+        fixed.dwFileVersionLS = (info.fileVersionParts[2] << 16) | info.fileVersionParts[3];
+        fixed.dwProductVersionMS = (info.productVersionParts[0] << 16) | info.productVersionParts[1];
+        fixed.dwProductVersionLS = (info.productVersionParts[2] << 16) | info.productVersionParts[3];
+        fixed.dwFileFlagsMask = 0x3F;
+        fixed.dwFileFlags = 0;
+        fixed.dwFileOS = 0x40004; // VOS_NT_WINDOWS32
+        fixed.dwFileType = 0x1;   // VFT_APP
+        fixed.dwFileSubtype = 0;
+        fixed.dwFileDateMS = 0;
+        fixed.dwFileDateLS = 0;
+
+        auto languages = info.languages;
+        if (languages.empty())
+            languages.push_back(0x0409);
+        for (auto language : languages)
+        {
+            version::StringTable table;
+            table.language = language;
+            auto set = [&](const std::u16string &key, const std::u16string &value)
+            {
+                if (value.empty())
+                    return;
+                for (auto &entry : table.strings)
+                {
+                    if (entry.first == key)
+                    {
+                        entry.second = value;
+                        return;
+                    }
+                }
+                table.strings.emplace_back(key, value);
+            };
+            set(u"CompanyName", info.companyName);
+            set(u"FileDescription", info.fileDescription);
+            set(u"FileVersion", info.fileVersion);
+            set(u"ProductName", info.productName);
+            set(u"ProductVersion", info.productVersion);
+            // language-neutral extras first so that language specific ones win
+            for (auto &[stringLanguage, key, value] : info.strings)
+                if (stringLanguage == 0)
+                    set(key, value);
+            for (auto &[stringLanguage, key, value] : info.strings)
+                if (stringLanguage == language)
+                    set(key, value);
+            resource.tables.push_back(std::move(table));
+        }
+
+        return version::Encode(resource);
+    }
+
+    class ResourceUpdater
+    {
+    private:
+        std::filesystem::path exePath;
+        std::filesystem::path outputPath;
+        pe::Image image;
+        int updateCount = 0;
+        std::optional<format::OverlayFooter> overlayFooter;
+        bool verbose = true;
+
+        void log(const char *message)
+        {
+            if (verbose)
+                std::cout << message << std::endl;
+        }
+
+    public:
+        // Without an output path the input executable is updated in place.
+        ResourceUpdater(const std::filesystem::path &exePath, const std::filesystem::path &outputPath = {}, bool verbose = true)
+            : exePath(exePath), outputPath(outputPath.empty() ? exePath : outputPath), image(pe::Image::Load(exePath)), verbose(verbose)
+        {
+        }
+
+    private:
+        void updateResource(WORD resourceType, WORD resourceName, pe::ResourceData resource)
+        {
+            updateCount++;
+            image.setResource(resourceType, resourceName, 1033, std::move(resource));
+        }
+        void updateResource(WORD resourceType, WORD resourceName, std::vector<char> data)
+        {
+            auto owner = std::make_shared<std::vector<char>>(std::move(data));
+            updateResource(resourceType, resourceName, pe::ResourceData(std::as_bytes(std::span<const char>(*owner)), owner));
+        }
+        void updateResource(WORD resourceType, WORD resourceName, const std::shared_ptr<MappedFile> &file, std::span<const std::byte> bytes)
+        {
+            updateResource(resourceType, resourceName, pe::ResourceData(file, bytes));
+        }
+
+    public:
+        void finalize()
+        {
+            if (updateCount == 0)
+            {
+                log("No resources were updated.");
+                return;
+            }
+            if (overlayFooter)
+            {
+                // the asset is the first overlay, its offset is only known once all resources are in place
+                overlayFooter->offset = image.overlayOffsets().front();
+                auto footer = std::make_shared<format::OverlayFooter>(*overlayFooter);
+                image.appendOverlay(pe::ResourceData(std::as_bytes(std::span(footer.get(), 1)), footer));
+            }
+            image.save(outputPath);
+            std::error_code error;
+            trace::Recorder::Instance().output(utils::PathText(outputPath), std::filesystem::file_size(outputPath, error));
+            log("Resources updated successfully.");
+            if (verbose)
+                std::cout << "Peak memory: " << utils::PeakResidentBytes() / 1024 << "KB" << std::endl;
+        }
+        void updateAsset(const std::filesystem::path &filePath, AssetMode mode = AssetMode::Resource)
+        {
+            updateAsset(MappedFile::Open(filePath), mode);
+        }
+        void updateAsset(const std::shared_ptr<MappedFile> &file, AssetMode mode = AssetMode::Resource)
+        {
+            updateAsset(pe::ResourceData(file, file->bytes()), mode);
+        }
+        void updateAsset(const std::shared_ptr<AssetBundle> &bundle, AssetMode mode = AssetMode::Resource)
+        {
+            pe::ResourceData data;
+            data.parts = bundle->parts();
+            data.sources = bundle->sources();
+            data.owner = bundle;
+            // raw assets are page-aligned within the bundle, keep them page-aligned in the mapped image
+            data.alignment = format::OverlayAlignment;
+            std::optional<std::uint64_t> payloadHash;
+            if (mode == AssetMode::Overlay)
+                payloadHash = bundle->contentHash();
+            updateAsset(std::move(data), mode, payloadHash);
+        }
+        void updateAsset(pe::ResourceData payload, AssetMode mode, std::optional<std::uint64_t> payloadHash = std::nullopt)
+        {
+            log("Updating asset...");
+            trace::Count("assets", payload.size());
+            if (mode == AssetMode::Resource)
+            {
+                updateResource(10, 1004, std::move(payload));
+                return;
+            }
+
+            if (!payloadHash)
+            {
+                trace::Scope scope("hash", "phase", payload.size());
+                hash::Crc32c hasher;
+                constexpr size_t slice = 16 << 20;
+                for (auto &bytes : payload.parts)
+                {
+                    for (size_t at = 0; at < bytes.size(); at += slice)
+                    {
+                        auto part = bytes.subspan(at, std::min(slice, bytes.size() - at));
+                        hasher.update(part);
+                        if (payload.mapped)
+                            MappedFile::Evict(part);
+                    }
+                }
+                payloadHash = hasher.digest();
+            }
+
+            // a bundle embedded as a resource by an earlier run would only be dead weight next to the overlay
+            image.removeResource(10, 1004);
+
+            format::OverlayFooter footer = {};
+            std::memcpy(footer.magic, format::OverlayMagic, sizeof(footer.magic));
+            footer.version = format::OverlayVersion;
+            footer.hashAlgorithm = format::HashAlgorithm::Crc32c;
+            footer.length = payload.size();
+            footer.hash = *payloadHash;
+            overlayFooter = footer;
+
+            image.appendOverlay(std::move(payload), format::OverlayAlignment);
+            updateCount++;
+        }
+        void updateIcon(const std::filesystem::path &iconPath)
+        {
+            auto file = MappedFile::Open(iconPath);
+            updateIcon(file, file->bytes());
+        }
+        void updateIcon(const std::shared_ptr<const void> &owner, std::span<const std::byte> icoData)
+        {
+            log("Updating icon...");
+            if (icoData.size() < sizeof(ICONDIR))
+                utils::Fail("Invalid .ico file.");
+
+            const ICONDIR *iconDir = reinterpret_cast<const ICONDIR *>(icoData.data());
+            if (iconDir->idType != 1 || iconDir->idCount == 0)
+                utils::Fail("Not a valid icon file.");
+
+            struct GRPICONDIR
+            {
+                WORD idReserved;
+                WORD idType;
+                WORD idCount;
+            } grpDir = {0, 1, iconDir->idCount};
+
+            std::vector<char> groupData;
+            groupData.insert(groupData.end(), reinterpret_cast<char *>(&grpDir), reinterpret_cast<char *>(&grpDir) + sizeof(GRPICONDIR));
+
+            if (icoData.size() < sizeof(ICONDIR) + iconDir->idCount * sizeof(ICONDIRENTRY))
+                utils::Fail("Invalid .ico file.");
+
+            const ICONDIRENTRY *entries = reinterpret_cast<const ICONDIRENTRY *>(icoData.data() + sizeof(ICONDIR));
+            WORD iconBaseID = 1;
+            std::uint64_t iconBytes = 0;
+
+            for (int i = 0; i < iconDir->idCount; ++i)
+            {
+                const ICONDIRENTRY &entry = entries[i];
+                if (static_cast<size_t>(entry.dwImageOffset) + entry.dwBytesInRes > icoData.size())
+                    utils::Fail("Invalid .ico file.");
+
+                updateResource(3, iconBaseID + i, pe::ResourceData(icoData.subspan(entry.dwImageOffset, entry.dwBytesInRes), owner));
+                iconBytes += entry.dwBytesInRes;
+
+                GRPICONDIRENTRY grpEntry;
+
+                std::memcpy(&grpEntry, &entry, sizeof(GRPICONDIRENTRY) - sizeof(WORD));
+                grpEntry.nID = iconBaseID + i;
+
+                groupData.insert(groupData.end(), reinterpret_cast<char *>(&grpEntry), reinterpret_cast<char *>(&grpEntry) + sizeof(GRPICONDIRENTRY));
+            }
+
+            trace::Count("icon", iconBytes + groupData.size());
+            updateResource(14, 1, std::move(groupData));
+        }
+        void updateVersionInfo(const VersionInfo &info)
+        {
+            log("Updating version info...");
+            trace::Scope scope("versionInfo");
+            auto encoded = std::make_shared<std::vector<std::byte>>(EncodeVersionInfo(info));
+            scope.bytesOut(encoded->size());
+            trace::Count("versionInfo", encoded->size());
+            updateResource(16, 1, pe::ResourceData(*encoded, encoded));
+        }
+    };
+}
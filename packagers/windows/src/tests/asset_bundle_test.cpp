@@ -0,0 +1,329 @@
+// AssetBundle over generated asset trees and the pieces it is built from: the zstd seek table written after
+// chunked assets, a bundle whose large asset is split into chunks, each decoded on its own through the binary
+// index and compared with the same range of the source file, the choice of assets stored raw and their
+// page-aligned placement, and the same bytes whatever the number of threads.
+#include "../asset_bundle.hpp"
+#include "../asset_index.hpp"
+#include "../compressibility.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <zstd.h>
+
+namespace
+{
+    using namespace ezi::builder::packager;
+
+    int Failures = 0;
+
+#define CHECK(condition)                                                                    \
+    do                                                                                      \
+    {                                                                                       \
+        if (!(condition))                                                                   \
+        {                                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            ++Failures;                                                                     \
+        }                                                                                   \
+    } while (false)
+
+    // Incompressible bytes, the same for the same seed.
+    std::vector<std::byte> Noise(size_t size, std::uint64_t seed)
+    {
+        std::vector<std::byte> bytes(size);
+        for (auto &b : bytes)
+        {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            b = static_cast<std::byte>(seed >> 56);
+        }
+        return bytes;
+    }
+
+    // Compressible, but different in every chunk so a chunk decoded from the wrong frame shows.
+    std::vector<std::byte> Text(size_t size)
+    {
+        std::string text;
+        for (size_t line = 0; text.size() < size; ++line)
+            text += "asset line " + std::to_string(line) + " of the chunked test file\n";
+        text.resize(size);
+        auto bytes = std::as_bytes(std::span(text));
+        return std::vector<std::byte>(bytes.begin(), bytes.end());
+    }
+
+    void WriteFile(const std::filesystem::path &path, std::span<const std::byte> bytes)
+    {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(reinterpret_cast<const char *>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    std::vector<std::byte> Concatenate(const AssetBundle &bundle)
+    {
+        std::vector<std::byte> bytes;
+        for (auto part : bundle.parts())
+            bytes.insert(bytes.end(), part.begin(), part.end());
+        return bytes;
+    }
+
+    std::vector<std::byte> Decompress(std::span<const std::byte> frame, size_t rawSize)
+    {
+        std::vector<std::byte> raw(rawSize);
+        auto size = ZSTD_decompress(raw.data(), raw.size(), frame.data(), frame.size());
+        if (ZSTD_isError(size))
+            throw utils::PackagerError(std::string("Decompression failed: ") + ZSTD_getErrorName(size));
+        raw.resize(size);
+        return raw;
+    }
+
+    // Frames of a source followed by BuildSeekTable read back by ReadSeekTable; a plain decoder skips the table.
+    void SeekTable()
+    {
+        auto source = Text(100000);
+        std::vector<std::byte> stream;
+        std::vector<SeekTableEntry> entries;
+        for (size_t at = 0; at < source.size(); at += 30000)
+        {
+            auto chunk = std::span(source).subspan(at, std::min<size_t>(30000, source.size() - at));
+            auto frame = CompressFrame(chunk, 3);
+            stream.insert(stream.end(), frame.begin(), frame.end());
+            entries.push_back({static_cast<std::uint32_t>(frame.size()), static_cast<std::uint32_t>(chunk.size())});
+        }
+        auto frames = stream.size();
+        auto table = BuildSeekTable(entries);
+        stream.insert(stream.end(), table.begin(), table.end());
+
+        auto read = ReadSeekTable(stream);
+        CHECK(read.has_value());
+        if (read)
+        {
+            CHECK(read->size() == entries.size());
+            for (size_t i = 0; i < entries.size() && i < read->size(); ++i)
+                CHECK((*read)[i].compressedSize == entries[i].compressedSize && (*read)[i].decompressedSize == entries[i].decompressedSize);
+        }
+        CHECK(Decompress(stream, source.size() + 1) == source);
+
+        // an empty table, a table that does not add up to the stream, and streams without one
+        auto empty = BuildSeekTable({});
+        CHECK(ReadSeekTable(empty).has_value() && ReadSeekTable(empty)->empty());
+        std::vector<std::byte> shorter(stream.begin() + 1, stream.end());
+        CHECK(!ReadSeekTable(shorter));
+        CHECK(!ReadSeekTable(std::span(stream).first(frames)));
+        CHECK(!ReadSeekTable(std::span(stream).first(stream.size() - 1)));
+        CHECK(!ReadSeekTable({}));
+    }
+
+    // A file above the chunk threshold is stored as chunkSize frames and a seek table; each chunk decodes alone.
+    void Chunks(const std::filesystem::path &work)
+    {
+        constexpr std::uint32_t chunkSize = 16 << 10;
+        auto big = Text(200000); // 12 full chunks and a partial one
+        auto small = Text(1000);
+        WriteFile(work / "assets/big.txt", big);
+        WriteFile(work / "assets/small.txt", small);
+
+        AssetBundleOptions options;
+        options.assetDir = work / "assets";
+        options.config = "{}";
+        options.index = format::IndexKind::Binary;
+        options.chunkThreshold = 64 << 10;
+        options.chunkSize = chunkSize;
+        auto bundle = AssetBundle::Build(options);
+        auto bytes = Concatenate(*bundle);
+
+        auto reader = AssetIndexReader::Open(bytes);
+        CHECK(reader.has_value());
+        if (!reader)
+            return;
+        auto smallEntry = reader->find("https://com.ezi.app/small.txt");
+        CHECK(smallEntry && smallEntry->chunkSize == 0);
+        auto entry = reader->find("https://com.ezi.app/big.txt");
+        CHECK(entry != nullptr);
+        if (!entry)
+            return;
+        CHECK(entry->codec == format::Codec::Zstd && entry->chunkSize == chunkSize && entry->rawSize == big.size());
+        CHECK(reader->verify(*entry));
+
+        auto stored = reader->data(*entry);
+        auto table = ReadSeekTable(stored);
+        CHECK(table && table->size() == (big.size() + chunkSize - 1) / chunkSize);
+        if (!table)
+            return;
+        // the seek table agrees with the manifest's chunk list
+        for (auto &manifestEntry : bundle->manifest())
+        {
+            if (manifestEntry.id != "https://com.ezi.app/big.txt")
+                continue;
+            CHECK(manifestEntry.chunks.size() == table->size());
+            for (size_t k = 0; k < table->size() && k < manifestEntry.chunks.size(); ++k)
+                CHECK(manifestEntry.chunks[k] == (*table)[k].compressedSize);
+        }
+
+        std::uint64_t offset = 0;
+        for (size_t k = 0; k < table->size(); ++k)
+        {
+            auto &chunk = (*table)[k];
+            auto raw = Decompress(stored.subspan(offset, chunk.compressedSize), chunk.decompressedSize);
+            auto expected = std::span(big).subspan(k * chunkSize, std::min<size_t>(chunkSize, big.size() - k * chunkSize));
+            CHECK(raw.size() == expected.size() && std::equal(raw.begin(), raw.end(), expected.begin()));
+            offset += chunk.compressedSize;
+        }
+    }
+
+    // The bytes of `data` behind a PNG signature and IHDR chunk, as a deflated image or one saved without deflate.
+    std::vector<std::byte> Png(std::span<const std::byte> data)
+    {
+        std::string_view header("\x89PNG\r\n\x1a\n\0\0\0\x0dIHDR\0\0\x01\0\0\0\x01\0\x08\x06\0\0\0\0\0\0\0", 33);
+        auto bytes = std::as_bytes(std::span(header));
+        std::vector<std::byte> png(bytes.begin(), bytes.end());
+        png.insert(png.end(), data.begin(), data.end());
+        return png;
+    }
+
+    // The entropy gate, relaxed for known containers, and the zstd trial that catches repeats it cannot see.
+    void Compressibility()
+    {
+        auto noise = Noise(256 << 10, 4);
+        CHECK(SampledEntropy(noise) > IncompressibleEntropy);
+        CHECK(IsIncompressible(noise));
+        CHECK(!IsIncompressible(std::span(noise).first(RawDetectionMinSize - 1)));
+
+        auto png = Png(noise);
+        CHECK(CompressedFormat(png) == "png");
+        CHECK(IsIncompressible(png));
+        auto text = Text(256 << 10);
+        CHECK(CompressedFormat(text).empty());
+        CHECK(SampledEntropy(text) < CompressedFormatEntropy);
+        CHECK(!IsIncompressible(text));
+        CHECK(!IsIncompressible(Png(text)));
+
+        // a random 4 KB tile repeated: random byte by byte, so only the trial compression rules it out
+        std::vector<std::byte> tiled;
+        for (int i = 0; i < 64; ++i)
+            tiled.insert(tiled.end(), noise.begin(), noise.begin() + 4096);
+        CHECK(SampledEntropy(tiled) > IncompressibleEntropy);
+        CHECK(SampleCompresses(tiled));
+        CHECK(!IsIncompressible(tiled));
+        CHECK(!IsIncompressible(Png(tiled)));
+    }
+
+    // With storeRaw, incompressible assets of a page or more are stored as is on page boundaries of the bundle.
+    void RawAlignment(const std::filesystem::path &work)
+    {
+        struct Asset
+        {
+            std::string name;
+            std::vector<std::byte> bytes;
+            format::Codec codec;
+        };
+        std::vector<Asset> assets = {{"a.bin", Noise(10000, 5), format::Codec::Raw},
+                                     {"b.txt", Text(20000), format::Codec::Zstd},
+                                     {"c.png", Png(Noise(5000, 6)), format::Codec::Raw},
+                                     {"d.bin", Noise(3000, 7), format::Codec::Zstd},
+                                     {"e.bin", Noise(70000, 8), format::Codec::Raw}};
+        for (auto &asset : assets)
+            WriteFile(work / "assets" / asset.name, asset.bytes);
+
+        AssetBundleOptions options;
+        options.assetDir = work / "assets";
+        options.config = "{}";
+        options.storeRaw = true;
+        auto bundle = AssetBundle::Build(options);
+        auto bytes = Concatenate(*bundle);
+        CHECK(bytes.size() == bundle->size());
+        for (auto &asset : assets)
+        {
+            const AssetBundle::Entry *entry = nullptr;
+            for (auto &candidate : bundle->manifest())
+                if (candidate.id == "https://com.ezi.app/" + asset.name)
+                    entry = &candidate;
+            CHECK(entry && entry->codec == asset.codec);
+            if (!entry || entry->codec != format::Codec::Raw)
+                continue;
+            CHECK(entry->offset % format::OverlayAlignment == 0);
+            CHECK(entry->size == asset.bytes.size() && entry->rawSize == asset.bytes.size());
+            CHECK(entry->offset + entry->size <= bytes.size() &&
+                  std::equal(asset.bytes.begin(), asset.bytes.end(), bytes.begin() + entry->offset));
+        }
+    }
+
+    // Every build step at once: duplicates, a trained dictionary, chunks, raw assets, an access profile with a
+    // startup block and the binary index. One thread and eight must write the same bundle.
+    void Threads(const std::filesystem::path &work)
+    {
+        auto dir = work / "assets";
+        for (int i = 0; i < 200; ++i)
+        {
+            std::string text = "{\"component\": " + std::to_string(i) + ", \"name\": \"widget-" + std::to_string(i * 7919 % 1000) + "\"}\n";
+            for (int line = 0; line < 20 + i % 30; ++line)
+                text += "  .widget-" + std::to_string(i) + " .row-" + std::to_string(line) + " { margin: " + std::to_string(line % 8) + "px; }\n";
+            auto bytes = std::as_bytes(std::span(text));
+            WriteFile(dir / ("ui/part" + std::to_string(i / 50)) / ("widget" + std::to_string(i) + ".css"), bytes);
+            if (i % 40 == 0)
+                WriteFile(dir / "copies" / ("widget" + std::to_string(i) + ".css"), bytes);
+        }
+        WriteFile(dir / "media/big.txt", Text(300000));
+        for (int i = 0; i < 6; ++i)
+            WriteFile(dir / "media" / ("noise" + std::to_string(i) + ".bin"), Noise(5000 + i * 3000, 10 + i));
+
+        AssetBundleOptions options;
+        options.assetDir = dir;
+        options.config = "{\"application\": {\"name\": \"threads\"}}";
+        options.index = format::IndexKind::Binary;
+        options.trainDictionary = true;
+        options.storeRaw = true;
+        options.chunkThreshold = 64 << 10;
+        options.chunkSize = 16 << 10;
+        options.accessProfile = {"https://com.ezi.app/ui/part3/widget150.css", "https://com.ezi.app/media/noise2.bin",
+                                 "https://com.ezi.app/ui/part0/widget3.css", "https://com.ezi.app/ui/part1/widget60.css"};
+        options.accessBlockSize = 4 << 10;
+
+        options.threads = 1;
+        auto one = Concatenate(*AssetBundle::Build(options));
+        options.threads = 8;
+        auto eight = Concatenate(*AssetBundle::Build(options));
+        CHECK(one.size() == eight.size());
+        CHECK(one == eight);
+        CHECK(AssetIndexReader::Open(one).has_value());
+    }
+}
+
+int main()
+{
+    auto work = std::filesystem::temp_directory_path() / "eziapp-packager-bundle-tests";
+    auto run = [&](auto test)
+    {
+        std::filesystem::remove_all(work);
+        std::filesystem::create_directories(work);
+        try
+        {
+            test();
+        }
+        catch (const std::exception &error)
+        {
+            std::cerr << error.what() << std::endl;
+            ++Failures;
+        }
+    };
+    run([&] { SeekTable(); });
+    run([&] { Chunks(work); });
+    run([&] { Compressibility(); });
+    run([&] { RawAlignment(work); });
+    run([&] { Threads(work); });
+    std::filesystem::remove_all(work);
+
+    if (Failures)
+    {
+        std::cerr << Failures << " check(s) failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "All asset bundle checks passed." << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,191 @@
+// Round trip of delta::Create and delta::Apply between two packaged versions of the pe32_rsrc fixture: the new
+// executable rebuilt from the old one and the patch must match it byte for byte, with the default memory budget
+// and with one small enough to refuse every asset diff and split the core into several reference windows.
+#include "../packager.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+    using namespace ezi::builder::packager;
+
+    int Failures = 0;
+    std::string Case;
+
+#define CHECK(condition)                                                                \
+    do                                                                                  \
+    {                                                                                   \
+        if (!(condition))                                                               \
+        {                                                                               \
+            std::cerr << Case << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            ++Failures;                                                                 \
+        }                                                                               \
+    } while (false)
+
+    std::vector<char> ReadFile(const std::filesystem::path &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(in), {});
+    }
+
+    void WriteFile(const std::filesystem::path &path, const std::vector<char> &bytes)
+    {
+        std::filesystem::create_directories(path.parent_path());
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+    }
+
+    // Incompressible bytes, the same for the same seed.
+    std::vector<char> Noise(size_t size, std::uint64_t seed)
+    {
+        std::vector<char> bytes(size);
+        for (auto &b : bytes)
+        {
+            seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+            b = static_cast<char>(seed >> 56);
+        }
+        return bytes;
+    }
+
+    std::vector<char> Text(size_t lines, const std::string &word)
+    {
+        std::string text;
+        for (size_t i = 0; i < lines; ++i)
+            text += "line " + std::to_string(i) + ": " + word + "\n";
+        return std::vector<char>(text.begin(), text.end());
+    }
+
+    // Edits a few spots of `bytes`, as a rebuilt asset would differ from its previous version.
+    std::vector<char> Edited(std::vector<char> bytes)
+    {
+        for (size_t at = 100; at < bytes.size(); at += bytes.size() / 5)
+            for (size_t i = at; i < at + 16 && i < bytes.size(); ++i)
+                bytes[i] = static_cast<char>(~bytes[i]);
+        return bytes;
+    }
+
+    void Package(const std::filesystem::path &input, const std::filesystem::path &output, std::vector<std::string> assetArgs)
+    {
+        std::vector<std::string> args = {"--input", input.string(), "--output", output.string()};
+        args.insert(args.end(), assetArgs.begin(), assetArgs.end());
+        AgrumentParser parser(std::move(args), PackagerOptions);
+        CHECK(Run(parser) == 0);
+    }
+
+    // Patches `from` into `to` under each memory budget and rebuilds `to` from the patch.
+    void RoundTrip(const std::filesystem::path &from, const std::filesystem::path &to, const std::filesystem::path &work)
+    {
+        auto expected = ReadFile(to);
+        auto patch = work / "patch.bin";
+        auto rebuilt = work / "rebuilt.exe";
+        for (std::uint64_t budget : {delta::Options{}.memoryBudget, std::uint64_t{64} << 10})
+        {
+            delta::Options options;
+            options.memoryBudget = budget;
+            auto stats = delta::Create(from.string(), to.string(), patch.string(), options);
+            CHECK(stats.newSize == expected.size());
+            CHECK(stats.patchSize == std::filesystem::file_size(patch));
+            CHECK(stats.patchSize < expected.size());
+            std::filesystem::remove(rebuilt);
+            delta::Apply(from.string(), patch.string(), rebuilt.string());
+            CHECK(ReadFile(rebuilt) == expected);
+        }
+
+        // the patch only applies to the file it was made from
+        bool refused = false;
+        try
+        {
+            delta::Apply(to.string(), patch.string(), rebuilt.string());
+        }
+        catch (const utils::PackagerError &)
+        {
+            refused = true;
+        }
+        CHECK(refused);
+    }
+
+    void AssetDirectory(const std::filesystem::path &fixture, const std::filesystem::path &work, const std::string &mode)
+    {
+        Case = "asset dir, " + mode;
+        auto config = work / "ezi.json";
+        WriteFile(config, std::vector<char>{'{', '}'});
+        // unchanged, edited, removed and added assets between the two versions
+        auto v1 = work / "v1";
+        auto v2 = work / "v2";
+        auto noise = Noise(300 << 10, 1);
+        auto text = Text(20000, "first");
+        WriteFile(v1 / "same.bin", noise);
+        WriteFile(v2 / "same.bin", noise);
+        WriteFile(v1 / "text/readme.txt", text);
+        WriteFile(v2 / "text/readme.txt", Edited(text));
+        WriteFile(v1 / "data/edited.bin", Noise(200 << 10, 2));
+        WriteFile(v2 / "data/edited.bin", Edited(Noise(200 << 10, 2)));
+        WriteFile(v1 / "old.txt", Text(500, "removed"));
+        WriteFile(v2 / "new.txt", Text(500, "added"));
+
+        auto from = work / "v1.exe";
+        auto to = work / "v2.exe";
+        for (auto [assets, output] : {std::pair{v1, from}, std::pair{v2, to}})
+            Package(fixture, output, {"--ezi-asset-dir", assets.string(), "--ezi-config", config.string(), "--asset-mode", mode});
+        RoundTrip(from, to, work);
+    }
+
+    // A single asset file carries no bundle index, so the whole executable is diffed as core.
+    void SingleAsset(const std::filesystem::path &fixture, const std::filesystem::path &work)
+    {
+        Case = "asset file";
+        auto asset = work / "asset.bin";
+        auto from = work / "v1.exe";
+        auto to = work / "v2.exe";
+        WriteFile(asset, Noise(1 << 20, 3));
+        Package(fixture, from, {"--ezi-asset", asset.string(), "--asset-mode", "overlay"});
+        WriteFile(asset, Edited(Noise(1 << 20, 3)));
+        Package(fixture, to, {"--ezi-asset", asset.string(), "--asset-mode", "overlay"});
+        RoundTrip(from, to, work);
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: eziapp-packager-delta-tests <fixtures dir>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    auto fixture = std::filesystem::path(argv[1]) / "pe32_rsrc.exe";
+    auto work = std::filesystem::temp_directory_path() / "eziapp-packager-delta-tests";
+
+    auto run = [&](auto test)
+    {
+        std::filesystem::remove_all(work);
+        std::filesystem::create_directories(work);
+        try
+        {
+            test();
+        }
+        catch (const std::exception &error)
+        {
+            std::cerr << Case << ": " << error.what() << std::endl;
+            ++Failures;
+        }
+    };
+    run([&] { AssetDirectory(fixture, work, "overlay"); });
+    run([&] { AssetDirectory(fixture, work, "resource"); });
+    run([&] { SingleAsset(fixture, work); });
+    std::filesystem::remove_all(work);
+
+    if (Failures)
+    {
+        std::cerr << Failures << " check(s) failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "All delta round trips passed." << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,206 @@
+// Writes the PE fixtures of the packager tests: node make_fixtures.js
+// Each image has one .text section and, when named *_rsrc, a resource section holding a named and an id
+// resource; *_signed images end with a certificate table. Headers leave room for one more section header
+// and CheckSum is valid, as the packager expects of linker output.
+const fs = require('fs');
+const path = require('path');
+
+const FileAlignment = 0x200;
+const SectionAlignment = 0x1000;
+const HeadersSize = 0x200;
+
+const align = (value, alignment) => Math.ceil(value / alignment) * alignment;
+
+// Same layout as pe::Image writes: directory tables, data entries, name strings, then 8-byte aligned data.
+function resourceSection(rva, tree) {
+    const order = (entries) => [...entries].sort(([a], [b]) =>
+        (typeof a === 'string') !== (typeof b === 'string') ? (typeof a === 'string' ? -1 : 1) : a < b ? -1 : a > b ? 1 : 0);
+    const types = order(Object.entries(tree).map(([k, v]) => [isNaN(k) ? k : Number(k), v]));
+    const table = (count) => 16 + count * 8;
+
+    let tablesSize = table(types.length);
+    const names = [];
+    const strings = new Map();
+    let stringsSize = 0;
+    const addString = (id) => {
+        if (typeof id === 'string' && !strings.has(id)) {
+            strings.set(id, stringsSize);
+            stringsSize += 2 + id.length * 2;
+        }
+    };
+    let leaves = 0;
+    for (const [type, byName] of types) {
+        addString(type);
+        const entries = order(Object.entries(byName).map(([k, v]) => [isNaN(k) ? k : Number(k), v]));
+        names.push(entries);
+        tablesSize += table(entries.length);
+        for (const [name, languages] of entries) {
+            addString(name);
+            tablesSize += table(Object.keys(languages).length);
+            leaves += Object.keys(languages).length;
+        }
+    }
+    const entriesOffset = tablesSize;
+    const stringsOffset = entriesOffset + leaves * 16;
+    let cursor = align(stringsOffset + stringsSize, 8);
+    let size = cursor;
+    for (const byName of names)
+        for (const [, languages] of byName)
+            for (const data of Object.values(languages))
+                size = align(size, 8) + data.length;
+    const out = Buffer.alloc(size);
+
+    for (const [text, offset] of strings) {
+        out.writeUInt16LE(text.length, stringsOffset + offset);
+        out.write(text, stringsOffset + offset + 2, 'utf16le');
+    }
+    const entryName = (id) => typeof id === 'string' ? (0x80000000 | (stringsOffset + strings.get(id))) >>> 0 : id;
+    const writeTable = (at, keys) => {
+        const named = keys.filter((k) => typeof k === 'string').length;
+        out.writeUInt16LE(named, at + 12);
+        out.writeUInt16LE(keys.length - named, at + 14);
+    };
+
+    let nextTable = table(types.length);
+    let nextNameTable = nextTable + names.reduce((sum, byName) => sum + table(byName.length), 0);
+    let nextEntry = entriesOffset;
+    writeTable(0, types.map(([type]) => type));
+    types.forEach(([type], t) => {
+        const typeTable = nextTable;
+        nextTable += table(names[t].length);
+        out.writeUInt32LE(entryName(type), 16 + t * 8);
+        out.writeUInt32LE((0x80000000 | typeTable) >>> 0, 16 + t * 8 + 4);
+        writeTable(typeTable, names[t].map(([name]) => name));
+        names[t].forEach(([name, languages], n) => {
+            const nameTable = nextNameTable;
+            const langs = Object.keys(languages).map(Number).sort((a, b) => a - b);
+            nextNameTable += table(langs.length);
+            out.writeUInt32LE(entryName(name), typeTable + 16 + n * 8);
+            out.writeUInt32LE((0x80000000 | nameTable) >>> 0, typeTable + 16 + n * 8 + 4);
+            writeTable(nameTable, langs);
+            langs.forEach((language, l) => {
+                const data = languages[language];
+                cursor = align(cursor, 8);
+                out.writeUInt32LE(language, nameTable + 16 + l * 8);
+                out.writeUInt32LE(nextEntry, nameTable + 16 + l * 8 + 4);
+                out.writeUInt32LE(rva + cursor, nextEntry);
+                out.writeUInt32LE(data.length, nextEntry + 4);
+                out.writeUInt32LE(1252, nextEntry + 8);
+                nextEntry += 16;
+                data.copy(out, cursor);
+                cursor += data.length;
+            });
+        });
+    });
+    return out;
+}
+
+// One's complement sum of the 16-bit words with the CheckSum field read as zero, plus the file size.
+function checksum(file, checksumOffset) {
+    let sum = 0;
+    for (let i = 0; i < file.length; i += 2) {
+        if (i === checksumOffset || i === checksumOffset + 2)
+            continue;
+        sum += i + 1 < file.length ? file.readUInt16LE(i) : file[i];
+        sum = (sum & 0xFFFF) + (sum >>> 16);
+    }
+    return ((sum & 0xFFFF) + file.length) >>> 0;
+}
+
+function image({ pe64, rsrc, signed }) {
+    const text = Buffer.alloc(0x10, 0xCC);
+    text[0] = 0xC3; // ret
+    const sections = [{ name: '.text', rva: SectionAlignment, data: text, characteristics: 0x60000020 }];
+    if (rsrc) {
+        const rva = 2 * SectionAlignment;
+        sections.push({
+            name: '.rsrc', rva, characteristics: 0x40000040,
+            data: resourceSection(rva, {
+                FIXTURE: { 1: { 0x0409: Buffer.from('fixture resource\0', 'utf8') } },
+                10: { DATA: { 0x0804: Buffer.from([...Array(37).keys()]) } },
+            }),
+        });
+    }
+
+    let raw = HeadersSize;
+    for (const section of sections) {
+        section.pointer = raw;
+        section.rawSize = align(section.data.length, FileAlignment);
+        raw += section.rawSize;
+    }
+    const certificateOffset = align(raw, 8);
+    const certificate = Buffer.alloc(signed ? 0x28 : 0);
+    if (signed) {
+        certificate.writeUInt32LE(certificate.length, 0); // dwLength
+        certificate.writeUInt16LE(0x0200, 4);             // WIN_CERT_REVISION_2_0
+        certificate.writeUInt16LE(0x0002, 6);             // WIN_CERT_TYPE_PKCS_SIGNED_DATA
+        certificate.fill(0x5A, 8);
+    }
+    const file = Buffer.alloc(signed ? certificateOffset + certificate.length : raw);
+
+    file.write('MZ', 0, 'latin1');
+    file.writeUInt32LE(0x40, 0x3C);
+    file.write('PE\0\0', 0x40, 'latin1');
+    const fileHeader = 0x44;
+    const optionalSize = pe64 ? 240 : 224;
+    file.writeUInt16LE(pe64 ? 0x8664 : 0x014C, fileHeader);
+    file.writeUInt16LE(sections.length, fileHeader + 2);
+    file.writeUInt16LE(optionalSize, fileHeader + 16);
+    file.writeUInt16LE(pe64 ? 0x0022 : 0x0102, fileHeader + 18);
+
+    const optional = fileHeader + 20;
+    const last = sections[sections.length - 1];
+    file.writeUInt16LE(pe64 ? 0x20B : 0x10B, optional);
+    file.writeUInt32LE(sections[0].rawSize, optional + 4);
+    file.writeUInt32LE(sections.slice(1).reduce((sum, s) => sum + s.rawSize, 0), optional + 8);
+    file.writeUInt32LE(sections[0].rva, optional + 16);
+    file.writeUInt32LE(sections[0].rva, optional + 20);
+    if (pe64)
+        file.writeBigUInt64LE(0x140000000n, optional + 24);
+    else
+        file.writeUInt32LE(0x400000, optional + 28);
+    file.writeUInt32LE(SectionAlignment, optional + 32);
+    file.writeUInt32LE(FileAlignment, optional + 36);
+    file.writeUInt16LE(6, optional + 40);
+    file.writeUInt16LE(6, optional + 48);
+    file.writeUInt32LE(align(last.rva + last.data.length, SectionAlignment), optional + 56);
+    file.writeUInt32LE(HeadersSize, optional + 60);
+    file.writeUInt16LE(3, optional + 68); // console subsystem
+    const directories = optional + (pe64 ? 112 : 96);
+    file.writeUInt32LE(16, directories - 4);
+    if (rsrc) {
+        file.writeUInt32LE(last.rva, directories + 2 * 8);
+        file.writeUInt32LE(last.data.length, directories + 2 * 8 + 4);
+    }
+    if (signed) {
+        file.writeUInt32LE(certificateOffset, directories + 4 * 8);
+        file.writeUInt32LE(certificate.length, directories + 4 * 8 + 4);
+    }
+
+    sections.forEach((section, i) => {
+        const at = optional + optionalSize + i * 40;
+        file.write(section.name, at, 'latin1');
+        file.writeUInt32LE(section.data.length, at + 8);
+        file.writeUInt32LE(section.rva, at + 12);
+        file.writeUInt32LE(section.rawSize, at + 16);
+        file.writeUInt32LE(section.pointer, at + 20);
+        file.writeUInt32LE(section.characteristics, at + 36);
+        section.data.copy(file, section.pointer);
+    });
+    certificate.copy(file, certificateOffset);
+
+    file.writeUInt32LE(checksum(file, optional + 64), optional + 64);
+    return file;
+}
+
+// checksums.json keeps each image's CheckSum as computed here, the reference pe::Checksum is tested against
+const checksums = {};
+for (const pe64 of [false, true])
+    for (const rsrc of [false, true])
+        for (const signed of [false, true]) {
+            const name = (pe64 ? 'pe32plus' : 'pe32') + (rsrc ? '_rsrc' : '') + (signed ? '_signed' : '') + '.exe';
+            const file = image({ pe64, rsrc, signed });
+            checksums[name] = file.readUInt32LE(file.readUInt32LE(0x3C) + 24 + 64);
+            fs.writeFileSync(path.join(__dirname, name), file);
+        }
+fs.writeFileSync(path.join(__dirname, 'checksums.json'), JSON.stringify(checksums, null, 4) + '\n');
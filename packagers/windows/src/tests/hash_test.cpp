@@ -0,0 +1,115 @@
+// Check values of hash::Crc32c and hash::Xxh64 against the reference implementations, the same digests when the
+// input is fed in pieces, and Crc32c::Combine against the CRC of the joined input.
+#include "../hash.hpp"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    using namespace ezi::builder::packager;
+
+    int Failures = 0;
+
+#define CHECK(condition)                                                                    \
+    do                                                                                      \
+    {                                                                                       \
+        if (!(condition))                                                                   \
+        {                                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            ++Failures;                                                                     \
+        }                                                                                   \
+    } while (false)
+
+    std::span<const std::byte> Bytes(std::string_view text)
+    {
+        return std::as_bytes(std::span(text));
+    }
+
+    // Long enough for the three-lane hardware CRC path, with a tail that is not a multiple of 8.
+    std::vector<std::byte> Pattern(size_t size)
+    {
+        std::vector<std::byte> bytes(size);
+        for (size_t i = 0; i < size; ++i)
+            bytes[i] = static_cast<std::byte>(i * 131 + (i >> 8));
+        return bytes;
+    }
+
+    // Expected values from the bitwise CRC-32C of RFC 3720 and from the xxHash library.
+    void CheckValues()
+    {
+        CHECK(hash::Crc32c::Of(Bytes("123456789")) == 0xE3069283);
+        CHECK(hash::Crc32c::Of({}) == 0);
+        std::vector<std::byte> zeros(32), ones(32, std::byte{0xFF});
+        CHECK(hash::Crc32c::Of(zeros) == 0x8A9136AA);
+        CHECK(hash::Crc32c::Of(ones) == 0x62A8AB43);
+        CHECK(hash::Crc32c::Of(Pattern(100)) == 0x51FEC4B1);
+        CHECK(hash::Crc32c::Of(Pattern(100000)) == 0x14902D71);
+
+        CHECK(hash::Xxh64::Of({}) == 0xEF46DB3751D8E999);
+        CHECK(hash::Xxh64::Of(Bytes("123456789")) == 0x8CB841DB40E6AE83);
+        CHECK(hash::Xxh64::Of(Bytes("123456789"), 1) == 0x1A4CC2C9E8079790);
+        CHECK(hash::Xxh64::Of(Pattern(100)) == 0xACD07A6400E07DEF);
+        CHECK(hash::Xxh64::Of(Pattern(100000)) == 0x5C6EA6691308E8AE);
+    }
+
+    // Pieces of every size class: single bytes, sizes around the 8-byte word and 32-byte stripe, and lanes.
+    void SplitStreams()
+    {
+        auto data = Pattern(100000);
+        std::span<const std::byte> all(data);
+        auto crc = hash::Crc32c::Of(all);
+        auto xxh = hash::Xxh64::Of(all);
+        for (size_t piece : {1, 3, 7, 8, 9, 31, 32, 33, 4095, 8192 * 3 + 5})
+        {
+            hash::Crc32c crcState;
+            hash::Xxh64 xxhState;
+            for (size_t at = 0; at < all.size(); at += piece)
+            {
+                auto part = all.subspan(at, std::min(piece, all.size() - at));
+                crcState.update(part);
+                xxhState.update(part);
+            }
+            CHECK(crcState.digest() == crc);
+            CHECK(xxhState.digest() == xxh);
+        }
+    }
+
+    void Combine()
+    {
+        auto data = Pattern(100000);
+        std::span<const std::byte> all(data);
+        auto crc = hash::Crc32c::Of(all);
+        for (size_t split : {size_t{0}, size_t{1}, size_t{8}, size_t{4097}, size_t{8192 * 3}, all.size() - 1, all.size()})
+        {
+            auto first = all.first(split);
+            auto second = all.subspan(split);
+            CHECK(hash::Crc32c::Combine(hash::Crc32c::Of(first), hash::Crc32c::Of(second), second.size()) == crc);
+        }
+
+        // three ranges joined left to right, as per-asset CRCs are joined into the payload's
+        auto a = all.first(1000), b = all.subspan(1000, 50000), c = all.subspan(51000);
+        auto ab = hash::Crc32c::Combine(hash::Crc32c::Of(a), hash::Crc32c::Of(b), b.size());
+        CHECK(hash::Crc32c::Combine(ab, hash::Crc32c::Of(c), c.size()) == crc);
+    }
+}
+
+int main()
+{
+    CheckValues();
+    SplitStreams();
+    Combine();
+
+    if (Failures)
+    {
+        std::cerr << Failures << " check(s) failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "All hash checks passed." << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,279 @@
+// Round trip of pe::Image over the fixtures written by fixtures/make_fixtures.js: parse, update the resources,
+// save, parse again, and check the resource tree, the dropped certificate table and the CheckSum. pe::Checksum
+// must give the CheckSum the fixture generator recorded in checksums.json, however the file is split up.
+// Truncated copies of the fixtures must be refused.
+#include "../json.hpp"
+#include "../pe_image.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <map>
+#include <memory>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace
+{
+    using namespace ezi::builder::packager;
+
+    int Failures = 0;
+    std::string Fixture;
+
+#define CHECK(condition)                                                                   \
+    do                                                                                     \
+    {                                                                                      \
+        if (!(condition))                                                                  \
+        {                                                                                  \
+            std::cerr << Fixture << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            ++Failures;                                                                    \
+        }                                                                                  \
+    } while (false)
+
+    std::vector<std::uint8_t> ReadFile(const std::filesystem::path &path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        return std::vector<std::uint8_t>(std::istreambuf_iterator<char>(in), {});
+    }
+
+    std::uint32_t Read32(const std::vector<std::uint8_t> &file, size_t offset)
+    {
+        return file[offset] | file[offset + 1] << 8 | file[offset + 2] << 16 | static_cast<std::uint32_t>(file[offset + 3]) << 24;
+    }
+
+    std::uint16_t Read16(const std::vector<std::uint8_t> &file, size_t offset)
+    {
+        return static_cast<std::uint16_t>(file[offset] | file[offset + 1] << 8);
+    }
+
+    struct Headers
+    {
+        size_t optional = 0;
+        size_t directories = 0;
+        std::uint16_t magic = 0;
+        std::uint16_t sections = 0;
+        size_t rawEnd = 0; // end of the last section's raw data
+    };
+
+    Headers ReadHeaders(const std::vector<std::uint8_t> &file)
+    {
+        Headers headers;
+        auto pe = Read32(file, 0x3C);
+        headers.sections = Read16(file, pe + 6);
+        headers.optional = pe + 24;
+        headers.magic = Read16(file, headers.optional);
+        headers.directories = headers.optional + (headers.magic == 0x20B ? 112 : 96);
+        auto table = headers.optional + Read16(file, pe + 20);
+        for (size_t i = 0; i < headers.sections; ++i)
+            headers.rawEnd = std::max<size_t>(headers.rawEnd, Read32(file, table + i * 40 + 20) + Read32(file, table + i * 40 + 16));
+        return headers;
+    }
+
+    // Word by word as the loader's CheckSumMappedFile does it, independent of pe::Checksum.
+    std::uint32_t ExpectedChecksum(const std::vector<std::uint8_t> &file, size_t field)
+    {
+        std::uint32_t sum = 0;
+        for (size_t i = 0; i < file.size(); i += 2)
+        {
+            if (i == field || i == field + 2)
+                continue;
+            sum += i + 1 < file.size() ? Read16(file, i) : file[i];
+            sum = (sum & 0xFFFF) + (sum >> 16);
+        }
+        return (sum & 0xFFFF) + static_cast<std::uint32_t>(file.size());
+    }
+
+    std::string Name(const pe::ResourceId &id)
+    {
+        return id.isNamed() ? std::string(id.name.begin(), id.name.end()) : std::to_string(id.id);
+    }
+
+    // type/name/language -> bytes
+    std::map<std::string, std::vector<std::uint8_t>> Flatten(const pe::ResourceTree &tree)
+    {
+        std::map<std::string, std::vector<std::uint8_t>> flat;
+        for (auto &[type, names] : tree)
+            for (auto &[name, languages] : names)
+                for (auto &[language, data] : languages)
+                {
+                    auto &bytes = flat[Name(type) + "/" + Name(name) + "/" + std::to_string(language)];
+                    for (auto &part : data.parts)
+                        for (auto b : part)
+                            bytes.push_back(static_cast<std::uint8_t>(b));
+                }
+        return flat;
+    }
+
+    pe::ResourceData Data(const std::vector<std::uint8_t> &bytes)
+    {
+        auto owner = std::make_shared<std::vector<std::uint8_t>>(bytes);
+        return pe::ResourceData(std::as_bytes(std::span(*owner)), owner);
+    }
+
+    std::vector<std::uint8_t> Bytes(size_t size, std::uint8_t seed)
+    {
+        std::vector<std::uint8_t> bytes(size);
+        for (size_t i = 0; i < size; ++i)
+            bytes[i] = static_cast<std::uint8_t>(seed + i * 7);
+        return bytes;
+    }
+
+    void CheckOutput(const std::filesystem::path &path, std::uint16_t magic)
+    {
+        auto file = ReadFile(path);
+        auto headers = ReadHeaders(file);
+        CHECK(headers.magic == magic);
+        CHECK(Read32(file, headers.optional + pe::layout::CheckSum) == ExpectedChecksum(file, headers.optional + pe::layout::CheckSum));
+        auto security = headers.directories + pe::layout::SecurityDirectory * 8;
+        CHECK(Read32(file, security) == 0 && Read32(file, security + 4) == 0);
+        CHECK(file.size() == headers.rawEnd);
+    }
+
+    void RoundTrip(const std::filesystem::path &fixture, const std::filesystem::path &work)
+    {
+        auto original = ReadFile(fixture);
+        auto originalHeaders = ReadHeaders(original);
+        bool hasResources = Read32(original, originalHeaders.directories + pe::layout::ResourceDirectory * 8) != 0;
+        CHECK(Read32(original, originalHeaders.optional + pe::layout::CheckSum) == ExpectedChecksum(original, originalHeaders.optional + pe::layout::CheckSum));
+        auto input = work / "input.exe";
+        auto output = work / "output.exe";
+        std::filesystem::copy_file(fixture, input, std::filesystem::copy_options::overwrite_existing);
+
+        auto expected = Flatten(pe::Image::Load(input).resources());
+        CHECK(expected.size() == (hasResources ? 2u : 0u));
+
+        // an id resource and a named one, next to what the image already holds
+        {
+            auto image = pe::Image::Load(input);
+            image.setResource(10, 1004, 1033, Data(Bytes(4099, 1)));
+            image.setResource(std::u16string(u"NAMED"), 2, 0x0804, Data(Bytes(3, 2)));
+            image.save(output);
+        }
+        expected["10/1004/1033"] = Bytes(4099, 1);
+        expected["NAMED/2/2052"] = Bytes(3, 2);
+        CHECK(Flatten(pe::Image::Load(output).resources()) == expected);
+        CheckOutput(output, originalHeaders.magic);
+        // an existing .rsrc at the end is rewritten in place, otherwise a section is added
+        CHECK(ReadHeaders(ReadFile(output)).sections == originalHeaders.sections + (hasResources ? 0 : 1));
+        CHECK(ReadFile(input) == original);
+
+        // in place: the output replaces the file it was read from, resources shrink and go away
+        {
+            auto image = pe::Image::Load(output);
+            image.setResource(10, 1004, 1033, Data(Bytes(17, 3)));
+            CHECK(image.removeResource(std::u16string(u"named"), 2));
+            image.save(output);
+        }
+        expected["10/1004/1033"] = Bytes(17, 3);
+        expected.erase("NAMED/2/2052");
+        CHECK(Flatten(pe::Image::Load(output).resources()) == expected);
+        CheckOutput(output, originalHeaders.magic);
+
+        // only an overlay: appended to the file as it is, the CheckSum still covers it
+        auto before = ReadFile(output);
+        {
+            auto image = pe::Image::Load(output);
+            image.appendOverlay(Data(Bytes(1001, 4)), 512);
+            CHECK(image.overlayOffsets() == std::vector<std::uint64_t>{utils::AlignUp<std::uint64_t>(before.size(), 512)});
+            image.save(output);
+        }
+        auto appended = ReadFile(output);
+        auto headers = ReadHeaders(appended);
+        auto checksumField = headers.optional + pe::layout::CheckSum;
+        CHECK(appended.size() == utils::AlignUp<size_t>(before.size(), 512) + 1001);
+        CHECK(std::equal(before.begin() + checksumField + 4, before.end(), appended.begin() + checksumField + 4));
+        CHECK(Read32(appended, checksumField) == ExpectedChecksum(appended, checksumField));
+        CHECK(Flatten(pe::Image::Load(output).resources()) == expected);
+    }
+
+    // pe::Checksum over the whole file, and over pieces at odd and even offsets, against the generator's value.
+    void Checksum(const std::filesystem::path &fixture, std::uint32_t reference)
+    {
+        auto file = ReadFile(fixture);
+        auto field = ReadHeaders(file).optional + pe::layout::CheckSum;
+        auto bytes = std::as_bytes(std::span(file));
+        CHECK(Read32(file, field) == reference);
+        for (size_t split : {size_t{0}, size_t{1}, size_t{2}, size_t{3}, size_t{17}, field + 1, file.size() / 2 + 1, file.size()})
+        {
+            pe::Checksum sum;
+            sum.add(0, bytes.first(split));
+            sum.add(split, bytes.subspan(split));
+            sum.remove(field, bytes.subspan(field, 4));
+            CHECK(sum.value(file.size()) == reference);
+        }
+    }
+
+    // A file cut inside its sections is refused instead of being read past the end of the mapping.
+    void Truncated(const std::filesystem::path &fixture, const std::filesystem::path &work)
+    {
+        auto original = ReadFile(fixture);
+        auto rawEnd = ReadHeaders(original).rawEnd;
+        auto cut = work / "truncated.exe";
+        for (size_t size : {rawEnd - 1, rawEnd - 300})
+        {
+            {
+                std::ofstream out(cut, std::ios::binary | std::ios::trunc);
+                out.write(reinterpret_cast<const char *>(original.data()), static_cast<std::streamsize>(size));
+            }
+            bool refused = false;
+            try
+            {
+                pe::Image::Load(cut);
+            }
+            catch (const utils::PackagerError &)
+            {
+                refused = true;
+            }
+            CHECK(refused);
+        }
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: eziapp-packager-tests <fixtures dir>" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::filesystem::path fixtures = argv[1];
+    auto work = std::filesystem::temp_directory_path() / "eziapp-packager-tests";
+    std::filesystem::create_directories(work);
+    auto checksumsFile = ReadFile(fixtures / "checksums.json");
+    auto checksums = json::Parser(std::string_view(reinterpret_cast<const char *>(checksumsFile.data()), checksumsFile.size()), "checksums.json").parse();
+
+    const char *names[] = {"pe32.exe", "pe32_rsrc.exe", "pe32_signed.exe", "pe32_rsrc_signed.exe",
+                           "pe32plus.exe", "pe32plus_rsrc.exe", "pe32plus_signed.exe", "pe32plus_rsrc_signed.exe"};
+    for (auto name : names)
+    {
+        Fixture = name;
+        try
+        {
+            RoundTrip(fixtures / name, work);
+            auto reference = checksums.find(name);
+            CHECK(reference && reference->number());
+            if (reference && reference->number())
+                Checksum(fixtures / name, static_cast<std::uint32_t>(*reference->number()));
+            Truncated(fixtures / name, work);
+        }
+        catch (const std::exception &error)
+        {
+            std::cerr << Fixture << ": " << error.what() << std::endl;
+            ++Failures;
+        }
+    }
+    std::filesystem::remove_all(work);
+
+    if (Failures)
+    {
+        std::cerr << Failures << " check(s) failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "All PE round trips passed." << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,129 @@
+// Round trip of the RT_VERSION resource: zh-CN and en-US tables with custom keys, parsed the way the command line
+// gives them, encoded, decoded and compared, with the Translation var read straight from the encoded bytes.
+#include "../packager.hpp"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace
+{
+    using namespace ezi::builder::packager;
+
+    int Failures = 0;
+
+#define CHECK(condition)                                                                    \
+    do                                                                                      \
+    {                                                                                       \
+        if (!(condition))                                                                   \
+        {                                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+            ++Failures;                                                                     \
+        }                                                                                   \
+    } while (false)
+
+    using Strings = std::vector<std::pair<std::u16string, std::u16string>>;
+
+    // (language, code page) pairs of VarFileInfo\Translation, found by its key rather than through version::Decode.
+    std::vector<std::pair<std::uint16_t, std::uint16_t>> Translation(const std::vector<std::byte> &resource)
+    {
+        std::u16string_view key(u"Translation", 12); // with the terminator
+        auto *words = reinterpret_cast<const char16_t *>(resource.data());
+        std::u16string_view all(words, resource.size() / 2);
+        auto at = all.find(key);
+        if (at == std::u16string_view::npos || at < 3)
+            return {};
+        size_t header = (at - 3) * 2;
+        std::uint16_t valueLength;
+        std::memcpy(&valueLength, resource.data() + header + 2, sizeof(valueLength));
+        size_t value = utils::AlignUp<size_t>((at + key.size()) * 2, 4);
+        std::vector<std::pair<std::uint16_t, std::uint16_t>> pairs;
+        for (size_t i = 0; i + 4 <= valueLength && value + i + 4 <= resource.size(); i += 4)
+        {
+            std::uint16_t pair[2];
+            std::memcpy(pair, resource.data() + value + i, sizeof(pair));
+            pairs.emplace_back(pair[0], pair[1]);
+        }
+        return pairs;
+    }
+
+    void RoundTrip()
+    {
+        VersionInfo info = {};
+        info.companyName = u"EZI";
+        info.productName = u"Demo";
+        info.productVersion = u"1.2.3";
+        info.fileVersion = u"1.2.3.4";
+        ParseVersionParts("1.2.3.4", info.fileVersionParts);
+        ParseVersionParts("1.2.3", info.productVersionParts);
+        CHECK(ParseVersionLanguages("zh-CN,en-US", info.languages));
+        for (const char *entry : {"LegalCopyright=(c) EZI", "zh-CN:ProductName=演示", "en-US:Comments=English only", "zh-CN:BuildId=中文-42"})
+            CHECK(ParseVersionString(entry, utils::Utf8ToUtf16, info.strings));
+        CHECK(!ParseVersionString("=missing key", utils::Utf8ToUtf16, info.strings));
+        CHECK(!ParseVersionString("xx-XX:Key=unknown language", utils::Utf8ToUtf16, info.strings));
+
+        auto encoded = EncodeVersionInfo(info);
+        CHECK(encoded.size() % 4 == 0);
+        auto decoded = version::Decode(encoded);
+        CHECK(decoded.has_value());
+        if (!decoded)
+            return;
+
+        CHECK(decoded->fixed.dwSignature == 0xFEEF04BD);
+        CHECK(decoded->fixed.dwFileVersionMS == 0x00010002 && decoded->fixed.dwFileVersionLS == 0x00030004);
+        CHECK(decoded->fixed.dwProductVersionMS == 0x00010002 && decoded->fixed.dwProductVersionLS == 0x00030000);
+
+        // per table: the standard keys in order, language-neutral extras, then the table's own; an own key replaces
+        Strings chinese = {{u"CompanyName", u"EZI"},
+                           {u"FileVersion", u"1.2.3.4"},
+                           {u"ProductName", u"演示"},
+                           {u"ProductVersion", u"1.2.3"},
+                           {u"LegalCopyright", u"(c) EZI"},
+                           {u"BuildId", u"中文-42"}};
+        Strings english = {{u"CompanyName", u"EZI"},
+                           {u"FileVersion", u"1.2.3.4"},
+                           {u"ProductName", u"Demo"},
+                           {u"ProductVersion", u"1.2.3"},
+                           {u"LegalCopyright", u"(c) EZI"},
+                           {u"Comments", u"English only"}};
+        CHECK(decoded->tables.size() == 2);
+        if (decoded->tables.size() == 2)
+        {
+            CHECK(decoded->tables[0].language == 0x0804 && decoded->tables[0].codePage == 0x04B0);
+            CHECK(decoded->tables[0].strings == chinese);
+            CHECK(decoded->tables[1].language == 0x0409 && decoded->tables[1].codePage == 0x04B0);
+            CHECK(decoded->tables[1].strings == english);
+        }
+
+        auto translation = Translation(encoded);
+        CHECK((translation == std::vector<std::pair<std::uint16_t, std::uint16_t>>{{0x0804, 0x04B0}, {0x0409, 0x04B0}}));
+
+        // what Decode reads back encodes to the same bytes
+        CHECK(version::Encode(*decoded) == encoded);
+    }
+}
+
+int main()
+{
+    try
+    {
+        RoundTrip();
+    }
+    catch (const std::exception &error)
+    {
+        std::cerr << error.what() << std::endl;
+        ++Failures;
+    }
+
+    if (Failures)
+    {
+        std::cerr << Failures << " check(s) failed." << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "Version info round trip passed." << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ezi::builder::packager
+{
+    // Work-stealing pool: every worker owns a deque, runs its own tasks newest first and steals the
+    // oldest task of another worker when it runs dry. Tasks submitted from outside are spread round-robin.
+    class ThreadPool
+    {
+    private:
+        struct Queue
+        {
+            std::mutex mutex;
+            std::deque<std::function<void()>> tasks;
+        };
+
+        std::vector<std::unique_ptr<Queue>> queues;
+        std::vector<std::thread> workers;
+        std::atomic<size_t> pending{0};
+        std::atomic<size_t> nextQueue{0};
+        std::mutex stateMutex;
+        std::condition_variable workAvailable;
+        std::condition_variable allDone;
+        bool stopping = false;
+
+        static size_t &CurrentWorker()
+        {
+            static thread_local size_t index = SIZE_MAX;
+            return index;
+        }
+
+        bool popLocal(size_t index, std::function<void()> &task)
+        {
+            auto &queue = *queues[index];
+            std::lock_guard lock(queue.mutex);
+            if (queue.tasks.empty())
+                return false;
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+            return true;
+        }
+
+        bool steal(size_t thief, std::function<void()> &task)
+        {
+            for (size_t i = 1; i < queues.size(); ++i)
+            {
+                auto &queue = *queues[(thief + i) % queues.size()];
+                std::lock_guard lock(queue.mutex);
+                if (queue.tasks.empty())
+                    continue;
+                task = std::move(queue.tasks.front());
+                queue.tasks.pop_front();
+                return true;
+            }
+            return false;
+        }
+
+        void run(size_t index)
+        {
+            CurrentWorker() = index;
+            std::function<void()> task;
+            while (true)
+            {
+                if (popLocal(index, task) || steal(index, task))
+                {
+                    task();
+                    task = nullptr;
+                    if (pending.fetch_sub(1) == 1)
+                    {
+                        std::lock_guard lock(stateMutex);
+                        allDone.notify_all();
+                    }
+                    continue;
+                }
+                std::unique_lock lock(stateMutex);
+                if (stopping)
+                    return;
+                // re-check under the lock so that a submit between the scan and the wait is not missed
+                workAvailable.wait(lock, [&]
+                                   { return stopping || hasQueuedWork(); });
+            }
+        }
+
+        bool hasQueuedWork()
+        {
+            for (auto &queue : queues)
+            {
+                std::lock_guard lock(queue->mutex);
+                if (!queue->tasks.empty())
+                    return true;
+            }
+            return false;
+        }
+
+    public:
+        explicit ThreadPool(size_t threadCount = 0)
+        {
+            if (threadCount == 0)
+                threadCount = std::max(1u, std::thread::hardware_concurrency());
+            for (size_t i = 0; i < threadCount; ++i)
+                queues.push_back(std::make_unique<Queue>());
+            for (size_t i = 0; i < threadCount; ++i)
+                workers.emplace_back([this, i]
+                                     { run(i); });
+        }
+
+        ~ThreadPool()
+        {
+            {
+                std::lock_guard lock(stateMutex);
+                stopping = true;
+            }
+            workAvailable.notify_all();
+            for (auto &worker : workers)
+                worker.join();
+        }
+
+        ThreadPool(const ThreadPool &) = delete;
+        ThreadPool &operator=(const ThreadPool &) = delete;
+
+        size_t size() const { return workers.size(); }
+
+        void submit(std::function<void()> task)
+        {
+            pending.fetch_add(1);
+            size_t index = CurrentWorker();
+            if (index >= queues.size())
+                index = nextQueue.fetch_add(1) % queues.size();
+            {
+                std::lock_guard lock(queues[index]->mutex);
+                queues[index]->tasks.push_back(std::move(task));
+            }
+            std::lock_guard lock(stateMutex);
+            workAvailable.notify_one();
+        }
+
+        // Blocks until every submitted task, including tasks submitted by tasks, has finished.
+        void wait()
+        {
+            std::unique_lock lock(stateMutex);
+            allDone.wait(lock, [&]
+                         { return pending.load() == 0; });
+        }
+
+        // The first exception thrown by fn is rethrown here once every index has run or been skipped.
+        template <typename Fn>
+        void parallelFor(size_t count, Fn &&fn)
+        {
+            std::exception_ptr error;
+            std::atomic<bool> failed{false};
+            std::mutex errorMutex;
+            for (size_t i = 0; i < count; ++i)
+                submit([&, i]
+                       {
+                    if (failed.load(std::memory_order_relaxed))
+                        return;
+                    try
+                    {
+                        fn(i);
+                    }
+                    catch (...)
+                    {
+                        std::lock_guard lock(errorMutex);
+                        if (!error)
+                            error = std::current_exception();
+                        failed.store(true, std::memory_order_relaxed);
+                    } });
+            wait();
+            if (error)
+                std::rethrow_exception(error);
+        }
+    };
+}
@@ -0,0 +1,338 @@
+#pragma once
+
+#include "utils.hpp"
+#include "json.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace ezi::builder::packager::trace
+{
+    // Heap allocations made by the current thread. The executable feeds these from its replacement
+    // operator new; without one they stay at zero and events simply report no allocations.
+    struct AllocationCounters
+    {
+        std::uint64_t count = 0;
+        std::uint64_t bytes = 0;
+    };
+
+    inline thread_local AllocationCounters ThreadAllocations;
+
+    inline void CountAllocation(size_t size) noexcept
+    {
+        ++ThreadAllocations.count;
+        ThreadAllocations.bytes += size;
+    }
+
+    struct Event
+    {
+        const char *name;
+        const char *category;
+        std::uint32_t thread;
+        double start;    // microseconds since the recorder was enabled
+        double duration; // microseconds
+        std::uint64_t bytesIn;
+        std::uint64_t bytesOut;
+        std::uint64_t allocations;
+        std::uint64_t allocatedBytes;
+        std::string detail;
+    };
+
+    // Process-wide event sink. Disabled by default, in which case scopes cost one relaxed load.
+    // Events go to a single locked vector: even 100k assets produce a few hundred thousand events,
+    // far below the work each of them measures.
+    class Recorder
+    {
+    private:
+        std::atomic<bool> active{false};
+        std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+        std::mutex mutex;
+        std::vector<Event> events;
+        std::vector<std::pair<std::string, std::uint64_t>> counters;
+        std::vector<std::string> warnings;
+        std::vector<std::pair<std::string, std::uint64_t>> outputs;
+        std::atomic<std::uint32_t> nextThread{0};
+
+        Recorder() = default;
+
+        static void AppendNumber(std::string &out, double value)
+        {
+            std::ostringstream stream;
+            stream << std::fixed << std::setprecision(3) << value;
+            out += stream.str();
+        }
+
+    public:
+        static Recorder &Instance()
+        {
+            static Recorder recorder;
+            return recorder;
+        }
+
+        // The enabling thread becomes thread 0, "main" in the trace.
+        void enable()
+        {
+            origin = std::chrono::steady_clock::now();
+            threadId();
+            active.store(true, std::memory_order_relaxed);
+        }
+
+        // Drops everything recorded and stops recording, for the next build of a long-lived library process.
+        void reset()
+        {
+            std::lock_guard lock(mutex);
+            active.store(false, std::memory_order_relaxed);
+            events.clear();
+            counters.clear();
+            warnings.clear();
+            outputs.clear();
+        }
+
+        bool enabled() const { return active.load(std::memory_order_relaxed); }
+
+        double now() const { return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - origin).count(); }
+
+        // Small sequential ids read better in trace viewers than native thread ids.
+        std::uint32_t threadId()
+        {
+            static thread_local std::uint32_t id = nextThread.fetch_add(1);
+            return id;
+        }
+
+        void record(Event event)
+        {
+            std::lock_guard lock(mutex);
+            events.push_back(std::move(event));
+        }
+
+        // Named totals for the summary, e.g. the bytes each kind of resource adds to the output. Repeated names add up.
+        void count(std::string_view name, std::uint64_t value)
+        {
+            if (!enabled())
+                return;
+            std::lock_guard lock(mutex);
+            for (auto &counter : counters)
+            {
+                if (counter.first == name)
+                {
+                    counter.second += value;
+                    return;
+                }
+            }
+            counters.emplace_back(name, value);
+        }
+
+        void output(const std::string &path, std::uint64_t size)
+        {
+            if (!enabled())
+                return;
+            std::lock_guard lock(mutex);
+            outputs.emplace_back(path, size);
+        }
+
+        // Warnings are always printed, and also counted in the summary when tracing.
+        void warn(const std::string &message)
+        {
+            std::cerr << "Warning: " << message << std::endl;
+            if (!enabled())
+                return;
+            std::lock_guard lock(mutex);
+            warnings.push_back(message);
+        }
+
+        // Chrome trace-event format, loadable in chrome://tracing or Perfetto.
+        void writeChromeTrace(const std::filesystem::path &path)
+        {
+            std::lock_guard lock(mutex);
+            std::string out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+            out += "\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"eziapp-packager\"}}";
+            for (std::uint32_t thread = 0; thread < nextThread.load(); ++thread)
+            {
+                out += ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" + std::to_string(thread) + ",\"args\":{\"name\":";
+                json::AppendString(out, thread == 0 ? "main" : "worker " + std::to_string(thread));
+                out += "}}";
+            }
+            for (auto &event : events)
+            {
+                out += ",\n{\"name\":";
+                json::AppendString(out, event.name);
+                out += ",\"cat\":";
+                json::AppendString(out, event.category);
+                out += ",\"ph\":\"X\",\"pid\":1,\"tid\":" + std::to_string(event.thread) + ",\"ts\":";
+                AppendNumber(out, event.start);
+                out += ",\"dur\":";
+                AppendNumber(out, event.duration);
+                out += ",\"args\":{\"bytesIn\":" + std::to_string(event.bytesIn) + ",\"bytesOut\":" + std::to_string(event.bytesOut) +
+                       ",\"allocations\":" + std::to_string(event.allocations) + ",\"allocatedBytes\":" + std::to_string(event.allocatedBytes);
+                if (!event.detail.empty())
+                {
+                    out += ",\"detail\":";
+                    json::AppendString(out, event.detail);
+                }
+                out += "}}";
+            }
+            out += "\n]}\n";
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(out.data(), static_cast<std::streamsize>(out.size()));
+            if (!file)
+                utils::Fail("Failed to write trace: " + path.string());
+        }
+
+        // Per (category, name) totals ordered by first start, plus counters, outputs and warnings.
+        // Durations of events running on several threads add up, so they can exceed totalMs.
+        std::string summary()
+        {
+            std::lock_guard lock(mutex);
+            struct Phase
+            {
+                const char *name;
+                const char *category;
+                double first = 0;
+                std::uint64_t calls = 0;
+                double duration = 0;
+                std::uint64_t bytesIn = 0;
+                std::uint64_t bytesOut = 0;
+                std::uint64_t allocations = 0;
+                std::uint64_t allocatedBytes = 0;
+            };
+            std::vector<Phase> phases;
+            std::map<std::pair<std::string_view, std::string_view>, size_t> lookup;
+            for (auto &event : events)
+            {
+                auto [it, inserted] = lookup.try_emplace({event.category, event.name}, phases.size());
+                if (inserted)
+                    phases.push_back({event.name, event.category, event.start});
+                auto &phase = phases[it->second];
+                phase.first = std::min(phase.first, event.start);
+                ++phase.calls;
+                phase.duration += event.duration;
+                phase.bytesIn += event.bytesIn;
+                phase.bytesOut += event.bytesOut;
+                phase.allocations += event.allocations;
+                phase.allocatedBytes += event.allocatedBytes;
+            }
+            std::stable_sort(phases.begin(), phases.end(), [](auto &a, auto &b)
+                             { return a.first < b.first; });
+
+            std::string out = "{\"version\":1,\"totalMs\":";
+            AppendNumber(out, now() / 1000);
+            out += ",\"peakRssBytes\":" + std::to_string(utils::PeakResidentBytes());
+            out += ",\"phases\":[";
+            for (size_t i = 0; i < phases.size(); ++i)
+            {
+                auto &phase = phases[i];
+                out += i ? ",\n" : "\n";
+                out += "{\"name\":";
+                json::AppendString(out, phase.name);
+                out += ",\"category\":";
+                json::AppendString(out, phase.category);
+                out += ",\"calls\":" + std::to_string(phase.calls) + ",\"ms\":";
+                AppendNumber(out, phase.duration / 1000);
+                out += ",\"bytesIn\":" + std::to_string(phase.bytesIn) + ",\"bytesOut\":" + std::to_string(phase.bytesOut) +
+                       ",\"allocations\":" + std::to_string(phase.allocations) + ",\"allocatedBytes\":" + std::to_string(phase.allocatedBytes) + "}";
+            }
+            out += "],\n\"counters\":{";
+            for (size_t i = 0; i < counters.size(); ++i)
+            {
+                if (i)
+                    out += ",";
+                json::AppendString(out, counters[i].first);
+                out += ":" + std::to_string(counters[i].second);
+            }
+            out += "},\n\"outputs\":[";
+            for (size_t i = 0; i < outputs.size(); ++i)
+            {
+                out += i ? "," : "";
+                out += "{\"path\":";
+                json::AppendString(out, outputs[i].first);
+                out += ",\"bytes\":" + std::to_string(outputs[i].second) + "}";
+            }
+            out += "],\n\"warnings\":[";
+            for (size_t i = 0; i < warnings.size(); ++i)
+            {
+                out += i ? "," : "";
+                json::AppendString(out, warnings[i]);
+            }
+            out += "]}\n";
+            return out;
+        }
+
+        void writeSummary(const std::filesystem::path &path)
+        {
+            auto out = summary();
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(out.data(), static_cast<std::streamsize>(out.size()));
+            if (!file)
+                utils::Fail("Failed to write trace summary: " + path.string());
+        }
+    };
+
+    // Records one complete event from construction to destruction. Names and categories must be string literals.
+    class Scope
+    {
+    private:
+        const char *name;
+        const char *category;
+        bool active;
+        double start = 0;
+        AllocationCounters allocations;
+        std::uint64_t in = 0;
+        std::uint64_t out = 0;
+        std::string text;
+
+    public:
+        Scope(const char *name, const char *category = "phase", std::uint64_t bytesIn = 0)
+            : name(name), category(category), active(Recorder::Instance().enabled()), in(bytesIn)
+        {
+            if (!active)
+                return;
+            start = Recorder::Instance().now();
+            allocations = ThreadAllocations;
+        }
+
+        ~Scope()
+        {
+            if (!active)
+                return;
+            auto &recorder = Recorder::Instance();
+            auto end = recorder.now();
+            recorder.record({name, category, recorder.threadId(), start, end - start, in, out,
+                             ThreadAllocations.count - allocations.count, ThreadAllocations.bytes - allocations.bytes, std::move(text)});
+        }
+
+        Scope(const Scope &) = delete;
+        Scope &operator=(const Scope &) = delete;
+
+        bool enabled() const { return active; }
+
+        void bytesIn(std::uint64_t value) { in = value; }
+        void bytesOut(std::uint64_t value) { out = value; }
+
+        // Renames the event once the outcome is known, e.g. a compression served by the cache.
+        void relabel(const char *value) { name = value; }
+
+        // Free-form label shown with the event, e.g. the asset path. Skipped when tracing is off.
+        void detail(const std::string &value)
+        {
+            if (active)
+                text = value;
+        }
+    };
+
+    inline void Count(std::string_view name, std::uint64_t value) { Recorder::Instance().count(name, value); }
+
+    inline void Warn(const std::string &message) { Recorder::Instance().warn(message); }
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include "platform.hpp"
+#include <cerrno>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef _WIN32
+#include <psapi.h>
+#else
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+namespace ezi::builder::packager::utils
+{
+    // Every packaging failure, caught by main() for the CLI and by the C API for the library. Workers of a
+    // ThreadPool hand theirs on to the parallelFor caller.
+    class PackagerError : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    // Throws a PackagerError carrying the last OS error code.
+    [[noreturn]] inline void Fail(const std::string &message = "")
+    {
+#ifdef _WIN32
+        auto errorCode = GetLastError();
+#else
+        auto errorCode = errno;
+#endif
+        throw PackagerError(message + " Error code: " + std::to_string(errorCode));
+    }
+
+    // Removes a temp output when packaging fails before it was renamed into place; the library keeps running
+    // after a failure, so nothing else would clean it up.
+    class RemoveOnFailure
+    {
+    private:
+        std::filesystem::path path;
+
+    public:
+        explicit RemoveOnFailure(std::filesystem::path path) : path(std::move(path)) {}
+        ~RemoveOnFailure()
+        {
+            std::error_code ec;
+            if (!path.empty())
+                std::filesystem::remove(path, ec);
+        }
+
+        RemoveOnFailure(const RemoveOnFailure &) = delete;
+        RemoveOnFailure &operator=(const RemoveOnFailure &) = delete;
+
+        void release() { path.clear(); }
+    };
+
+    // Paths from the C API and JSON files are UTF-8; a std::string would be read in the ANSI code page.
+    inline std::filesystem::path Utf8Path(std::string_view utf8)
+    {
+        return std::filesystem::path(std::u8string(utf8.begin(), utf8.end()));
+    }
+
+    // UTF-8 text of a path for messages and summaries; path::string() throws on Windows for characters
+    // outside the ANSI code page.
+    inline std::string PathText(const std::filesystem::path &path)
+    {
+        auto text = path.u8string();
+        return std::string(text.begin(), text.end());
+    }
+
+    template <typename T>
+    constexpr T AlignUp(T value, T alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+    inline std::u16string Utf8ToUtf16(const std::string &text)
+    {
+        std::u16string result;
+        result.reserve(text.size());
+        for (size_t i = 0; i < text.size();)
+        {
+            auto c = static_cast<unsigned char>(text[i]);
+            size_t extra = c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : 0;
+            char32_t cp = extra == 0 ? c : c & (0x3F >> extra);
+            if (extra && i + extra >= text.size())
+                break;
+            for (size_t k = 1; k <= extra; ++k)
+                cp = (cp << 6) | (static_cast<unsigned char>(text[i + k]) & 0x3F);
+            i += extra + 1;
+            if (cp >= 0x10000)
+            {
+                cp -= 0x10000;
+                result.push_back(static_cast<char16_t>(0xD800 + (cp >> 10)));
+                result.push_back(static_cast<char16_t>(0xDC00 + (cp & 0x3FF)));
+            }
+            else
+            {
+                result.push_back(static_cast<char16_t>(cp));
+            }
+        }
+        return result;
+    }
+
+    // Arguments arrive in the ANSI code page (e.g. GBK) on Windows and as UTF-8 elsewhere
+    inline std::u16string ToUtf16(const std::string &text)
+    {
+#ifdef _WIN32
+        int len = MultiByteToWideChar(CP_ACP, 0, text.c_str(), -1, nullptr, 0);
+        if (len <= 1)
+            return {};
+        std::u16string result(len - 1, u'\0');
+        MultiByteToWideChar(CP_ACP, 0, text.c_str(), -1, reinterpret_cast<wchar_t *>(result.data()), len);
+        return result;
+#else
+        return Utf8ToUtf16(text);
+#endif
+    }
+
+    inline std::uint64_t PeakResidentBytes()
+    {
+#ifdef _WIN32
+        PROCESS_MEMORY_COUNTERS counters = {};
+        if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+            return 0;
+        return counters.PeakWorkingSetSize;
+#else
+        struct rusage usage = {};
+        if (getrusage(RUSAGE_SELF, &usage) != 0)
+            return 0;
+#ifdef __APPLE__
+        return static_cast<std::uint64_t>(usage.ru_maxrss);
+#else
+        return static_cast<std::uint64_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+    }
+
+    // Flushes a written file to stable storage, so a rename over the previous version never exposes a
+    // partially written file after a crash. Best effort: filesystems without flush support are not an error.
+    inline bool SyncFile(const std::string &path)
+    {
+#ifdef _WIN32
+        // same ANSI code page interpretation as the std::ofstream that wrote the file
+        HANDLE file = CreateFileA(path.c_str(), GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE)
+            return false;
+        bool flushed = FlushFileBuffers(file) != 0;
+        CloseHandle(file);
+        return flushed;
+#else
+        int fd = open(path.c_str(), O_WRONLY | O_CLOEXEC);
+        if (fd < 0)
+            return false;
+        bool flushed = fsync(fd) == 0;
+        close(fd);
+        return flushed;
+#endif
+    }
+}
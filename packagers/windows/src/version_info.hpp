@@ -0,0 +1,280 @@
+#pragma once
+
+#include "platform.hpp"
+#include "utils.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <optional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace ezi::builder::packager::version
+{
+    struct StringTable
+    {
+        std::uint16_t language = 0x0409; // en-US
+        std::uint16_t codePage = 0x04B0; // UTF-16
+        std::vector<std::pair<std::u16string, std::u16string>> strings;
+    };
+
+    // In-memory form of an RT_VERSION resource. Every table also becomes an entry of the Translation var.
+    struct VersionResource
+    {
+        VS_FIXEDFILEINFO fixed = {};
+        std::vector<StringTable> tables;
+    };
+
+    // Each node is [wLength][wValueLength][wType][key\0][pad to 4][value][pad to 4][children].
+    // wLength covers the node up to the end of its value or last child, parents add the padding between children.
+    class Encoder
+    {
+    private:
+        static constexpr std::u16string_view RootKey = u"VS_VERSION_INFO";
+        static constexpr std::u16string_view StringFileInfoKey = u"StringFileInfo";
+        static constexpr std::u16string_view VarFileInfoKey = u"VarFileInfo";
+        static constexpr std::u16string_view TranslationKey = u"Translation";
+
+        const VersionResource &resource;
+        std::vector<std::byte> buffer;
+        size_t cursor = 0;
+
+        static size_t HeaderSize(std::u16string_view key)
+        {
+            return utils::AlignUp<size_t>(sizeof(WORD) * 3 + (key.size() + 1) * sizeof(WCHAR), 4);
+        }
+
+        static size_t StringSize(const std::u16string &key, const std::u16string &value)
+        {
+            return HeaderSize(key) + (value.size() + 1) * sizeof(WCHAR);
+        }
+
+        static std::u16string TableKey(const StringTable &table)
+        {
+            static const char16_t digits[] = u"0123456789ABCDEF";
+            std::u16string key(8, u'0');
+            std::uint32_t value = (static_cast<std::uint32_t>(table.language) << 16) | table.codePage;
+            for (int i = 0; i < 8; ++i)
+                key[7 - i] = digits[(value >> (i * 4)) & 0xF];
+            return key;
+        }
+
+        size_t tableSize(const StringTable &table) const
+        {
+            size_t size = HeaderSize(TableKey(table));
+            for (auto &[key, value] : table.strings)
+                size = utils::AlignUp<size_t>(size, 4) + StringSize(key, value);
+            return size;
+        }
+
+        size_t stringFileInfoSize() const
+        {
+            size_t size = HeaderSize(StringFileInfoKey);
+            for (auto &table : resource.tables)
+                size = utils::AlignUp<size_t>(size, 4) + tableSize(table);
+            return size;
+        }
+
+        size_t translationSize() const { return HeaderSize(TranslationKey) + resource.tables.size() * sizeof(DWORD); }
+
+        size_t varFileInfoSize() const { return HeaderSize(VarFileInfoKey) + translationSize(); }
+
+        size_t rootSize() const
+        {
+            size_t size = HeaderSize(RootKey) + sizeof(VS_FIXEDFILEINFO);
+            if (!resource.tables.empty())
+                size = utils::AlignUp<size_t>(size, 4) + stringFileInfoSize();
+            return utils::AlignUp<size_t>(size, 4) + varFileInfoSize();
+        }
+
+        void put(const void *data, size_t size)
+        {
+            std::memcpy(buffer.data() + cursor, data, size);
+            cursor += size;
+        }
+
+        void align() { cursor = utils::AlignUp<size_t>(cursor, 4); }
+
+        void header(size_t length, size_t valueLength, WORD type, std::u16string_view key)
+        {
+            if (length > 0xFFFF || valueLength > 0xFFFF)
+                utils::Fail("Version resource block exceeds 64KB.");
+            align();
+            WORD words[3] = {static_cast<WORD>(length), static_cast<WORD>(valueLength), type};
+            put(words, sizeof(words));
+            put(key.data(), key.size() * sizeof(WCHAR));
+            cursor += sizeof(WCHAR); // terminator, buffer is zero-initialized
+            align();
+        }
+
+    public:
+        explicit Encoder(const VersionResource &resource) : resource(resource) {}
+
+        // Sizing pass first, then every node is written once into a single zeroed buffer.
+        std::vector<std::byte> encode()
+        {
+            buffer.assign(rootSize(), std::byte{0});
+            cursor = 0;
+
+            header(buffer.size(), sizeof(VS_FIXEDFILEINFO), 0, RootKey);
+            put(&resource.fixed, sizeof(VS_FIXEDFILEINFO));
+
+            if (!resource.tables.empty())
+            {
+                header(stringFileInfoSize(), 0, 1, StringFileInfoKey);
+                for (auto &table : resource.tables)
+                {
+                    auto key = TableKey(table);
+                    header(tableSize(table), 0, 1, key);
+                    for (auto &[name, value] : table.strings)
+                    {
+                        // wValueLength counts characters without the terminator, as the packager always wrote it
+                        header(StringSize(name, value), value.size(), 1, name);
+                        put(value.data(), value.size() * sizeof(WCHAR));
+                        cursor += sizeof(WCHAR);
+                    }
+                }
+            }
+
+            header(varFileInfoSize(), 0, 1, VarFileInfoKey);
+            header(translationSize(), resource.tables.size() * sizeof(DWORD), 0, TranslationKey);
+            for (auto &table : resource.tables)
+            {
+                WORD pair[2] = {table.language, table.codePage};
+                put(pair, sizeof(pair));
+            }
+            return std::move(buffer);
+        }
+    };
+
+    inline std::vector<std::byte> Encode(const VersionResource &resource)
+    {
+        return Encoder(resource).encode();
+    }
+
+    // Parses an RT_VERSION resource back into tables; used to verify encoder output and to read existing resources.
+    inline std::optional<VersionResource> Decode(std::span<const std::byte> data)
+    {
+        struct Node
+        {
+            size_t begin;
+            size_t end;
+            size_t valueLength;
+            WORD type;
+            std::u16string key;
+            size_t value; // offset of the value
+        };
+        auto word = [&](size_t at)
+        {
+            WORD value;
+            std::memcpy(&value, data.data() + at, sizeof(value));
+            return value;
+        };
+        auto readNode = [&](size_t at, size_t limit) -> std::optional<Node>
+        {
+            if (at + 6 > limit)
+                return std::nullopt;
+            Node node;
+            node.begin = at;
+            node.end = at + word(at);
+            node.valueLength = word(at + 2);
+            node.type = word(at + 4);
+            if (node.end > limit || node.end < at + 6)
+                return std::nullopt;
+            size_t cursor = at + 6;
+            while (true)
+            {
+                if (cursor + 2 > node.end)
+                    return std::nullopt;
+                auto c = word(cursor);
+                cursor += 2;
+                if (c == 0)
+                    break;
+                node.key.push_back(static_cast<char16_t>(c));
+            }
+            node.value = utils::AlignUp<size_t>(cursor, 4);
+            return node;
+        };
+        auto children = [&](const Node &node, size_t valueBytes)
+        {
+            std::vector<Node> result;
+            size_t at = utils::AlignUp<size_t>(node.value + valueBytes, 4);
+            while (at < node.end)
+            {
+                auto child = readNode(at, node.end);
+                if (!child)
+                    return std::optional<std::vector<Node>>();
+                result.push_back(*child);
+                at = utils::AlignUp<size_t>(child->end, 4);
+            }
+            return std::optional<std::vector<Node>>(std::move(result));
+        };
+
+        auto root = readNode(0, data.size());
+        if (!root || root->key != u"VS_VERSION_INFO" || root->valueLength != sizeof(VS_FIXEDFILEINFO) ||
+            root->value + sizeof(VS_FIXEDFILEINFO) > root->end)
+            return std::nullopt;
+
+        VersionResource resource;
+        std::memcpy(&resource.fixed, data.data() + root->value, sizeof(VS_FIXEDFILEINFO));
+        auto sections = children(*root, sizeof(VS_FIXEDFILEINFO));
+        if (!sections)
+            return std::nullopt;
+        for (auto &section : *sections)
+        {
+            if (section.key != u"StringFileInfo")
+                continue;
+            auto tables = children(section, 0);
+            if (!tables)
+                return std::nullopt;
+            for (auto &tableNode : *tables)
+            {
+                if (tableNode.key.size() != 8)
+                    return std::nullopt;
+                StringTable table;
+                auto code = std::stoul(std::string(tableNode.key.begin(), tableNode.key.end()), nullptr, 16);
+                table.language = static_cast<std::uint16_t>(code >> 16);
+                table.codePage = static_cast<std::uint16_t>(code & 0xFFFF);
+                auto strings = children(tableNode, 0);
+                if (!strings)
+                    return std::nullopt;
+                for (auto &string : *strings)
+                {
+                    // the value runs to the end of the node; trailing terminators are not part of it
+                    std::u16string value;
+                    for (size_t at = string.value; at + 2 <= string.end; at += 2)
+                        value.push_back(static_cast<char16_t>(word(at)));
+                    while (!value.empty() && value.back() == u'\0')
+                        value.pop_back();
+                    table.strings.emplace_back(string.key, std::move(value));
+                }
+                resource.tables.push_back(std::move(table));
+            }
+        }
+        return resource;
+    }
+
+    // Accepts "zh-CN", "en-US" or a hexadecimal LANGID such as "0804".
+    inline std::optional<std::uint16_t> ParseLanguage(const std::string &name)
+    {
+        static const std::pair<const char *, std::uint16_t> known[] = {
+            {"en-US", 0x0409},
+            {"zh-CN", 0x0804},
+            {"zh-TW", 0x0404},
+            {"ja-JP", 0x0411},
+            {"ko-KR", 0x0412},
+            {"de-DE", 0x0407},
+            {"fr-FR", 0x040C},
+            {"es-ES", 0x0C0A},
+            {"ru-RU", 0x0419},
+        };
+        for (auto &[tag, id] : known)
+            if (name == tag)
+                return id;
+        if (name.empty() || name.size() > 4 || name.find_first_not_of("0123456789abcdefABCDEF") != std::string::npos)
+            return std::nullopt;
+        return static_cast<std::uint16_t>(std::stoul(name, nullptr, 16));
+    }
+}
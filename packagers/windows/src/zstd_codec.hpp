@@ -0,0 +1,238 @@
+#pragma once
+
+#include "utils.hpp"
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <vector>
+#include <zdict.h>
+#include <zstd.h>
+
+namespace ezi::builder::packager
+{
+    inline std::vector<std::byte> CompressFrame(std::span<const std::byte> input, int level)
+    {
+        thread_local std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> context(ZSTD_createCCtx(), ZSTD_freeCCtx);
+        std::vector<std::byte> frame(ZSTD_compressBound(input.size()));
+        size_t size = ZSTD_compressCCtx(context.get(), frame.data(), frame.size(), input.data(), input.size(), level);
+        if (ZSTD_isError(size))
+            utils::Fail(std::string("Compression failed: ") + ZSTD_getErrorName(size));
+        frame.resize(size);
+        frame.shrink_to_fit();
+        return frame;
+    }
+
+    // Seek table of the zstd seekable format (zstd's contrib/seekable_format): a run of independent frames
+    // followed by a skippable frame that lists the compressed and decompressed size of each. Plain decoders
+    // skip the table and decode the frames back to back; seeking decoders locate the frames covering a range.
+    struct SeekTableEntry
+    {
+        std::uint32_t compressedSize;
+        std::uint32_t decompressedSize;
+    };
+
+    namespace seekable
+    {
+        constexpr std::uint32_t SkippableMagic = 0x184D2A5E;
+        constexpr std::uint32_t SeekableMagic = 0x8F92EAB1;
+        constexpr size_t FooterSize = 9; // u32 frame count, u8 descriptor, u32 magic
+        constexpr std::uint32_t MaxFrames = 0x8000000;
+    }
+
+    // Skippable frame holding the seek table, appended after the last frame. No per-frame checksums are stored.
+    inline std::vector<std::byte> BuildSeekTable(const std::vector<SeekTableEntry> &entries)
+    {
+        if (entries.size() > seekable::MaxFrames)
+            utils::Fail("Too many chunks for a zstd seek table.");
+        std::vector<std::byte> table(8 + entries.size() * sizeof(SeekTableEntry) + seekable::FooterSize);
+        auto put = [&](size_t at, std::uint32_t value)
+        { std::memcpy(table.data() + at, &value, sizeof(value)); };
+        put(0, seekable::SkippableMagic);
+        put(4, static_cast<std::uint32_t>(table.size() - 8));
+        for (size_t i = 0; i < entries.size(); ++i)
+        {
+            put(8 + i * 8, entries[i].compressedSize);
+            put(12 + i * 8, entries[i].decompressedSize);
+        }
+        auto footer = table.size() - seekable::FooterSize;
+        put(footer, static_cast<std::uint32_t>(entries.size()));
+        table[footer + 4] = std::byte{0};
+        put(footer + 5, seekable::SeekableMagic);
+        return table;
+    }
+
+    // Entries of the seek table ending `stream`, or nothing when the stream is not in the seekable format
+    // or its table does not add up to the stream's size.
+    inline std::optional<std::vector<SeekTableEntry>> ReadSeekTable(std::span<const std::byte> stream)
+    {
+        auto get = [&](size_t at)
+        {
+            std::uint32_t value;
+            std::memcpy(&value, stream.data() + at, sizeof(value));
+            return value;
+        };
+        if (stream.size() < 8 + seekable::FooterSize || get(stream.size() - 4) != seekable::SeekableMagic)
+            return std::nullopt;
+        auto footer = stream.size() - seekable::FooterSize;
+        std::uint64_t count = get(footer);
+        auto descriptor = std::to_integer<std::uint8_t>(stream[footer + 4]);
+        size_t entrySize = descriptor & 0x80 ? 12 : 8;
+        if ((descriptor & 0x7C) || count > seekable::MaxFrames)
+            return std::nullopt;
+        auto tableSize = 8 + count * entrySize + seekable::FooterSize;
+        if (tableSize > stream.size())
+            return std::nullopt;
+        auto start = stream.size() - tableSize;
+        if (get(start) != seekable::SkippableMagic || get(start + 4) != tableSize - 8)
+            return std::nullopt;
+
+        std::vector<SeekTableEntry> entries(count);
+        std::uint64_t frames = 0;
+        for (size_t i = 0; i < count; ++i)
+        {
+            entries[i] = {get(start + 8 + i * entrySize), get(start + 12 + i * entrySize)};
+            frames += entries[i].compressedSize;
+        }
+        if (frames != start)
+            return std::nullopt;
+        return entries;
+    }
+
+    // A zstd dictionary shared by all small asset frames. The digested form is built once and used
+    // read-only from every compression thread.
+    class ZstdDictionary
+    {
+    private:
+        std::vector<std::byte> content;
+        unsigned dictId = 0;
+        std::unique_ptr<ZSTD_CDict, decltype(&ZSTD_freeCDict)> compressDict{nullptr, ZSTD_freeCDict};
+
+        ZstdDictionary(std::vector<std::byte> bytes, int level) : content(std::move(bytes))
+        {
+            dictId = ZDICT_getDictID(content.data(), content.size());
+            compressDict.reset(ZSTD_createCDict(content.data(), content.size(), level));
+            if (!compressDict)
+                utils::Fail("Failed to load zstd dictionary.");
+        }
+
+    public:
+        static constexpr size_t DefaultCapacity = 112 << 10;
+        static constexpr size_t MaxSampleBytes = 64 << 20;
+
+        static std::shared_ptr<ZstdDictionary> Load(const std::filesystem::path &path, int level)
+        {
+            auto file = MappedFile::Open(path);
+            std::vector<std::byte> bytes(file->bytes().begin(), file->bytes().end());
+            // raw-content dictionaries have no id, frames could not name the dictionary they need
+            if (ZDICT_getDictID(bytes.data(), bytes.size()) == 0)
+                utils::Fail("Not a zstd dictionary (missing dictionary id): " + path.string());
+            return std::shared_ptr<ZstdDictionary>(new ZstdDictionary(std::move(bytes), level));
+        }
+
+        // Trains on the given samples; returns nullptr when zstd cannot build a useful dictionary from them,
+        // which happens with too few or too uniform samples.
+        static std::shared_ptr<ZstdDictionary> Train(const std::vector<std::span<const std::byte>> &samples, int level, size_t capacity = DefaultCapacity)
+        {
+            std::vector<std::byte> buffer;
+            std::vector<size_t> sizes;
+            for (auto &sample : samples)
+            {
+                if (buffer.size() + sample.size() > MaxSampleBytes)
+                    break;
+                buffer.insert(buffer.end(), sample.begin(), sample.end());
+                sizes.push_back(sample.size());
+            }
+            if (sizes.size() < 8)
+                return nullptr;
+
+            std::vector<std::byte> bytes(capacity);
+            size_t size = ZDICT_trainFromBuffer(bytes.data(), bytes.size(), buffer.data(), sizes.data(), static_cast<unsigned>(sizes.size()));
+            if (ZDICT_isError(size))
+                return nullptr;
+            bytes.resize(size);
+            return std::shared_ptr<ZstdDictionary>(new ZstdDictionary(std::move(bytes), level));
+        }
+
+        unsigned id() const { return dictId; }
+
+        std::span<const std::byte> bytes() const { return content; }
+
+        std::vector<std::byte> compress(std::span<const std::byte> input) const
+        {
+            thread_local std::unique_ptr<ZSTD_CCtx, decltype(&ZSTD_freeCCtx)> context(ZSTD_createCCtx(), ZSTD_freeCCtx);
+            std::vector<std::byte> frame(ZSTD_compressBound(input.size()));
+            size_t size = ZSTD_compress_usingCDict(context.get(), frame.data(), frame.size(), input.data(), input.size(), compressDict.get());
+            if (ZSTD_isError(size))
+                utils::Fail(std::string("Compression failed: ") + ZSTD_getErrorName(size));
+            frame.resize(size);
+            frame.shrink_to_fit();
+            return frame;
+        }
+    };
+
+    struct DictionaryBenchmark
+    {
+        size_t files = 0;
+        std::uint64_t rawBytes = 0;
+        std::uint64_t plainBytes = 0;
+        std::uint64_t dictBytes = 0;
+        double plainMBps = 0;
+        double dictMBps = 0;
+    };
+
+    // Compresses the samples with and without the dictionary and measures single-threaded decompression
+    // the way the runtime does it: one reused context, one frame per asset.
+    inline DictionaryBenchmark BenchmarkDictionary(const std::vector<std::span<const std::byte>> &samples, const ZstdDictionary &dictionary, int level)
+    {
+        DictionaryBenchmark result;
+        std::vector<std::vector<std::byte>> plain, withDict;
+        for (auto &sample : samples)
+        {
+            plain.push_back(CompressFrame(sample, level));
+            withDict.push_back(dictionary.compress(sample));
+            result.rawBytes += sample.size();
+            result.plainBytes += plain.back().size();
+            result.dictBytes += withDict.back().size();
+        }
+        result.files = samples.size();
+        if (samples.empty())
+            return result;
+
+        std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context(ZSTD_createDCtx(), ZSTD_freeDCtx);
+        std::unique_ptr<ZSTD_DDict, decltype(&ZSTD_freeDDict)> decompressDict(
+            ZSTD_createDDict(dictionary.bytes().data(), dictionary.bytes().size()), ZSTD_freeDDict);
+        std::vector<std::byte> output;
+        auto measure = [&](const std::vector<std::vector<std::byte>> &frames, const ZSTD_DDict *ddict)
+        {
+            // repeat until the run is long enough for the clock to be meaningful
+            size_t rounds = 0;
+            auto start = std::chrono::steady_clock::now();
+            double elapsed = 0;
+            do
+            {
+                for (size_t i = 0; i < frames.size(); ++i)
+                {
+                    output.resize(samples[i].size());
+                    size_t size = ddict ? ZSTD_decompress_usingDDict(context.get(), output.data(), output.size(), frames[i].data(), frames[i].size(), ddict)
+                                        : ZSTD_decompressDCtx(context.get(), output.data(), output.size(), frames[i].data(), frames[i].size());
+                    if (ZSTD_isError(size) || size != samples[i].size())
+                        utils::Fail("Dictionary benchmark failed to round-trip an asset.");
+                }
+                ++rounds;
+                elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            } while (elapsed < 0.2);
+            return static_cast<double>(result.rawBytes) * rounds / elapsed / (1024 * 1024);
+        };
+        result.plainMBps = measure(plain, nullptr);
+        result.dictMBps = measure(withDict, decompressDict.get());
+        return result;
+    }
+}
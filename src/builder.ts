@@ -2,15 +2,11 @@ import { spawn } from "child_process";
 import {
     getArg,
     getCurrentPlatformName,
-    getCurrentTimeString,
-    getAllFiles
+    getCurrentTimeString
 } from "./utils";
 import * as fs from "fs";
 import * as path from "path";
 import { build, createServer } from "vite";
-import { compress } from '@mongodb-js/zstd'
-import sharp from 'sharp';
-import pngToIco from 'png-to-ico';
 import chalk from "chalk";
 
 const { red, green, yellow, blue, bold } = chalk;
@@ -19,7 +15,8 @@ type BuildMode = 'debug' | 'release'
 type Platform = 'windows' | 'linux' | 'macos'
 
 const packagers: Partial<Record<Platform, string>> = {
-    windows: "../packagers/windows/main"
+    windows: "../packagers/windows/main",
+    linux: "../packagers/linux/main"
 }
 
 const eziDevExePaths: Partial<Record<Platform, string>> = {
@@ -93,81 +90,28 @@ export class Builder {
         }
     }
 
-    public async genAssets() {
-        const assetsMatas: {
-            [key: string]: {
-                offset: number;
-                size: number;
-            };
-        } = {};
-        const assetsBinarys: Buffer[] = [];
-        let offset = 0;
-
-        // 打包ezi配置文件
-        const configBuffer = await compress(Buffer.from(JSON.stringify(this.eziConfig), "utf-8"));
-        const configSize = configBuffer.length;
-        assetsMatas["ezi.config.manifest"] = { offset, size: configSize };
-        assetsBinarys.push(configBuffer);
-        offset += configSize;
-
-        // 打包资源文件
-        const assetsDir = path.join(process.cwd(), this.eziConfig.application.buildEntry || "dist");
+    public genConfig() {
+        // 资源包由打包器根据 buildEntry 目录原生生成，这里只输出其中的配置清单
+        fs.writeFileSync(path.join(this.genTempFilePath, 'ezi.config.manifest.json'), JSON.stringify(this.eziConfig), { encoding: "utf-8" });
         console.log(green(`✓ frontend assets located at: ${this.eziConfig.application.buildEntry}`));
-
-        const files = getAllFiles(assetsDir);
-
-        for (const file of files) {
-            const filePath = path.join(assetsDir, file);
-            const stat = fs.statSync(filePath);
-            if (stat.isFile()) {
-                const packageName = this.eziConfig?.application?.package || this.defaultEziConfig.application.package;
-                const fileBuffer = await compress(fs.readFileSync(filePath));
-                const assetsId = `https://${packageName}/${file.split(path.sep).join("/")}`;
-                const size = fileBuffer.length;
-                assetsMatas[assetsId] = { offset, size };
-                assetsBinarys.push(fileBuffer);
-                offset += size;
-            }
-        }
-
-        // 打包清单文件
-        const manifestBuffer = await compress(Buffer.from(JSON.stringify(assetsMatas), "utf-8"));
-        const manifestSize = manifestBuffer.length;
-        if (manifestSize > 4294967295) {
-            throw new Error("Manifest size exceeds 4GB limit.");
-        }
-        assetsBinarys.push(manifestBuffer);
-
-        // 写入清单头
-        const manifestSizeFlag = 4;
-        const headerBuffer = Buffer.alloc(manifestSizeFlag);
-        headerBuffer.writeUInt32LE(manifestSize, 0);
-        assetsBinarys.push(headerBuffer);
-        fs.writeFileSync(path.join(this.genTempFilePath, 'ezi.assets.binary'), Buffer.concat(assetsBinarys));
-
-        console.log(green("✓ assets generated."));
     }
 
-    public async genIcon() {
+    public genIcon() {
+        // 多尺寸图标由打包器从 PNG 原生生成，这里只检查图标源文件
         if (!(this.eziConfig.application.icon)) {
             return;
         }
         const iconPath = path.join("public", this.eziConfig.application.icon);
-
-        try {
-            const resizedPngBuffer = await sharp(iconPath)
-                .resize(256, 256, { fit: 'cover' })
-                .png()
-                .toBuffer();
-
-            const icoBuffer = await pngToIco(resizedPngBuffer);
-
-            fs.writeFileSync(path.join(this.genTempFilePath, 'eziapp.ico'), icoBuffer);
-            console.log(green("✓ icon generated."));
-        } catch (err) {
-            console.error('Error generating icon:', err);
+        if (!fs.existsSync(iconPath)) {
+            console.error(red(`✗ icon not found: ${iconPath}`));
+            process.exit(1);
+        }
+        const ext = path.extname(iconPath).toLowerCase();
+        if (ext !== '.png' && ext !== '.ico') {
+            console.error(red(`✗ unsupported icon format: ${ext}, please use a .png or .ico file.`));
             process.exit(1);
         }
+        console.log(green(`✓ icon located at: ${iconPath}`));
     }
 
     public async build() {
@@ -182,8 +126,8 @@ export class Builder {
             this.eziConfig.application.buildEntry = this.viteConfig?.build?.outDir || "dist";
         }
         await build();
-        await this.genAssets();
-        await this.genIcon();
+        this.genConfig();
+        this.genIcon();
         const packagerModule = await import(path.join(__dirname, packagerPath));
         const PackagerClass = packagerModule.default || packagerModule;
         const packager = new PackagerClass({
@@ -1,7 +1,3 @@
-import * as fs from "fs";
-import * as path from "path";
-
-
 export function getArg(key: string): string | null {
     const argv = process.argv;
     for (let i = 0; i < argv.length; i++) {
@@ -20,24 +16,6 @@ export function getCurrentTimeString(): string {
 }
 
 
-export function getAllFiles(dir: string, baseDir: string = dir): string[] {
-    let results: string[] = [];
-
-    const list = fs.readdirSync(dir);
-    for (const file of list) {
-        const fullPath = path.join(dir, file);
-        const stat = fs.statSync(fullPath);
-
-        if (stat.isDirectory()) {
-            results = results.concat(getAllFiles(fullPath, baseDir));
-        } else {
-            const relativePath = path.relative(baseDir, fullPath);
-            results.push(relativePath);
-        }
-    }
-    return results;
-}
-
 export function getCurrentPlatformName() {
     switch (process.platform) {
         case "win32":